@@ -5,8 +5,26 @@
  */
 #pragma once
 #include "Source/FrameBuffer.h"
+#include "Source/FillKernels.h"
+#include "Source/BlendKernels.h"
+#include "Source/MemoryBackend.h"
+#include "Source/FileBackend.h"
+#include "Source/Rectangle.h"
+#include "Source/DrawContext.h"
 #include "Source/ImagePainter.h"
+#include "Source/AnimatedImage.h"
+#include "Source/SpritePainter.h"
+#include "Source/ScaledImage.h"
+#include "Source/PreparedImage.h"
+#include "Source/Compositor.h"
+#include "Source/WorkerPool.h"
 #include "Source/CodeImage.h"
+#include "Source/RawImage.h"
+#include "Source/QoiImage.h"
+#include "Source/ImageCache.h"
+#include "Source/ImageLoader.h"
+#include "Source/AsyncImagePainter.h"
 #ifdef USE_PNG
 #include "Source/PngImage.h"
+#include "Source/PngStream.h"
 #endif
@@ -1,15 +1,23 @@
 /**
  * @file  ImageEncoder.cpp
  *
- * @brief  Encodes .png image data into C++ source code.
+ * @brief  Encodes .png image data into C++ source code, into raw image
+ *         files that FBPainter can map straight into memory, or into QOI
+ *         image files that FBPainter can decode without libpng.
  */
 
+#include "../Source/RawImageFormat.h"
+#include "../Source/QoiFormat.h"
+#include "../Source/BlendKernels.h"
 #include <png++/png.hpp>
+#include <algorithm>
 #include <string>
+#include <unordered_map>
 #include <functional>
 #include <vector>
 #include <fstream>
 #include <iostream>
+#include <cstdlib>
 
 typedef png::rgba_pixel Pixel;
 typedef png::image<Pixel, png::solid_pixel_buffer<Pixel>> Image;
@@ -20,11 +28,23 @@ typedef png::image<Pixel, png::solid_pixel_buffer<Pixel>> Image;
  * The created files will share the name and path of the image, with file
  * extensions changed appropriately.
  *
- * @param imgPath  The path to a .png image file.
+ * @param imgPath      The path to a .png image file.
  *
- * @return         Whether the image was encoded successfully.
+ * @param frameWidth   If non-zero, the image is a strip or sheet of animation
+ *                     frames with this width, and the frame size and count
+ *                     are added to the encoded class for use with
+ *                     FBPainter::AnimatedImage.
+ *
+ * @param frameHeight  The height of each animation frame, or zero to use the
+ *                     full image height.
+ *
+ * @param frameCount   The number of animation frames, or zero to count every
+ *                     whole frame within the image.
+ *
+ * @return             Whether the image was encoded successfully.
  */
-bool testEncode(const std::string& imgPath)
+bool testEncode(const std::string& imgPath, size_t frameWidth = 0,
+        size_t frameHeight = 0, size_t frameCount = 0)
 {
     using std::string;
     // Load image data:
@@ -41,42 +61,98 @@ bool testEncode(const std::string& imgPath)
     }
     const size_t width = src.get_width();
     const size_t height = src.get_height();
-
-    // Find and store all unique image pixel colors:
-    std::vector<Pixel> colorList;
-    const auto colorIndex = [&colorList](const Pixel& color)
+    if (frameWidth > 0)
     {
-        for (int i = 0; i < colorList.size(); i++)
+        if (frameHeight == 0)
         {
-            if (colorList[i].red == color.red
-                    && colorList[i].green == color.green
-                    && colorList[i].blue == color.blue
-                    && colorList[i].alpha == color.alpha)
-            {
-                return i;
-            }
+            frameHeight = height;
         }
-        return -1;
-    };
+        const size_t sheetFrames = (width / frameWidth)
+                * (height / frameHeight);
+        if (frameCount == 0 || frameCount > sheetFrames)
+        {
+            frameCount = sheetFrames;
+        }
+        if (frameCount == 0)
+        {
+            std::cerr << "\"" << imgPath << "\" has no whole " << frameWidth
+                    << "x" << frameHeight << " frames.\n";
+            return false;
+        }
+    }
 
-    // Map image colors and stringify image data:
-    std::string imageData;
-    imageData.reserve(width * height + 1);
+    // Find and store all unique image pixel colors, and the color index of
+    // each pixel:
+    std::vector<Pixel> colorList;
+    std::unordered_map<uint32_t, size_t> colorIndices;
+    std::vector<size_t> pixelIndices;
+    pixelIndices.reserve(width * height);
     for (size_t y = 0; y < height; y++)
     {
         for (size_t x = 0; x < width; x++)
         {
             const Pixel pixelColor = src.get_pixel(x, y);
-            int cIndex = colorIndex(pixelColor);
-            if (cIndex == -1)
+            const uint32_t colorKey
+                    = (static_cast<uint32_t>(pixelColor.red) << 24)
+                    | (pixelColor.green << 16) | (pixelColor.blue << 8)
+                    | pixelColor.alpha;
+            const auto found = colorIndices.emplace(colorKey,
+                    colorList.size());
+            if (found.second)
             {
-                cIndex = colorList.size();
                 colorList.push_back(pixelColor);
             }
-            imageData += ('a' + cIndex);
+            pixelIndices.push_back(found.first->second);
         }
     }
 
+    // Store color indices with the fewest bits that fit every index. If the
+    // color list would take up more space than indexing saves, store each
+    // pixel's color directly instead, marked by zero index bits:
+    size_t indexBits = 0;
+    for (const size_t bits : { 1, 2, 4, 8, 16 })
+    {
+        if (colorList.size() <= (static_cast<size_t>(1) << bits))
+        {
+            indexBits = bits;
+            break;
+        }
+    }
+    const size_t pixelCount = width * height;
+    if (indexBits > 0 && (pixelCount * indexBits + 7) / 8
+            + colorList.size() * 4 >= pixelCount * 4)
+    {
+        indexBits = 0;
+    }
+    std::vector<uint32_t> imageData;
+    if (indexBits == 0)
+    {
+        for (const size_t index : pixelIndices)
+        {
+            // Direct values use the same 0xAARRGGBB order as listed colors,
+            // so they're copied without any conversion:
+            const Pixel& color = colorList[index];
+            imageData.push_back((static_cast<uint32_t>(color.alpha) << 24)
+                    | (color.red << 16) | (color.green << 8) | color.blue);
+        }
+    }
+    else if (indexBits < 8)
+    {
+        // Pack indices into bytes, starting with the lowest bits:
+        const size_t indicesPerByte = 8 / indexBits;
+        imageData.assign((pixelCount + indicesPerByte - 1) / indicesPerByte,
+                0);
+        for (size_t i = 0; i < pixelCount; i++)
+        {
+            imageData[i / indicesPerByte] |= pixelIndices[i]
+                    << ((i % indicesPerByte) * indexBits);
+        }
+    }
+    else
+    {
+        imageData.assign(pixelIndices.begin(), pixelIndices.end());
+    }
+
     // Generate output files:
     const auto writeFile = [](const string& filePath, const auto writeAction)
     {
@@ -118,7 +194,8 @@ bool testEncode(const std::string& imgPath)
     }
 
     // Write image header:
-    const auto writeHeader = [&imageData, &colorList, &baseName, width, height]
+    const auto writeHeader = [&colorList, &baseName, width, height,
+            frameWidth, frameHeight, frameCount]
     (std::ofstream& header)
     {
         string indent = "    ";
@@ -147,8 +224,20 @@ bool testEncode(const std::string& imgPath)
                 << ";\n\n"
                 << indent << "// Image height in pixels:\n"
                 << indent << "static const constexpr size_t height = " << height
-                << ";\n\n"
-                << indent << "/**\n"
+                << ";\n\n";
+        if (frameWidth > 0)
+        {
+            header << indent << "// Animation frame width in pixels:\n"
+                    << indent << "static const constexpr size_t frameWidth = "
+                    << frameWidth << ";\n\n"
+                    << indent << "// Animation frame height in pixels:\n"
+                    << indent << "static const constexpr size_t frameHeight = "
+                    << frameHeight << ";\n\n"
+                    << indent << "// Number of animation frames:\n"
+                    << indent << "static const constexpr size_t frameCount = "
+                    << frameCount << ";\n\n";
+        }
+        header << indent << "/**\n"
                 << indent << " * @brief  Gets the color of an image pixel.\n"
                 << indent << " *\n"
                 << indent << " * @param x  The pixel's x-coordinate.\n"
@@ -160,57 +249,160 @@ bool testEncode(const std::string& imgPath)
                 << indent << " *           coordinates are invalid.\n"
                 << indent << " */\n"
                 << indent << "static RGBAPixel getColor(const size_t x,"
-                << "const size_t y);\n";
+                << "const size_t y);\n\n"
+                << indent << "/**\n"
+                << indent << " * @brief  Copies a run of pixels from one image "
+                << "row.\n"
+                << indent << " *\n"
+                << indent << " * @param y       The row's y-coordinate.\n"
+                << indent << " *\n"
+                << indent << " * @param xStart  The x-coordinate of the first "
+                << "pixel to copy.\n"
+                << indent << " *\n"
+                << indent << " * @param count   The number of pixels to copy.\n"
+                << indent << " *\n"
+                << indent << " * @param dest    A buffer with room for count "
+                << "0xAARRGGBB color\n"
+                << indent << " *                values. Pixels outside of the "
+                << "image bounds are\n"
+                << indent << " *                set to zero.\n"
+                << indent << " */\n"
+                << indent << "static void readRow(const size_t y, "
+                << "const size_t xStart,\n"
+                << indent << "        const size_t count, uint32_t* dest);\n";
         indent.erase(indent.length() / 2);
         header << indent << "};\n}";
     };
 
     // Write image source:
-    const auto writeSrc = [&imageData, &colorList, &baseName, width, height]
+    const auto writeSrc = [&imageData, &colorList, &baseName, indexBits]
     (std::ofstream& source)
     {
         const int size = colorList.size();
-        source << "#include \"" << baseName << ".h\"\n\n"
-                << "// All image colors, as an array of RGBA color "
-                << "components.\n"
-                << "static const constexpr unsigned char colors ["
-                << size << "][4] =\n{";
-        for (int i = 0; i < size; i++)
-        {
-            if (i > 0)
+        source << "#include \"" << baseName << ".h\"\n\n";
+        if (indexBits > 0)
+        {
+            source << "// All image colors, as 0xAARRGGBB color values.\n"
+                    << "static const constexpr uint32_t colors ["
+                    << size << "] =\n{";
+            for (int i = 0; i < size; i++)
             {
-                source << ',';
+                const uint32_t color
+                        = (static_cast<uint32_t>(colorList[i].alpha) << 24)
+                        | (colorList[i].red << 16) | (colorList[i].green << 8)
+                        | colorList[i].blue;
+                source << ((i % 6 == 0) ? ((i > 0) ? ",\n    " : "\n    ")
+                        : ", ") << "0x";
+                for (int shift = 28; shift >= 0; shift -= 4)
+                {
+                    source << "0123456789abcdef"[(color >> shift) & 0xf];
+                }
             }
-            source << "\n    {" <<  (int) colorList[i].red << ", "
-                    << (int) colorList[i].green << ", "
-                    << (int) colorList[i].blue << ", "
-                    << (int) colorList[i].alpha << "}";
-        }
-        source << "\n};\n\n// All image data, stored in a string of color"
-                << " indices starting at index 'a'.\n";
-        const std::string dataDeclaration
-                = "static const constexpr char* imageData = ";
-        const std::string indent(dataDeclaration.length(), ' ');
-        source << dataDeclaration;
-        for (int i = 0; i < imageData.length(); i += width)
-        {
-            if (i > 0)
+            source << "\n};\n\n";
+        }
+
+        // Describe and declare the image data array:
+        const int digits = (indexBits == 0) ? 8
+                : ((indexBits == 16) ? 4 : 2);
+        if (indexBits == 0)
+        {
+            source << "// All image data, stored as one 0xAARRGGBB color "
+                    << "value per pixel.\n"
+                    << "static const constexpr uint32_t";
+        }
+        else if (indexBits == 16)
+        {
+            source << "// All image data, stored as one 16-bit color index "
+                    << "per pixel.\n"
+                    << "static const constexpr uint16_t";
+        }
+        else if (indexBits == 8)
+        {
+            source << "// All image data, stored as one 8-bit color index "
+                    << "per pixel.\n"
+                    << "static const constexpr unsigned char";
+        }
+        else
+        {
+            source << "// All image data, stored as " << indexBits
+                    << "-bit color indices packed " << (8 / indexBits)
+                    << " to a byte,\n// starting with the lowest bits.\n"
+                    << "static const constexpr unsigned char";
+        }
+        source << " imageData [" << imageData.size() << "] =\n{";
+
+        // Write values in hexadecimal, with as many as fit on each line:
+        const size_t valuesPerLine = 76 / (digits + 4);
+        const char* const hexDigits = "0123456789abcdef";
+        std::string line;
+        for (size_t i = 0; i < imageData.size(); i++)
+        {
+            if (i % valuesPerLine == 0)
             {
-                source << "\n" << indent;
+                line += (i > 0) ? ",\n    " : "\n    ";
             }
-            const std::string dataRow = imageData.substr(i, width);
-            source << "\"" << dataRow << "\"";
+            else
+            {
+                line += ", ";
+            }
+            line += "0x";
+            for (int shift = (digits - 1) * 4; shift >= 0; shift -= 4)
+            {
+                line += hexDigits[(imageData[i] >> shift) & 0xf];
+            }
+            if (line.size() > 4096)
+            {
+                source << line;
+                line.clear();
+            }
+        }
+        source << line << "\n};\n\n";
+
+        // Write the expression that finds the color of the pixel at
+        // pixelIdx, shared by getColor and readRow:
+        string colorValue;
+        if (indexBits == 0)
+        {
+            colorValue = "imageData[pixelIdx]";
+        }
+        else if (indexBits >= 8)
+        {
+            colorValue = "colors[imageData[pixelIdx]]";
         }
-        source << ";\n\n// Gets the color of an image pixel.\n"
+        else
+        {
+            const size_t indicesPerByte = 8 / indexBits;
+            colorValue = "colors[(imageData[pixelIdx / "
+                    + std::to_string(indicesPerByte) + "]\n"
+                    + "                >> ((pixelIdx % "
+                    + std::to_string(indicesPerByte) + ") * "
+                    + std::to_string(indexBits) + ")) & "
+                    + std::to_string((1 << indexBits) - 1) + "]";
+        }
+        source << "// Gets the color of an image pixel.\n"
                 << "FBPainter::RGBAPixel FBPainter::" << baseName
                 << "::getColor\n"
                 << "(const size_t x, const size_t y)\n{\n"
                 << "    if (x >= width || y >= height)\n    {\n"
                 << "        return RGBAPixel();\n    }\n"
-                << "    size_t charIdx = y * width + x;\n"
-                << "    size_t idx = imageData[charIdx] - 'a';\n"
-                << "    return RGBAPixel(colors[idx][0], colors[idx][1], "
-                << "colors[idx][2],\n            colors[idx][3]);\n}";
+                << "    const size_t pixelIdx = y * width + x;\n"
+                << "    const uint32_t color = " << colorValue << ";\n"
+                << "    return RGBAPixel(color >> 16, color >> 8, color, "
+                << "color >> 24);\n}\n\n"
+                << "// Copies a run of pixels from one image row.\n"
+                << "void FBPainter::" << baseName << "::readRow\n"
+                << "(const size_t y, const size_t xStart, const size_t count, "
+                << "uint32_t* dest)\n{\n"
+                << "    size_t inBounds = 0;\n"
+                << "    if (y < height && xStart < width)\n    {\n"
+                << "        inBounds = (count < width - xStart) ? count "
+                << ": (width - xStart);\n    }\n"
+                << "    size_t pixelIdx = y * width + xStart;\n"
+                << "    for (size_t i = 0; i < inBounds; i++, pixelIdx++)\n"
+                << "    {\n"
+                << "        dest[i] = " << colorValue << ";\n    }\n"
+                << "    for (size_t i = inBounds; i < count; i++)\n    {\n"
+                << "        dest[i] = 0;\n    }\n}";
     };
 
     if (! writeFile(headerPath, writeHeader))
@@ -225,17 +417,292 @@ bool testEncode(const std::string& imgPath)
 }
 
 
-// Converts a single image, passed in as a command line argument.
+/**
+ * @brief  Creates a raw image file for a single .png image.
+ *
+ *  The created file shares the name and path of the image, with the file
+ * extension changed to .fbraw. It holds premultiplied pixels and an alpha
+ * run index, laid out as described in RawImageFormat.h, so that
+ * FBPainter::RawImage can map it and use it without decoding.
+ *
+ * @param imgPath  The path to a .png image file.
+ *
+ * @return         Whether the image was encoded successfully.
+ */
+bool rawEncode(const std::string& imgPath)
+{
+    namespace Format = FBPainter::RawImageFormat;
+    Image src;
+    try
+    {
+        src.read(imgPath);
+    }
+    catch (const png::std_error& e)
+    {
+        std::cerr << "Error reading \"" << imgPath << "\":" << e.what()
+                << "\n";
+        return false;
+    }
+    const size_t width = src.get_width();
+    const size_t height = src.get_height();
+    const size_t stride = (width * sizeof(uint32_t) + Format::rowAlignment - 1)
+            / Format::rowAlignment * Format::rowAlignment;
+
+    // Convert pixels, and find the alpha runs in each row:
+    std::vector<uint32_t> pixels(stride / sizeof(uint32_t) * height, 0);
+    std::vector<uint32_t> rowRuns;
+    std::vector<FBPainter::PixelRun> runs;
+    for (size_t y = 0; y < height; y++)
+    {
+        rowRuns.push_back(runs.size());
+        for (size_t x = 0; x < width; x++)
+        {
+            const Pixel pixel = src.get_pixel(x, y);
+            pixels[y * stride / sizeof(uint32_t) + x]
+                    = FBPainter::premultiplyColor(pixel.red, pixel.green,
+                            pixel.blue, pixel.alpha);
+            const FBPainter::RunType type = (pixel.alpha == 0)
+                    ? FBPainter::RunType::Transparent
+                    : ((pixel.alpha == 255) ? FBPainter::RunType::Opaque
+                    : FBPainter::RunType::Blended);
+            if (x > 0 && runs.back().type == type)
+            {
+                runs.back().length++;
+            }
+            else
+            {
+                runs.push_back({ static_cast<uint32_t>(x), 1, type });
+            }
+        }
+    }
+    rowRuns.push_back(runs.size());
+
+    Format::Header header = {};
+    std::copy(Format::magic, Format::magic + sizeof(Format::magic),
+            header.magic);
+    header.version = Format::version;
+    header.width = width;
+    header.height = height;
+    header.stride = stride;
+    header.pixelLayout
+            = static_cast<uint32_t>(Format::PixelLayout::PremultipliedARGB);
+    header.runCount = runs.size();
+    header.pixelOffset = Format::rowAlignment;
+    header.runIndexOffset = header.pixelOffset + stride * height;
+
+    const size_t extensionIdx = imgPath.rfind(".");
+    const std::string rawPath = imgPath.substr(0, extensionIdx) + ".fbraw";
+    std::ofstream outFile(rawPath, std::ios::binary);
+    if (! outFile.is_open())
+    {
+        std::cerr << "Couldn't open \"" << rawPath << "\" for writing.\n";
+        return false;
+    }
+    const std::vector<char> padding(header.pixelOffset - sizeof(header), 0);
+    outFile.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    outFile.write(padding.data(), padding.size());
+    outFile.write(reinterpret_cast<const char*>(pixels.data()),
+            pixels.size() * sizeof(uint32_t));
+    outFile.write(reinterpret_cast<const char*>(rowRuns.data()),
+            rowRuns.size() * sizeof(uint32_t));
+    outFile.write(reinterpret_cast<const char*>(runs.data()),
+            runs.size() * sizeof(FBPainter::PixelRun));
+    outFile.close();
+    if (! outFile)
+    {
+        std::cerr << "Error when writing to \"" << rawPath << "\"\n";
+        return false;
+    }
+    std::cout << "Finished writing to \"" << rawPath << "\"\n";
+    return true;
+}
+
+
+/**
+ * @brief  Creates a QOI image file for a single .png image.
+ *
+ *  The created file shares the name and path of the image, with the file
+ * extension changed to .qoi. It's laid out as described in QoiFormat.h, so
+ * that FBPainter::QoiImage can decode it without libpng.
+ *
+ * @param imgPath  The path to a .png image file.
+ *
+ * @return         Whether the image was encoded successfully.
+ */
+bool qoiEncode(const std::string& imgPath)
+{
+    namespace Format = FBPainter::QoiFormat;
+    Image src;
+    try
+    {
+        src.read(imgPath);
+    }
+    catch (const png::std_error& e)
+    {
+        std::cerr << "Error reading \"" << imgPath << "\":" << e.what()
+                << "\n";
+        return false;
+    }
+    const uint32_t width = src.get_width();
+    const uint32_t height = src.get_height();
+    bool opaque = true;
+    for (uint32_t y = 0; y < height && opaque; y++)
+    {
+        for (uint32_t x = 0; x < width && opaque; x++)
+        {
+            opaque = (src.get_pixel(x, y).alpha == 255);
+        }
+    }
+
+    std::vector<uint8_t> data(Format::magic,
+            Format::magic + sizeof(Format::magic));
+    for (const uint32_t size : { width, height })
+    {
+        for (int shift = 24; shift >= 0; shift -= 8)
+        {
+            data.push_back(size >> shift);
+        }
+    }
+    data.push_back(opaque ? 3 : 4);
+    // All channels are sRGB, with linear alpha:
+    data.push_back(0);
+
+    // Encode each pixel as the smallest chunk that reproduces it:
+    uint8_t recentColors[Format::indexSize][4] = {};
+    uint8_t last[4] = { 0, 0, 0, 255 };
+    size_t runLength = 0;
+    for (uint32_t y = 0; y < height; y++)
+    {
+        for (uint32_t x = 0; x < width; x++)
+        {
+            const Pixel pixel = src.get_pixel(x, y);
+            const uint8_t color[4]
+                    = { pixel.red, pixel.green, pixel.blue, pixel.alpha };
+            if (std::equal(color, color + 4, last))
+            {
+                runLength++;
+                if (runLength == Format::maxRun)
+                {
+                    data.push_back(Format::tagRun | (runLength - 1));
+                    runLength = 0;
+                }
+                continue;
+            }
+            if (runLength > 0)
+            {
+                data.push_back(Format::tagRun | (runLength - 1));
+                runLength = 0;
+            }
+            const size_t hash = Format::colorHash(color[0], color[1],
+                    color[2], color[3]);
+            if (std::equal(color, color + 4, recentColors[hash]))
+            {
+                data.push_back(Format::tagIndex | hash);
+            }
+            else if (color[3] != last[3])
+            {
+                data.push_back(Format::tagRGBA);
+                data.insert(data.end(), color, color + 4);
+            }
+            else
+            {
+                const int8_t redDiff = color[0] - last[0];
+                const int8_t greenDiff = color[1] - last[1];
+                const int8_t blueDiff = color[2] - last[2];
+                const int8_t redGreenDiff = redDiff - greenDiff;
+                const int8_t blueGreenDiff = blueDiff - greenDiff;
+                if (redDiff >= -2 && redDiff <= 1 && greenDiff >= -2
+                        && greenDiff <= 1 && blueDiff >= -2 && blueDiff <= 1)
+                {
+                    data.push_back(Format::tagDiff | ((redDiff + 2) << 4)
+                            | ((greenDiff + 2) << 2) | (blueDiff + 2));
+                }
+                else if (greenDiff >= -32 && greenDiff <= 31
+                        && redGreenDiff >= -8 && redGreenDiff <= 7
+                        && blueGreenDiff >= -8 && blueGreenDiff <= 7)
+                {
+                    data.push_back(Format::tagLuma | (greenDiff + 32));
+                    data.push_back(((redGreenDiff + 8) << 4)
+                            | (blueGreenDiff + 8));
+                }
+                else
+                {
+                    data.push_back(Format::tagRGB);
+                    data.insert(data.end(), color, color + 3);
+                }
+            }
+            std::copy(color, color + 4, recentColors[hash]);
+            std::copy(color, color + 4, last);
+        }
+    }
+    if (runLength > 0)
+    {
+        data.push_back(Format::tagRun | (runLength - 1));
+    }
+    data.insert(data.end(), Format::endMarker,
+            Format::endMarker + sizeof(Format::endMarker));
+
+    const size_t extensionIdx = imgPath.rfind(".");
+    const std::string qoiPath = imgPath.substr(0, extensionIdx) + ".qoi";
+    std::ofstream outFile(qoiPath, std::ios::binary);
+    if (! outFile.is_open())
+    {
+        std::cerr << "Couldn't open \"" << qoiPath << "\" for writing.\n";
+        return false;
+    }
+    outFile.write(reinterpret_cast<const char*>(data.data()), data.size());
+    outFile.close();
+    if (! outFile)
+    {
+        std::cerr << "Error when writing to \"" << qoiPath << "\"\n";
+        return false;
+    }
+    std::cout << "Finished writing to \"" << qoiPath << "\"\n";
+    return true;
+}
+
+
+// Converts a single image, passed in as a command line argument. Animation
+// strips or sheets also pass in the frame width, and optionally the frame
+// height and frame count. Passing --raw or --qoi first creates a raw image
+// file or a QOI image file instead of C++ source code.
 int main(int argc, char** argv)
 {
-    if (argc < 2)
+    const std::string option = (argc > 1) ? argv[1] : "";
+    const bool raw = (option == "--raw");
+    const bool qoi = (option == "--qoi");
+    const int firstArg = (raw || qoi) ? 2 : 1;
+    if (argc <= firstArg)
     {
         std::cerr << "No image given!\n";
+        std::cerr << "Usage: ImageEncoder image.png [frameWidth [frameHeight"
+                << " [frameCount]]]\n"
+                << "       ImageEncoder --raw image.png\n"
+                << "       ImageEncoder --qoi image.png\n";
         return 1;
     }
-    const std::string imagePath(argv[1]);
+    const std::string imagePath(argv[firstArg]);
+    size_t frameSize[3] = { 0, 0, 0 };
+    for (int i = firstArg + 1; i < argc && i < firstArg + 4; i++)
+    {
+        frameSize[i - firstArg - 1] = std::strtoul(argv[i], nullptr, 10);
+    }
 
-    if (testEncode(imagePath))
+    bool encoded;
+    if (raw)
+    {
+        encoded = rawEncode(imagePath);
+    }
+    else if (qoi)
+    {
+        encoded = qoiEncode(imagePath);
+    }
+    else
+    {
+        encoded = testEncode(imagePath, frameSize[0], frameSize[1],
+                frameSize[2]);
+    }
+    if (encoded)
     {
         std::cout << "Encoded image \"" << imagePath << "\"\n";
         return 0;
@@ -0,0 +1,242 @@
+#include "AnimatedImage.h"
+#include <algorithm>
+#include <memory>
+#include <new>
+
+// Loads every frame from a sheet image on construction.
+FBPainter::AnimatedImage::AnimatedImage(Image* sheet, const size_t frameWidth,
+        const size_t frameHeight, const size_t frameCount)
+{
+    const std::unique_ptr<Image> sheetImage(sheet);
+    if (sheet == nullptr || frameWidth == 0 || frameHeight == 0)
+    {
+        return;
+    }
+    const size_t columns = sheet->getWidth() / frameWidth;
+    const size_t sheetFrames = columns * (sheet->getHeight() / frameHeight);
+    const size_t count = (frameCount == 0 || frameCount > sheetFrames)
+            ? sheetFrames : frameCount;
+    if (count == 0)
+    {
+        return;
+    }
+    const auto loadFrame = [&](const size_t frame,
+            std::vector<uint32_t>& pixels)
+    {
+        const size_t xStart = (frame % columns) * frameWidth;
+        const size_t yStart = (frame / columns) * frameHeight;
+        for (size_t y = 0; y < frameHeight; y++)
+        {
+            uint32_t* const row = pixels.data() + y * frameWidth;
+            sheet->readRow(yStart + y, xStart, frameWidth, row,
+                    RowFormat::ARGB);
+            for (size_t x = 0; x < frameWidth; x++)
+            {
+                if ((row[x] >> 24) != 0)
+                {
+                    firstCoveredColumns[y]
+                            = std::min(firstCoveredColumns[y], x);
+                    lastCoveredColumns[y]
+                            = std::max(lastCoveredColumns[y], x);
+                }
+            }
+        }
+    };
+    try
+    {
+        firstCoveredColumns.assign(frameHeight, frameWidth);
+        lastCoveredColumns.assign(frameHeight, 0);
+        framePixels.resize(frameWidth * frameHeight);
+        deltas.resize(count);
+        width = frameWidth;
+        height = frameHeight;
+        loadFrame(0, framePixels);
+        // Only the previous frame is kept while finding each frame's
+        // changes:
+        std::vector<uint32_t> previous = framePixels;
+        std::vector<uint32_t> next(framePixels.size());
+        for (size_t frame = 1; frame < count; frame++)
+        {
+            loadFrame(frame, next);
+            deltas[frame] = findChanges(previous, next);
+            previous.swap(next);
+        }
+        deltas[0] = findChanges(previous, framePixels);
+    }
+    catch (const std::bad_alloc&)
+    {
+        width = 0;
+        height = 0;
+        framePixels.clear();
+        deltas.clear();
+        firstCoveredColumns.clear();
+        lastCoveredColumns.clear();
+    }
+}
+
+
+// Gets the width of each frame.
+size_t FBPainter::AnimatedImage::getWidth() const
+{
+    return width;
+}
+
+
+// Gets the height of each frame.
+size_t FBPainter::AnimatedImage::getHeight() const
+{
+    return height;
+}
+
+
+// Gets pixel color data from the current frame.
+FBPainter::RGBPixel FBPainter::AnimatedImage::getRGBPixel(const size_t xPos,
+        const size_t yPos) const
+{
+    if (xPos >= width || yPos >= height)
+    {
+        return RGBPixel(0, 0, 0);
+    }
+    const uint32_t pixel = framePixels[yPos * width + xPos];
+    return RGBPixel(pixel >> 16, pixel >> 8, pixel);
+}
+
+
+// Gets pixel color data from the current frame.
+FBPainter::RGBAPixel FBPainter::AnimatedImage::getRGBAPixel(const size_t xPos,
+        const size_t yPos) const
+{
+    if (xPos >= width || yPos >= height)
+    {
+        return RGBAPixel(0, 0, 0, 0);
+    }
+    const uint32_t pixel = framePixels[yPos * width + xPos];
+    return RGBAPixel(pixel >> 16, pixel >> 8, pixel, pixel >> 24);
+}
+
+
+// Copies a run of pixels from one row of the current frame.
+void FBPainter::AnimatedImage::readRow(const size_t yPos, const size_t xStart,
+        const size_t count, uint32_t* dest, const RowFormat format) const
+{
+    const size_t inBounds = (yPos < height && xStart < width)
+            ? std::min(count, width - xStart) : 0;
+    if (inBounds > 0)
+    {
+        const uint32_t* row = framePixels.data() + yPos * width + xStart;
+        if (format == RowFormat::ARGB)
+        {
+            std::copy(row, row + inBounds, dest);
+        }
+        else
+        {
+            for (size_t i = 0; i < inBounds; i++)
+            {
+                dest[i] = premultiplyColor(row[i] >> 16, row[i] >> 8, row[i],
+                        row[i] >> 24);
+            }
+        }
+    }
+    std::fill(dest + inBounds, dest + count, 0);
+}
+
+
+// Gets the number of animation frames.
+size_t FBPainter::AnimatedImage::getFrameCount() const
+{
+    return deltas.size();
+}
+
+
+// Gets the index of the current frame.
+size_t FBPainter::AnimatedImage::getFrame() const
+{
+    return currentFrame;
+}
+
+
+// Selects the current frame, applying the changes from every frame between
+// it and the old current frame.
+void FBPainter::AnimatedImage::setFrame(const size_t frame)
+{
+    if (deltas.empty())
+    {
+        return;
+    }
+    const size_t target = frame % deltas.size();
+    while (currentFrame != target)
+    {
+        currentFrame = (currentFrame + 1) % deltas.size();
+        const FrameDelta& delta = deltas[currentFrame];
+        const uint32_t* source = delta.pixels.data();
+        for (const Rectangle& span : delta.spans)
+        {
+            std::copy(source, source + span.getWidth(), framePixels.begin()
+                    + span.getTop() * width + span.getLeft());
+            source += span.getWidth();
+        }
+    }
+}
+
+
+// Gets the areas that change when the animation reaches a frame from the
+// frame before it.
+const std::vector<FBPainter::Rectangle>&
+FBPainter::AnimatedImage::getFrameChanges(const size_t frame) const
+{
+    static const std::vector<Rectangle> noChanges;
+    if (deltas.empty())
+    {
+        return noChanges;
+    }
+    return deltas[frame % deltas.size()].spans;
+}
+
+
+// Gets the first column of each row that is non-transparent in any frame.
+const std::vector<size_t>& FBPainter::AnimatedImage::getFirstCoveredColumns()
+        const
+{
+    return firstCoveredColumns;
+}
+
+
+// Gets the last column of each row that is non-transparent in any frame.
+const std::vector<size_t>& FBPainter::AnimatedImage::getLastCoveredColumns()
+        const
+{
+    return lastCoveredColumns;
+}
+
+
+// Finds the changes between two complete frames.
+FBPainter::AnimatedImage::FrameDelta FBPainter::AnimatedImage::findChanges
+(const std::vector<uint32_t>& oldFrame, const std::vector<uint32_t>& newFrame)
+        const
+{
+    FrameDelta delta;
+    for (size_t y = 0; y < height; y++)
+    {
+        const size_t rowStart = y * width;
+        size_t x = 0;
+        while (x < width)
+        {
+            if (oldFrame[rowStart + x] == newFrame[rowStart + x])
+            {
+                x++;
+                continue;
+            }
+            const size_t spanStart = x;
+            while (x < width
+                    && oldFrame[rowStart + x] != newFrame[rowStart + x])
+            {
+                x++;
+            }
+            delta.spans.push_back(Rectangle(spanStart, y, x - spanStart, 1));
+            delta.pixels.insert(delta.pixels.end(),
+                    newFrame.begin() + rowStart + spanStart,
+                    newFrame.begin() + rowStart + x);
+        }
+    }
+    return delta;
+}
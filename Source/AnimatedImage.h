@@ -0,0 +1,204 @@
+/**
+ * @file  AnimatedImage.h
+ *
+ * @brief  An image holding a sequence of animation frames, stored as the
+ *         changes between consecutive frames.
+ */
+
+#pragma once
+#include "Image.h"
+#include "Rectangle.h"
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+namespace FBPainter
+{
+    class AnimatedImage;
+}
+
+/**
+ * @brief  Splits a strip or sheet image into equally sized animation frames.
+ *
+ *  Only the current frame is stored in full. Every other frame is stored as
+ * the spans of pixels that changed since the frame before it, and the first
+ * frame is stored as the changes from the last frame, so the animation can
+ * loop. As an Image, the animation always reports the pixels of its current
+ * frame.
+ *
+ *  Frames may be loaded from any image. A strip or sheet in a PNG file can
+ * be loaded through PngImage, and data produced by ImageEncoder can be loaded
+ * through CodeImage:
+ *
+ *      new AnimatedImage(new PngImage("spinner.png"), 32, 32);
+ *      new AnimatedImage(new CodeImage<Spinner>(), Spinner::frameWidth,
+ *              Spinner::frameHeight, Spinner::frameCount);
+ */
+class FBPainter::AnimatedImage : public Image
+{
+public:
+    /**
+     * @brief  Loads every frame from a sheet image on construction.
+     *
+     * @param sheet        An image holding all frames. Frames are read from
+     *                     left to right, then from top to bottom. The sheet is
+     *                     deleted once all frames are loaded.
+     *
+     * @param frameWidth   The width of each frame in pixels.
+     *
+     * @param frameHeight  The height of each frame in pixels.
+     *
+     * @param frameCount   The number of frames to load, or zero to load every
+     *                     whole frame within the sheet.
+     */
+    AnimatedImage(Image* sheet, const size_t frameWidth,
+            const size_t frameHeight, const size_t frameCount = 0);
+
+    virtual ~AnimatedImage() { }
+
+    /**
+     * @brief  Gets the width of each frame.
+     *
+     * @return  The frame width in pixels, or zero if no frames were loaded.
+     */
+    size_t getWidth() const override;
+
+    /**
+     * @brief  Gets the height of each frame.
+     *
+     * @return  The frame height in pixels, or zero if no frames were loaded.
+     */
+    size_t getHeight() const override;
+
+    /**
+     * @brief  Gets pixel color data from the current frame.
+     *
+     * @param xPos  The pixel's x-coordinate.
+     *
+     * @param yPos  The pixel's y-coordinate.
+     *
+     * @return      The pixel value at the given coordinate, or
+     *              RGBPixel(0, 0, 0) if the coordinate is out of bounds.
+     */
+    RGBPixel getRGBPixel(const size_t xPos, const size_t yPos) const override;
+
+    /**
+     * @brief  Gets pixel color data from the current frame.
+     *
+     * @param xPos  The pixel's x-coordinate.
+     *
+     * @param yPos  The pixel's y-coordinate.
+     *
+     * @return      The pixel value at the given coordinate, or
+     *              RGBAPixel(0, 0, 0, 0) if the coordinate is out of bounds.
+     */
+    RGBAPixel getRGBAPixel(const size_t xPos, const size_t yPos)
+            const override;
+
+    /**
+     * @brief  Copies a run of pixels from one row of the current frame.
+     *
+     * @param yPos    The y-coordinate of the row to read.
+     *
+     * @param xStart  The x-coordinate of the first pixel to read.
+     *
+     * @param count   The number of pixels to read.
+     *
+     * @param dest    A buffer with room for count pixel values. Pixels
+     *                outside of the image bounds are set to zero.
+     *
+     * @param format  The layout of the pixel values written to dest.
+     */
+    void readRow(const size_t yPos, const size_t xStart, const size_t count,
+            uint32_t* dest, const RowFormat format) const override;
+
+    /**
+     * @brief  Gets the number of animation frames.
+     *
+     * @return  The number of frames loaded from the sheet.
+     */
+    size_t getFrameCount() const;
+
+    /**
+     * @brief  Gets the index of the current frame.
+     *
+     * @return  The frame used for all pixel data.
+     */
+    size_t getFrame() const;
+
+    /**
+     * @brief  Selects the current frame, applying the changes from every
+     *         frame between it and the old current frame.
+     *
+     * @param frame  The new frame index. Indices past the last frame wrap
+     *               around to the start of the animation.
+     */
+    void setFrame(const size_t frame);
+
+    /**
+     * @brief  Gets the areas that change when the animation reaches a frame
+     *         from the frame before it.
+     *
+     * @param frame  A frame index. The changes for frame zero are the
+     *               changes from the last frame.
+     *
+     * @return       Spans of changed pixels, each one row tall, in image
+     *               coordinates.
+     */
+    const std::vector<Rectangle>& getFrameChanges(const size_t frame) const;
+
+    /**
+     * @brief  Gets the first column of each row that is non-transparent in
+     *         any frame.
+     *
+     * @return  The first covered x-coordinate in each row, or the frame
+     *          width in rows that are transparent in every frame.
+     */
+    const std::vector<size_t>& getFirstCoveredColumns() const;
+
+    /**
+     * @brief  Gets the last column of each row that is non-transparent in
+     *         any frame.
+     *
+     * @return  The last covered x-coordinate in each row, or zero in rows
+     *          that are transparent in every frame.
+     */
+    const std::vector<size_t>& getLastCoveredColumns() const;
+
+private:
+    /**
+     * @brief  The changes from one frame to the next.
+     */
+    struct FrameDelta
+    {
+        // Spans of changed pixels:
+        std::vector<Rectangle> spans;
+        // New 0xAARRGGBB values for every pixel in each span, in order:
+        std::vector<uint32_t> pixels;
+    };
+
+    /**
+     * @brief  Finds the changes between two complete frames.
+     *
+     * @param oldFrame  The earlier frame's 0xAARRGGBB pixels.
+     *
+     * @param newFrame  The later frame's 0xAARRGGBB pixels.
+     *
+     * @return          The spans that differ, with their new pixel values.
+     */
+    FrameDelta findChanges(const std::vector<uint32_t>& oldFrame,
+            const std::vector<uint32_t>& newFrame) const;
+
+    // Frame dimensions:
+    size_t width = 0;
+    size_t height = 0;
+    // The current frame index:
+    size_t currentFrame = 0;
+    // The current frame's pixels as 0xAARRGGBB values, stored row by row:
+    std::vector<uint32_t> framePixels;
+    // The changes that produce each frame from the one before it:
+    std::vector<FrameDelta> deltas;
+    // The range of columns in each row that any frame covers:
+    std::vector<size_t> firstCoveredColumns;
+    std::vector<size_t> lastCoveredColumns;
+};
@@ -0,0 +1,150 @@
+#include "AsyncImagePainter.h"
+#include "DrawContext.h"
+
+
+// Prepares to draw a loading image.
+FBPainter::AsyncImagePainter::AsyncImagePainter
+(const std::shared_ptr<ImageLoader::Handle>& handle,
+        const std::shared_ptr<const Image>& placeholder) : handle(handle)
+{
+    if (placeholder != nullptr)
+    {
+        placeholderPainter.reset(new ImagePainter(placeholder));
+    }
+    checkImage();
+}
+
+
+// Checks if the loaded image is being used.
+bool FBPainter::AsyncImagePainter::isReady() const
+{
+    return imagePainter != nullptr;
+}
+
+
+// Gets the painter currently in use.
+FBPainter::ImagePainter* FBPainter::AsyncImagePainter::getPainter() const
+{
+    return (imagePainter != nullptr) ? imagePainter.get()
+            : placeholderPainter.get();
+}
+
+
+// Sets the origin used to draw both the image and the placeholder, without
+// updating the frame buffer.
+void FBPainter::AsyncImagePainter::setImageOrigin(const int xPos,
+        const int yPos)
+{
+    xOrigin = xPos;
+    yOrigin = yPos;
+    ImagePainter* const painter = getPainter();
+    if (painter != nullptr)
+    {
+        painter->setImageOrigin(xPos, yPos);
+    }
+}
+
+
+// Sets the origin used to draw both the image and the placeholder, moving
+// whichever is drawn.
+void FBPainter::AsyncImagePainter::setImageOrigin(const int xPos,
+        const int yPos, DrawContext& context)
+{
+    xOrigin = xPos;
+    yOrigin = yPos;
+    ImagePainter* const painter = getPainter();
+    if (painter == nullptr)
+    {
+        return;
+    }
+    if (drawn)
+    {
+        painter->setImageOrigin(xPos, yPos, context);
+    }
+    else
+    {
+        painter->setImageOrigin(xPos, yPos);
+    }
+}
+
+
+// Checks if the image has finished loading, and replaces the placeholder with
+// the image if it has.
+bool FBPainter::AsyncImagePainter::update(DrawContext& context)
+{
+    if (! checkImage())
+    {
+        return false;
+    }
+    const std::unique_ptr<ImagePainter> placeholder
+            = std::move(placeholderPainter);
+    if (! drawn)
+    {
+        return false;
+    }
+    if (placeholder != nullptr)
+    {
+        placeholder->clearImage(context);
+    }
+    imagePainter->drawImage(context);
+    return true;
+}
+
+
+// Draws the image if it's ready, or the placeholder if it isn't.
+void FBPainter::AsyncImagePainter::drawImage(DrawContext& context)
+{
+    drawn = true;
+    if (checkImage() && placeholderPainter != nullptr)
+    {
+        // A placeholder drawn earlier must be cleared before it's replaced:
+        placeholderPainter->clearImage(context);
+        placeholderPainter.reset();
+    }
+    ImagePainter* const painter = getPainter();
+    if (painter != nullptr)
+    {
+        painter->drawImage(context);
+    }
+}
+
+
+// Clears the drawn image or placeholder.
+void FBPainter::AsyncImagePainter::clearImage(DrawContext& context)
+{
+    drawn = false;
+    ImagePainter* const painter = getPainter();
+    if (painter != nullptr)
+    {
+        painter->clearImage(context);
+    }
+}
+
+
+// Cancels loading the image if it isn't ready.
+void FBPainter::AsyncImagePainter::cancel()
+{
+    if (handle != nullptr)
+    {
+        handle->cancel();
+    }
+}
+
+
+// Creates the image's painter if the image has become ready.
+bool FBPainter::AsyncImagePainter::checkImage()
+{
+    if (imagePainter != nullptr || handle == nullptr || ! handle->isReady())
+    {
+        return false;
+    }
+    imagePainter.reset(new ImagePainter(handle->getImage()));
+    imagePainter->setImageOrigin(xOrigin, yOrigin);
+    // A placeholder that isn't drawn has nothing to clear, and is never used
+    // again:
+    if (! drawn)
+    {
+        placeholderPainter.reset();
+    }
+    return true;
+}
@@ -0,0 +1,135 @@
+/**
+ * @file  AsyncImagePainter.h
+ *
+ * @brief  Draws an image that's still being loaded in the background, showing
+ *         a placeholder until it's ready.
+ */
+
+#pragma once
+#include "ImageLoader.h"
+#include "ImagePainter.h"
+#include <memory>
+
+namespace FBPainter
+{
+    class AsyncImagePainter;
+    class DrawContext;
+}
+
+/**
+ * @brief  Draws an ImageLoader job's image once it's decoded, and an optional
+ *         placeholder image until then.
+ *
+ *  The painter never waits for its image. Instead, update should be called
+ * regularly from the drawing thread, such as once per frame. Once the image
+ * is ready, update replaces a drawn placeholder with the image. The loader
+ * has already prepared the image's pixels and runs by then, so the image's
+ * painter is created without reading every pixel on the drawing thread.
+ */
+class FBPainter::AsyncImagePainter
+{
+public:
+    /**
+     * @brief  Prepares to draw a loading image.
+     *
+     * @param handle       The handle of the job loading the image.
+     *
+     * @param placeholder  An optional image drawn at the same origin until
+     *                     the image is ready, or nullptr to draw nothing
+     *                     until then.
+     */
+    AsyncImagePainter(const std::shared_ptr<ImageLoader::Handle>& handle,
+            const std::shared_ptr<const Image>& placeholder = nullptr);
+
+    virtual ~AsyncImagePainter() { }
+
+    /**
+     * @brief  Checks if the loaded image is being used.
+     *
+     * @return  Whether the image is ready, and is drawn in place of the
+     *          placeholder.
+     */
+    bool isReady() const;
+
+    /**
+     * @brief  Gets the painter currently in use.
+     *
+     * @return  The image's painter if the image is ready, or the
+     *          placeholder's painter if it isn't, or nullptr if neither is
+     *          available.
+     */
+    ImagePainter* getPainter() const;
+
+    /**
+     * @brief  Sets the origin used to draw both the image and the
+     *         placeholder, without updating the frame buffer.
+     *
+     * @param xPos  The new x-coordinate of the top left corner.
+     *
+     * @param yPos  The new y-coordinate of the top left corner.
+     */
+    void setImageOrigin(const int xPos, const int yPos);
+
+    /**
+     * @brief  Sets the origin used to draw both the image and the
+     *         placeholder, moving whichever is drawn.
+     *
+     * @param xPos     The new x-coordinate of the top left corner.
+     *
+     * @param yPos     The new y-coordinate of the top left corner.
+     *
+     * @param context  The draw context used to update the drawn image.
+     */
+    void setImageOrigin(const int xPos, const int yPos, DrawContext& context);
+
+    /**
+     * @brief  Checks if the image has finished loading, and replaces the
+     *         placeholder with the image if it has.
+     *
+     * @param context  The draw context used to redraw the painter, if it's
+     *                 drawn.
+     *
+     * @return         Whether the frame buffer changed.
+     */
+    bool update(DrawContext& context);
+
+    /**
+     * @brief  Draws the image if it's ready, or the placeholder if it isn't,
+     *         within a draw context's clipping rectangle.
+     *
+     * @param context  The draw context used to draw.
+     */
+    void drawImage(DrawContext& context);
+
+    /**
+     * @brief  Clears the drawn image or placeholder within a draw context's
+     *         clipping rectangle.
+     *
+     * @param context  The draw context used to clear.
+     */
+    void clearImage(DrawContext& context);
+
+    /**
+     * @brief  Cancels loading the image if it isn't ready. The placeholder
+     *         stays in use.
+     */
+    void cancel();
+
+private:
+    /**
+     * @brief  Creates the image's painter if the image has become ready.
+     *
+     * @return  Whether the image's painter was created.
+     */
+    bool checkImage();
+
+    std::shared_ptr<ImageLoader::Handle> handle;
+    // Paints the placeholder until the image is ready:
+    std::unique_ptr<ImagePainter> placeholderPainter;
+    // Paints the image once it's ready:
+    std::unique_ptr<ImagePainter> imagePainter;
+    int xOrigin = 0;
+    int yOrigin = 0;
+    // Whether drawImage was called more recently than clearImage:
+    bool drawn = false;
+};
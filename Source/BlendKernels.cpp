@@ -0,0 +1,230 @@
+#include "BlendKernels.h"
+#if defined(__x86_64__) || defined(__i386__)
+    #include <immintrin.h>
+    #define FBP_BLEND_X86 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+    #include <arm_neon.h>
+    #define FBP_BLEND_NEON 1
+#endif
+
+/**
+ * @brief  Blends a run of premultiplied pixels over opaque colors.
+ *
+ * @param source  count premultiplied 0xAARRGGBB pixels.
+ *
+ * @param dest    count 0x00RRGGBB colors to replace with blended colors.
+ *
+ * @param count   The number of pixels to blend.
+ */
+typedef void (*BlendKernel)(const uint32_t* source, uint32_t* dest,
+        size_t count);
+
+
+// Blends pixels one at a time.
+static void blendScalar(const uint32_t* source, uint32_t* dest, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        dest[i] = FBPainter::blendPremultiplied(source[i], dest[i]);
+    }
+}
+
+
+#ifdef FBP_BLEND_X86
+// Blends four pixels with SSE4.1. The color components are widened to 16
+// bits, scaled by the inverse source alpha, divided by 255 with the same
+// rounding as divideBy255, then added to the source components.
+__attribute__((target("sse4.1")))
+static inline __m128i blendSSE41Vector(const __m128i source, const __m128i dest)
+{
+    // Copies each pixel's alpha byte into all four 16-bit lanes of the pixel:
+    const __m128i alphaLow = _mm_setr_epi8(3, -1, 3, -1, 3, -1, 3, -1,
+            7, -1, 7, -1, 7, -1, 7, -1);
+    const __m128i alphaHigh = _mm_setr_epi8(11, -1, 11, -1, 11, -1, 11, -1,
+            15, -1, 15, -1, 15, -1, 15, -1);
+    const __m128i maxComponent = _mm_set1_epi16(255);
+    const __m128i half = _mm_set1_epi16(128);
+    const __m128i colorMask = _mm_set1_epi32(0xffffff);
+
+    const __m128i inverseLow = _mm_sub_epi16(maxComponent,
+            _mm_shuffle_epi8(source, alphaLow));
+    const __m128i inverseHigh = _mm_sub_epi16(maxComponent,
+            _mm_shuffle_epi8(source, alphaHigh));
+    __m128i low = _mm_add_epi16(_mm_mullo_epi16(
+            _mm_cvtepu8_epi16(dest), inverseLow), half);
+    __m128i high = _mm_add_epi16(_mm_mullo_epi16(
+            _mm_unpackhi_epi8(dest, _mm_setzero_si128()), inverseHigh), half);
+    low = _mm_srli_epi16(_mm_add_epi16(low, _mm_srli_epi16(low, 8)), 8);
+    high = _mm_srli_epi16(_mm_add_epi16(high, _mm_srli_epi16(high, 8)), 8);
+    return _mm_and_si128(_mm_adds_epu8(source, _mm_packus_epi16(low, high)),
+            colorMask);
+}
+
+
+// Blends pixels with SSE4.1, eight pixels per iteration.
+__attribute__((target("sse4.1")))
+static void blendSSE41(const uint32_t* source, uint32_t* dest, size_t count)
+{
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        const __m128i* in = reinterpret_cast<const __m128i*>(source + i);
+        __m128i* out = reinterpret_cast<__m128i*>(dest + i);
+        const __m128i first = blendSSE41Vector(_mm_loadu_si128(in),
+                _mm_loadu_si128(out));
+        const __m128i second = blendSSE41Vector(_mm_loadu_si128(in + 1),
+                _mm_loadu_si128(out + 1));
+        _mm_storeu_si128(out, first);
+        _mm_storeu_si128(out + 1, second);
+    }
+    blendScalar(source + i, dest + i, count - i);
+}
+
+
+// Blends eight pixels with AVX2, using the same steps as blendSSE41Vector
+// within each 128-bit lane.
+__attribute__((target("avx2")))
+static inline __m256i blendAVX2Vector(const __m256i source, const __m256i dest)
+{
+    const __m256i alphaLow = _mm256_setr_epi8(3, -1, 3, -1, 3, -1, 3, -1,
+            7, -1, 7, -1, 7, -1, 7, -1, 3, -1, 3, -1, 3, -1, 3, -1,
+            7, -1, 7, -1, 7, -1, 7, -1);
+    const __m256i alphaHigh = _mm256_setr_epi8(11, -1, 11, -1, 11, -1, 11, -1,
+            15, -1, 15, -1, 15, -1, 15, -1, 11, -1, 11, -1, 11, -1, 11, -1,
+            15, -1, 15, -1, 15, -1, 15, -1);
+    const __m256i maxComponent = _mm256_set1_epi16(255);
+    const __m256i half = _mm256_set1_epi16(128);
+    const __m256i colorMask = _mm256_set1_epi32(0xffffff);
+    const __m256i zero = _mm256_setzero_si256();
+
+    const __m256i inverseLow = _mm256_sub_epi16(maxComponent,
+            _mm256_shuffle_epi8(source, alphaLow));
+    const __m256i inverseHigh = _mm256_sub_epi16(maxComponent,
+            _mm256_shuffle_epi8(source, alphaHigh));
+    __m256i low = _mm256_add_epi16(_mm256_mullo_epi16(
+            _mm256_unpacklo_epi8(dest, zero), inverseLow), half);
+    __m256i high = _mm256_add_epi16(_mm256_mullo_epi16(
+            _mm256_unpackhi_epi8(dest, zero), inverseHigh), half);
+    low = _mm256_srli_epi16(_mm256_add_epi16(low, _mm256_srli_epi16(low, 8)),
+            8);
+    high = _mm256_srli_epi16(_mm256_add_epi16(high,
+            _mm256_srli_epi16(high, 8)), 8);
+    return _mm256_and_si256(_mm256_adds_epu8(source,
+            _mm256_packus_epi16(low, high)), colorMask);
+}
+
+
+// Blends pixels with AVX2, sixteen pixels per iteration.
+__attribute__((target("avx2")))
+static void blendAVX2(const uint32_t* source, uint32_t* dest, size_t count)
+{
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16)
+    {
+        const __m256i* in = reinterpret_cast<const __m256i*>(source + i);
+        __m256i* out = reinterpret_cast<__m256i*>(dest + i);
+        const __m256i first = blendAVX2Vector(_mm256_loadu_si256(in),
+                _mm256_loadu_si256(out));
+        const __m256i second = blendAVX2Vector(_mm256_loadu_si256(in + 1),
+                _mm256_loadu_si256(out + 1));
+        _mm256_storeu_si256(out, first);
+        _mm256_storeu_si256(out + 1, second);
+    }
+    _mm256_zeroupper();
+    blendScalar(source + i, dest + i, count - i);
+}
+#endif
+
+
+#ifdef FBP_BLEND_NEON
+// Scales one color component by the inverse source alpha for eight pixels,
+// rounding the same way as divideBy255.
+static inline uint8x8_t scaleNEON(const uint8x8_t component,
+        const uint8x8_t inverseAlpha)
+{
+    const uint16x8_t product = vmull_u8(component, inverseAlpha);
+    return vrshrn_n_u16(vrsraq_n_u16(product, product, 8), 8);
+}
+
+
+// Blends pixels with NEON, sixteen pixels per iteration. Loads split pixels
+// into one register per byte, so each color component is handled
+// separately.
+static void blendNEON(const uint32_t* source, uint32_t* dest, size_t count)
+{
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16)
+    {
+        const uint8x16x4_t in = vld4q_u8(
+                reinterpret_cast<const uint8_t*>(source + i));
+        uint8x16x4_t out = vld4q_u8(reinterpret_cast<uint8_t*>(dest + i));
+        const uint8x16_t inverseAlpha = vmvnq_u8(in.val[3]);
+        for (int c = 0; c < 3; c++)
+        {
+            const uint8x16_t scaled = vcombine_u8(
+                    scaleNEON(vget_low_u8(out.val[c]),
+                            vget_low_u8(inverseAlpha)),
+                    scaleNEON(vget_high_u8(out.val[c]),
+                            vget_high_u8(inverseAlpha)));
+            out.val[c] = vqaddq_u8(in.val[c], scaled);
+        }
+        out.val[3] = vdupq_n_u8(0);
+        vst4q_u8(reinterpret_cast<uint8_t*>(dest + i), out);
+    }
+    blendScalar(source + i, dest + i, count - i);
+}
+#endif
+
+
+// Selects the fastest blend kernel this CPU supports, along with its name.
+static BlendKernel selectKernel(const char** name)
+{
+#ifdef FBP_BLEND_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+    {
+        *name = "avx2";
+        return blendAVX2;
+    }
+    if (__builtin_cpu_supports("sse4.1"))
+    {
+        *name = "sse4.1";
+        return blendSSE41;
+    }
+#elif defined(FBP_BLEND_NEON)
+    *name = "neon";
+    return blendNEON;
+#endif
+    *name = "scalar";
+    return blendScalar;
+}
+
+
+// Gets the selected kernel, choosing it on the first call.
+static BlendKernel getKernel(const char** name = nullptr)
+{
+    static const char* kernelName = nullptr;
+    static const BlendKernel kernel = selectKernel(&kernelName);
+    if (name != nullptr)
+    {
+        *name = kernelName;
+    }
+    return kernel;
+}
+
+
+// Displays a run of premultiplied pixels over opaque colors.
+void FBPainter::blendSpan(const uint32_t* source, uint32_t* dest,
+        const size_t count)
+{
+    getKernel()(source, dest, count);
+}
+
+
+// Gets the name of the blend kernel selected for this CPU.
+const char* FBPainter::getBlendKernelName()
+{
+    const char* name;
+    getKernel(&name);
+    return name;
+}
@@ -0,0 +1,135 @@
+/**
+ * @file  BlendKernels.h
+ *
+ * @brief  Blends premultiplied image pixels over opaque colors using the
+ *         fastest vector instructions the CPU supports.
+ */
+
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+namespace FBPainter
+{
+    /**
+     * @brief  Divides a product of two color components by 255, rounding to
+     *         the nearest integer.
+     *
+     *  This gives exactly the same result as rounded division for any
+     * product of two 8-bit values, using only additions and shifts.
+     *
+     * @param value  A value no greater than 255 * 255.
+     *
+     * @return       value / 255, rounded to the nearest integer.
+     */
+    inline uint32_t divideBy255(const uint32_t value)
+    {
+        const uint32_t rounded = value + 128;
+        return (rounded + (rounded >> 8)) >> 8;
+    }
+
+    /**
+     * @brief  Converts a color with an alpha component to a premultiplied
+     *         0xAARRGGBB value.
+     *
+     * @param red    The red color component.
+     *
+     * @param green  The green color component.
+     *
+     * @param blue   The blue color component.
+     *
+     * @param alpha  The alpha component, where 0 is fully transparent and
+     *               255 is fully opaque.
+     *
+     * @return       The alpha value in the highest byte, followed by each
+     *               color component scaled by alpha.
+     */
+    inline uint32_t premultiplyColor(const uint8_t red, const uint8_t green,
+            const uint8_t blue, const uint8_t alpha)
+    {
+        return (static_cast<uint32_t>(alpha) << 24)
+                | (divideBy255(red * alpha) << 16)
+                | (divideBy255(green * alpha) << 8)
+                | divideBy255(blue * alpha);
+    }
+
+    /**
+     * @brief  Converts a premultiplied pixel back to unscaled color
+     *         components.
+     *
+     *  Rounding ensures that premultiplying the result again gives back the
+     * original pixel exactly.
+     *
+     * @param pixel  A premultiplied 0xAARRGGBB pixel.
+     *
+     * @return       The 0xAARRGGBB pixel with unscaled color components, or
+     *               zero if the pixel is fully transparent.
+     */
+    inline uint32_t unpremultiplyColor(const uint32_t pixel)
+    {
+        const uint32_t alpha = pixel >> 24;
+        if (alpha == 0)
+        {
+            return 0;
+        }
+        const auto unscale = [alpha](const uint32_t component)
+        {
+            const uint32_t value = ((component & 0xff) * 255 + alpha / 2)
+                    / alpha;
+            return (value > 255) ? 255 : value;
+        };
+        return (alpha << 24) | (unscale(pixel >> 16) << 16)
+                | (unscale(pixel >> 8) << 8) | unscale(pixel);
+    }
+
+    /**
+     * @brief  Displays one premultiplied pixel over an opaque color.
+     *
+     * @param source  A premultiplied 0xAARRGGBB pixel. Color components
+     *                larger than alpha are invalid, but are still blended
+     *                without affecting the other components.
+     *
+     * @param dest    The 0x00RRGGBB background color. The highest byte is
+     *                ignored.
+     *
+     * @return        The 0x00RRGGBB color shown when the source pixel covers
+     *                the background.
+     */
+    inline uint32_t blendPremultiplied(const uint32_t source,
+            const uint32_t dest)
+    {
+        const uint32_t inverseAlpha = 255 - (source >> 24);
+        // Each component saturates at 255, as the vector kernels do:
+        const auto blend = [source, dest, inverseAlpha](const int shift)
+        {
+            const uint32_t value = ((source >> shift) & 0xff)
+                    + divideBy255(((dest >> shift) & 0xff) * inverseAlpha);
+            return ((value > 255) ? 255 : value) << shift;
+        };
+        return blend(16) | blend(8) | blend(0);
+    }
+
+    /**
+     * @brief  Displays a run of premultiplied pixels over opaque colors.
+     *
+     *  The first call selects an AVX2, SSE4.1, NEON, or portable kernel based
+     * on the CPU, and every later call reuses that selection. Every kernel
+     * gives exactly the same results as blendPremultiplied.
+     *
+     * @param source  count premultiplied 0xAARRGGBB pixels.
+     *
+     * @param dest    count 0x00RRGGBB background colors, which are replaced
+     *                with the blended 0x00RRGGBB colors. This may not overlap
+     *                the source pixels.
+     *
+     * @param count   The number of pixels to blend.
+     */
+    void blendSpan(const uint32_t* source, uint32_t* dest, const size_t count);
+
+    /**
+     * @brief  Gets the name of the blend kernel selected for this CPU.
+     *
+     * @return  "avx2", "sse4.1", "neon", or "scalar".
+     */
+    const char* getBlendKernelName();
+}
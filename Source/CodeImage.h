@@ -81,4 +81,87 @@ public:
         return ImageData::getColor(xPos, yPos);
     }
 
+    /**
+     * @brief  Copies a run of pixels from one image row.
+     *
+     *  Image data classes written by current versions of ImageEncoder decode
+     * whole rows of color indices straight into dest. Older classes without
+     * a readRow function are read with one ImageData::getColor call for each
+     * pixel.
+     *
+     * @param yPos    The y-coordinate of the row to read.
+     *
+     * @param xStart  The x-coordinate of the first pixel to read.
+     *
+     * @param count   The number of pixels to read.
+     *
+     * @param dest    A buffer with room for count pixel values. Pixels
+     *                outside of the image bounds are set to zero.
+     *
+     * @param format  The layout of the pixel values written to dest.
+     */
+    void readRow(const size_t yPos, const size_t xStart, const size_t count,
+            uint32_t* dest, const RowFormat format) const override
+    {
+        readDataRow<ImageData>(yPos, xStart, count, dest, 0);
+        if (format == RowFormat::PremultipliedARGB)
+        {
+            for (size_t i = 0; i < count; i++)
+            {
+                const uint32_t pixel = dest[i];
+                dest[i] = premultiplyColor(pixel >> 16, pixel >> 8, pixel,
+                        pixel >> 24);
+            }
+        }
+    }
+
+private:
+    /**
+     * @brief  Copies a run of 0xAARRGGBB pixels using the image data class's
+     *         own row decoder.
+     *
+     * @tparam Data   The image data class, selected only if it has a readRow
+     *                function.
+     *
+     * @param yPos    The y-coordinate of the row to read.
+     *
+     * @param xStart  The x-coordinate of the first pixel to read.
+     *
+     * @param count   The number of pixels to read.
+     *
+     * @param dest    A buffer with room for count pixel values.
+     */
+    template <class Data>
+    static auto readDataRow(const size_t yPos, const size_t xStart,
+            const size_t count, uint32_t* dest, int)
+            -> decltype(Data::readRow(yPos, xStart, count, dest), void())
+    {
+        Data::readRow(yPos, xStart, count, dest);
+    }
+
+    /**
+     * @brief  Copies a run of 0xAARRGGBB pixels one pixel at a time, for
+     *         image data classes without a row decoder.
+     *
+     * @tparam Data   The image data class.
+     *
+     * @param yPos    The y-coordinate of the row to read.
+     *
+     * @param xStart  The x-coordinate of the first pixel to read.
+     *
+     * @param count   The number of pixels to read.
+     *
+     * @param dest    A buffer with room for count pixel values.
+     */
+    template <class Data>
+    static void readDataRow(const size_t yPos, const size_t xStart,
+            const size_t count, uint32_t* dest, long)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            const RGBAPixel pixel = Data::getColor(xStart + i, yPos);
+            dest[i] = packRowPixel(pixel.getRed(), pixel.getGreen(),
+                    pixel.getBlue(), pixel.getAlpha(), RowFormat::ARGB);
+        }
+    }
 };
@@ -0,0 +1,332 @@
+#include "Compositor.h"
+#include "FrameBuffer.h"
+#include "BlendKernels.h"
+#include "PreparedImage.h"
+#include <algorithm>
+#include <memory>
+#include <new>
+
+// Creates a compositor with no layers, saving the current frame buffer
+// contents as its background.
+FBPainter::Compositor::Compositor(FrameBuffer* const frameBuffer) :
+        frameBuffer(frameBuffer)
+{
+    if (frameBuffer == nullptr)
+    {
+        return;
+    }
+    converter = PixelConverter::forFormat(frameBuffer->getPixelFormat());
+    bufferBounds = Rectangle(0, 0, frameBuffer->getWidth(),
+            frameBuffer->getHeight());
+    backgroundStride = frameBuffer->getWidth()
+            * getBytesPerPixel(frameBuffer->getPixelFormat());
+    captureBackground();
+}
+
+
+// Gets the frame buffer the compositor draws into.
+FBPainter::FrameBuffer* FBPainter::Compositor::getFrameBuffer() const
+{
+    return frameBuffer;
+}
+
+
+// Saves the current frame buffer contents as the new background.
+void FBPainter::Compositor::captureBackground()
+{
+    if (converter == nullptr)
+    {
+        return;
+    }
+    const size_t height = bufferBounds.getHeight();
+    try
+    {
+        background.resize(backgroundStride * height);
+    }
+    catch (const std::bad_alloc&)
+    {
+        // Without a background, nothing can be composited:
+        background.clear();
+        converter = nullptr;
+        return;
+    }
+    for (size_t y = 0; y < height; y++)
+    {
+        frameBuffer->readSpan(0, y, background.data() + y * backgroundStride,
+                bufferBounds.getWidth());
+    }
+}
+
+
+// Adds a new image layer.
+FBPainter::Compositor::LayerId FBPainter::Compositor::addLayer(Image* image,
+        const int xPos, const int yPos, const int zOrder)
+{
+    return addLayer(std::shared_ptr<const Image>(image), xPos, yPos, zOrder);
+}
+
+
+// Adds a new layer showing a shared image.
+FBPainter::Compositor::LayerId FBPainter::Compositor::addLayer
+(std::shared_ptr<const Image> image, const int xPos, const int yPos,
+        const int zOrder)
+{
+    // Layers draw straight from prepared rows and runs. Images that are
+    // already prepared, such as cached images, are shared rather than
+    // copied:
+    const std::shared_ptr<const Image> prepared
+            = PreparedImage::prepare(image);
+    if (prepared == nullptr || ! PreparedImage::isPrepared(*prepared))
+    {
+        return invalidLayer;
+    }
+    Layer layer;
+    layer.image = prepared;
+    const LayerId id = nextId++;
+    layer.id = id;
+    layer.zOrder = zOrder;
+    layer.sequence = nextSequence++;
+    layer.bounds = Rectangle(xPos, yPos, prepared->getWidth(),
+            prepared->getHeight());
+    layer.visible = true;
+    damage.add(layer.bounds);
+    layers.push_back(std::move(layer));
+    sortLayers();
+    return id;
+}
+
+
+// Removes a layer from the stack.
+void FBPainter::Compositor::removeLayer(const LayerId layer)
+{
+    for (auto iter = layers.begin(); iter != layers.end(); iter++)
+    {
+        if (iter->id == layer)
+        {
+            if (iter->visible)
+            {
+                damage.add(iter->bounds);
+            }
+            layers.erase(iter);
+            return;
+        }
+    }
+}
+
+
+// Gets the area a layer covers in the frame buffer.
+FBPainter::Rectangle FBPainter::Compositor::getLayerBounds
+(const LayerId layer) const
+{
+    const Layer* found = findLayer(layer);
+    return (found != nullptr) ? found->bounds : Rectangle();
+}
+
+
+// Moves a layer's image to a new origin.
+void FBPainter::Compositor::setLayerOrigin(const LayerId layer,
+        const int xPos, const int yPos)
+{
+    Layer* found = findLayer(layer);
+    if (found == nullptr || (found->bounds.getLeft() == xPos
+            && found->bounds.getTop() == yPos))
+    {
+        return;
+    }
+    const Rectangle newBounds(xPos, yPos, found->bounds.getWidth(),
+            found->bounds.getHeight());
+    if (found->visible)
+    {
+        damage.add(found->bounds);
+        damage.add(newBounds);
+    }
+    found->bounds = newBounds;
+}
+
+
+// Changes a layer's position in the stack.
+void FBPainter::Compositor::setLayerZOrder(const LayerId layer,
+        const int zOrder)
+{
+    Layer* found = findLayer(layer);
+    if (found == nullptr)
+    {
+        return;
+    }
+    found->zOrder = zOrder;
+    found->sequence = nextSequence++;
+    if (found->visible)
+    {
+        damage.add(found->bounds);
+    }
+    sortLayers();
+}
+
+
+// Shows or hides a layer.
+void FBPainter::Compositor::setLayerVisible(const LayerId layer,
+        const bool visible)
+{
+    Layer* found = findLayer(layer);
+    if (found != nullptr && found->visible != visible)
+    {
+        found->visible = visible;
+        damage.add(found->bounds);
+    }
+}
+
+
+// Marks part of the frame buffer to be redrawn on the next update.
+void FBPainter::Compositor::invalidate(const Rectangle& area)
+{
+    damage.add(area);
+}
+
+
+// Redraws every damaged area of the frame buffer.
+void FBPainter::Compositor::update()
+{
+    if (converter == nullptr)
+    {
+        return;
+    }
+    for (const Rectangle& area : damage.getRects())
+    {
+        const Rectangle bufferArea = area.getIntersection(bufferBounds);
+        if (! bufferArea.isEmpty())
+        {
+            compositeArea(bufferArea);
+        }
+    }
+    damage.clear();
+}
+
+
+// Finds a layer in the stack.
+FBPainter::Compositor::Layer* FBPainter::Compositor::findLayer
+(const LayerId layer)
+{
+    for (Layer& candidate : layers)
+    {
+        if (candidate.id == layer)
+        {
+            return &candidate;
+        }
+    }
+    return nullptr;
+}
+
+
+// Finds a layer in the stack.
+const FBPainter::Compositor::Layer* FBPainter::Compositor::findLayer
+(const LayerId layer) const
+{
+    for (const Layer& candidate : layers)
+    {
+        if (candidate.id == layer)
+        {
+            return &candidate;
+        }
+    }
+    return nullptr;
+}
+
+
+// Sorts layers from bottom to top.
+void FBPainter::Compositor::sortLayers()
+{
+    std::sort(layers.begin(), layers.end(),
+            [](const Layer& first, const Layer& second)
+    {
+        return (first.zOrder != second.zOrder)
+                ? (first.zOrder < second.zOrder)
+                : (first.sequence < second.sequence);
+    });
+}
+
+
+// Rebuilds and writes one damaged area of the frame buffer.
+void FBPainter::Compositor::compositeArea(const Rectangle& area)
+{
+    const size_t width = area.getWidth();
+    const size_t bytesPerPixel = getBytesPerPixel(
+            frameBuffer->getPixelFormat());
+    rowColors.resize(width);
+    rowPixels.resize(width * bytesPerPixel);
+    // Only visible layers that touch the area are drawn:
+    std::vector<const Layer*> areaLayers;
+    for (const Layer& layer : layers)
+    {
+        if (layer.visible && layer.bounds.intersects(area))
+        {
+            areaLayers.push_back(&layer);
+        }
+    }
+    for (int y = area.getTop(); y < area.getBottom(); y++)
+    {
+        const uint8_t* backgroundRow = background.data()
+                + y * backgroundStride + area.getLeft() * bytesPerPixel;
+        bool rowCovered = false;
+        for (const Layer* layer : areaLayers)
+        {
+            const Rectangle& bounds = layer->bounds;
+            if (y < bounds.getTop() || y >= bounds.getBottom())
+            {
+                continue;
+            }
+            const size_t imageY = y - bounds.getTop();
+            size_t runCount;
+            const PixelRun* const rowRuns = layer->image->getRowRuns(imageY,
+                    runCount);
+            const uint32_t* const row
+                    = layer->image->getPremultipliedRow(imageY);
+            if (rowRuns == nullptr || row == nullptr)
+            {
+                continue;
+            }
+            for (size_t i = 0; i < runCount; i++)
+            {
+                // Transparent runs never change the pixels below them:
+                const PixelRun& run = rowRuns[i];
+                const int left = std::max<int>(area.getLeft(),
+                        bounds.getLeft() + run.start);
+                const int right = std::min<int>(area.getRight(),
+                        bounds.getLeft() + run.start + run.length);
+                if (run.type == RunType::Transparent || left >= right)
+                {
+                    continue;
+                }
+                if (! rowCovered)
+                {
+                    converter->unpackSpan(backgroundRow, rowColors.data(),
+                            width);
+                    rowCovered = true;
+                }
+                const uint32_t* const runPixels
+                        = row + (left - bounds.getLeft());
+                uint32_t* const runColors
+                        = rowColors.data() + (left - area.getLeft());
+                if (run.type == RunType::Opaque)
+                {
+                    // Opaque premultiplied pixels are their own colors, and
+                    // the alpha byte is ignored when colors are packed:
+                    std::copy(runPixels, runPixels + (right - left),
+                            runColors);
+                }
+                else
+                {
+                    blendSpan(runPixels, runColors, right - left);
+                }
+            }
+        }
+        if (rowCovered)
+        {
+            converter->packSpan(rowColors.data(), rowPixels.data(), width);
+            frameBuffer->writeSpan(area.getLeft(), y, rowPixels.data(), width);
+        }
+        else
+        {
+            frameBuffer->writeSpan(area.getLeft(), y, backgroundRow, width);
+        }
+    }
+}
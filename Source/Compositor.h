@@ -0,0 +1,239 @@
+/**
+ * @file  Compositor.h
+ *
+ * @brief  Draws a stack of overlapping images into the frame buffer.
+ */
+
+#pragma once
+#include "DamageRegion.h"
+#include "Image.h"
+#include "PixelFormat.h"
+#include "Rectangle.h"
+#include <stdint.h>
+#include <stddef.h>
+#include <memory>
+#include <vector>
+
+namespace FBPainter
+{
+    class Compositor;
+    class FrameBuffer;
+}
+
+/**
+ * @brief  Keeps an ordered stack of image layers over a saved background,
+ *         and redraws only the areas that changed.
+ *
+ *  Unlike ImagePainter, layers don't save the pixels they cover. The
+ * compositor keeps one copy of the background, and changing a layer only
+ * marks its old and new bounds as damaged. Each update rebuilds every
+ * damaged pixel from the background and all visible layers, bottom to top,
+ * then writes each row to the frame buffer once. Layers may therefore be
+ * moved, hidden, reordered, or removed in any order without leaving stale
+ * pixels behind.
+ */
+class FBPainter::Compositor
+{
+public:
+    /**
+     * @brief  Identifies a layer within the compositor.
+     */
+    typedef size_t LayerId;
+
+    // Returned when a layer can't be created:
+    static const constexpr LayerId invalidLayer = static_cast<LayerId>(-1);
+
+    /**
+     * @brief  Creates a compositor with no layers, saving the current frame
+     *         buffer contents as its background.
+     *
+     * @param frameBuffer  The frame buffer to draw into. This object is not
+     *                     owned by the Compositor, and must remain valid
+     *                     while the compositor is in use.
+     */
+    Compositor(FrameBuffer* const frameBuffer);
+
+    /**
+     * @brief  Gets the frame buffer the compositor draws into.
+     *
+     * @return  The frame buffer object.
+     */
+    FrameBuffer* getFrameBuffer() const;
+
+    /**
+     * @brief  Saves the current frame buffer contents as the new background.
+     *
+     *  This should be called after drawing into the frame buffer without the
+     * compositor, while no layers are drawn over the changed area.
+     */
+    void captureBackground();
+
+    /**
+     * @brief  Adds a new image layer.
+     *
+     * @param image   The layer image, which will be owned by the compositor.
+     *                It's replaced with a PreparedImage copy unless it
+     *                already provides premultiplied rows and runs.
+     *
+     * @param xPos    The x-coordinate of the image's top left corner in the
+     *                frame buffer.
+     *
+     * @param yPos    The y-coordinate of the image's top left corner in the
+     *                frame buffer.
+     *
+     * @param zOrder  The layer's position in the stack. Layers with higher
+     *                values are drawn over layers with lower values, and
+     *                layers with equal values are drawn in the order they
+     *                were added.
+     *
+     * @return        The new layer's ID, or Compositor::invalidLayer if the
+     *                image was null or its pixels couldn't be stored.
+     */
+    LayerId addLayer(Image* image, const int xPos, const int yPos,
+            const int zOrder = 0);
+
+    /**
+     * @brief  Adds a new layer showing a shared image.
+     *
+     * @param image   The layer image. Images that already provide
+     *                premultiplied rows and runs, such as images from
+     *                ImageCache, are shared without copying their pixels.
+     *                Other images are prepared as a PreparedImage copy for
+     *                this layer.
+     *
+     * @param xPos    The x-coordinate of the image's top left corner in the
+     *                frame buffer.
+     *
+     * @param yPos    The y-coordinate of the image's top left corner in the
+     *                frame buffer.
+     *
+     * @param zOrder  The layer's position in the stack.
+     *
+     * @return        The new layer's ID, or Compositor::invalidLayer if the
+     *                image was null or its pixels couldn't be stored.
+     */
+    LayerId addLayer(std::shared_ptr<const Image> image, const int xPos,
+            const int yPos, const int zOrder = 0);
+
+    /**
+     * @brief  Removes a layer from the stack.
+     *
+     * @param layer  The ID of the layer to remove.
+     */
+    void removeLayer(const LayerId layer);
+
+    /**
+     * @brief  Gets the area a layer covers in the frame buffer.
+     *
+     * @param layer  A layer ID.
+     *
+     * @return       The layer bounds, or an empty rectangle if the layer
+     *               doesn't exist.
+     */
+    Rectangle getLayerBounds(const LayerId layer) const;
+
+    /**
+     * @brief  Moves a layer's image to a new origin.
+     *
+     * @param layer  A layer ID.
+     *
+     * @param xPos   The new x-coordinate of the image's top left corner in
+     *               the frame buffer.
+     *
+     * @param yPos   The new y-coordinate of the image's top left corner in
+     *               the frame buffer.
+     */
+    void setLayerOrigin(const LayerId layer, const int xPos, const int yPos);
+
+    /**
+     * @brief  Changes a layer's position in the stack.
+     *
+     * @param layer   A layer ID.
+     *
+     * @param zOrder  The new stack position. The layer is drawn over all
+     *                other layers with the same value.
+     */
+    void setLayerZOrder(const LayerId layer, const int zOrder);
+
+    /**
+     * @brief  Shows or hides a layer.
+     *
+     * @param layer    A layer ID.
+     *
+     * @param visible  Whether the layer should be drawn.
+     */
+    void setLayerVisible(const LayerId layer, const bool visible);
+
+    /**
+     * @brief  Marks part of the frame buffer to be redrawn on the next
+     *         update.
+     *
+     * @param area  The area to redraw.
+     */
+    void invalidate(const Rectangle& area);
+
+    /**
+     * @brief  Redraws every damaged area of the frame buffer.
+     */
+    void update();
+
+private:
+    /**
+     * @brief  One image in the layer stack.
+     */
+    struct Layer
+    {
+        LayerId id;
+        int zOrder;
+        // Breaks ties between layers with the same zOrder:
+        size_t sequence;
+        Rectangle bounds;
+        bool visible;
+        // The layer image, which provides premultiplied rows and runs:
+        std::shared_ptr<const Image> image;
+    };
+
+    /**
+     * @brief  Finds a layer in the stack.
+     *
+     * @param layer  A layer ID.
+     *
+     * @return       The layer, or nullptr if it doesn't exist.
+     */
+    Layer* findLayer(const LayerId layer);
+    const Layer* findLayer(const LayerId layer) const;
+
+    /**
+     * @brief  Sorts layers from bottom to top.
+     */
+    void sortLayers();
+
+    /**
+     * @brief  Rebuilds and writes one damaged area of the frame buffer.
+     *
+     * @param area  An area within the frame buffer bounds.
+     */
+    void compositeArea(const Rectangle& area);
+
+    FrameBuffer* const frameBuffer;
+    // Converts colors to and from the frame buffer's pixel format:
+    const PixelConverter* converter = nullptr;
+    // The frame buffer bounds:
+    Rectangle bufferBounds;
+    // The saved background, packed in the frame buffer's pixel format:
+    std::vector<uint8_t> background;
+    // The number of bytes in each background row:
+    size_t backgroundStride = 0;
+    // All layers, sorted from bottom to top:
+    std::vector<Layer> layers;
+    // Areas to redraw on the next update:
+    DamageRegion damage;
+    // The next layer ID to assign:
+    LayerId nextId = 0;
+    // The next layer sequence number to assign:
+    size_t nextSequence = 0;
+    // Holds one row of colors while it's composited:
+    std::vector<uint32_t> rowColors;
+    // Holds one row of packed pixels before it's written:
+    std::vector<uint8_t> rowPixels;
+};
@@ -0,0 +1,177 @@
+#include "DamageRegion.h"
+#include <algorithm>
+#include <limits>
+
+
+// Gets the number of pixels in a rectangle.
+static inline long rectArea(const FBPainter::Rectangle& rect)
+{
+    return rect.isEmpty() ? 0 : (long) rect.getWidth() * rect.getHeight();
+}
+
+
+// Checks if two rectangles overlap or share part of an edge. Rectangles that
+// only meet at a corner don't count.
+static inline bool touching(const FBPainter::Rectangle& first,
+        const FBPainter::Rectangle& second)
+{
+    const bool columnsOverlap = first.getLeft() < second.getRight()
+            && second.getLeft() < first.getRight();
+    const bool rowsOverlap = first.getTop() < second.getBottom()
+            && second.getTop() < first.getBottom();
+    const bool columnsMeet = first.getLeft() <= second.getRight()
+            && second.getLeft() <= first.getRight();
+    const bool rowsMeet = first.getTop() <= second.getBottom()
+            && second.getTop() <= first.getBottom();
+    return (columnsOverlap && rowsMeet) || (columnsMeet && rowsOverlap);
+}
+
+
+// Gets the number of pixels covered by the union of two rectangles that
+// neither rectangle covers.
+static inline long extraArea(const FBPainter::Rectangle& first,
+        const FBPainter::Rectangle& second)
+{
+    return rectArea(first.getUnion(second)) - rectArea(first)
+            - rectArea(second) + rectArea(first.getIntersection(second));
+}
+
+
+// Checks if two rectangles should be combined as soon as they're added,
+// which is only done if they touch and combining them doesn't add more
+// unchanged pixels than the smaller rectangle holds.
+static inline bool shouldMerge(const FBPainter::Rectangle& first,
+        const FBPainter::Rectangle& second)
+{
+    return touching(first, second) && extraArea(first, second)
+            <= std::min(rectArea(first), rectArea(second));
+}
+
+
+// Creates an empty region.
+FBPainter::DamageRegion::DamageRegion(const size_t maxRects) :
+    maxRects(maxRects > 0 ? maxRects : 1)
+{
+    rects.reserve(this->maxRects + 1);
+}
+
+
+// Adds an area to the region.
+void FBPainter::DamageRegion::add(const Rectangle& area)
+{
+    if (area.isEmpty())
+    {
+        return;
+    }
+    // Most repeated damage lands within existing rectangles:
+    for (const Rectangle& rect : rects)
+    {
+        if (rect.contains(area))
+        {
+            return;
+        }
+    }
+    // Absorb every touching rectangle that's cheap to combine with the new
+    // area. Each merge may grow the area, so keep going until nothing else
+    // can be merged:
+    Rectangle merged = area;
+    bool mergedAny = true;
+    while (mergedAny)
+    {
+        mergedAny = false;
+        for (size_t i = 0; i < rects.size(); i++)
+        {
+            if (shouldMerge(rects[i], merged))
+            {
+                merged = merged.getUnion(rects[i]);
+                rects[i] = rects.back();
+                rects.pop_back();
+                mergedAny = true;
+                break;
+            }
+        }
+    }
+    rects.push_back(merged);
+    while (rects.size() > maxRects)
+    {
+        mergeClosestPair();
+    }
+}
+
+
+// Adds all areas in another region to this region.
+void FBPainter::DamageRegion::add(const DamageRegion& region)
+{
+    for (const Rectangle& rect : region.rects)
+    {
+        add(rect);
+    }
+}
+
+
+// Removes all areas from the region.
+void FBPainter::DamageRegion::clear()
+{
+    rects.clear();
+}
+
+
+// Checks if the region contains no areas.
+bool FBPainter::DamageRegion::isEmpty() const
+{
+    return rects.empty();
+}
+
+
+// Gets the rectangles that make up the region.
+const std::vector<FBPainter::Rectangle>& FBPainter::DamageRegion::getRects()
+        const
+{
+    return rects;
+}
+
+
+// Gets the smallest rectangle that contains the entire region.
+FBPainter::Rectangle FBPainter::DamageRegion::getBounds() const
+{
+    Rectangle bounds;
+    for (const Rectangle& rect : rects)
+    {
+        bounds = bounds.getUnion(rect);
+    }
+    return bounds;
+}
+
+
+// Gets the maximum number of rectangles the region may hold.
+size_t FBPainter::DamageRegion::getMaxRects() const
+{
+    return maxRects;
+}
+
+
+// Merges the pair of rectangles that adds the least extra area when
+// combined.
+void FBPainter::DamageRegion::mergeClosestPair()
+{
+    size_t bestFirst = 0;
+    size_t bestSecond = 1;
+    long bestCost = std::numeric_limits<long>::max();
+    for (size_t i = 0; i < rects.size(); i++)
+    {
+        for (size_t j = i + 1; j < rects.size(); j++)
+        {
+            const long cost = extraArea(rects[i], rects[j]);
+            if (cost < bestCost)
+            {
+                bestCost = cost;
+                bestFirst = i;
+                bestSecond = j;
+            }
+        }
+    }
+    const Rectangle merged = rects[bestFirst].getUnion(rects[bestSecond]);
+    rects[bestSecond] = rects.back();
+    rects.pop_back();
+    rects[bestFirst] = merged;
+}
@@ -0,0 +1,102 @@
+/**
+ * @file  DamageRegion.h
+ *
+ * @brief  Accumulates the areas of a frame buffer that have changed.
+ */
+
+#pragma once
+#include "Rectangle.h"
+#include <stddef.h>
+#include <vector>
+
+namespace FBPainter
+{
+    class DamageRegion;
+}
+
+/**
+ * @brief  Tracks a union of rectangles, using at most a fixed number of
+ *         rectangles.
+ *
+ *  New rectangles are merged with existing rectangles that they overlap or
+ * share part of an edge with, as long as the combined rectangle adds no more
+ * unchanged pixels than the smaller of the two covers. Rectangles that only
+ * meet at a corner, or that would cover a much larger area together, such as
+ * a thin row and column that cross, are kept separate. Once the rectangle
+ * limit is reached, the two rectangles that can be combined while adding the
+ * least extra area are merged together.
+ */
+class FBPainter::DamageRegion
+{
+public:
+    // Default maximum number of rectangles:
+    static const constexpr size_t defaultMaxRects = 16;
+
+    /**
+     * @brief  Creates an empty region.
+     *
+     * @param maxRects  The maximum number of rectangles the region may hold.
+     *                  Values below one are treated as one.
+     */
+    DamageRegion(const size_t maxRects = defaultMaxRects);
+
+    /**
+     * @brief  Adds an area to the region.
+     *
+     * @param area  The area to add. Empty rectangles are ignored.
+     */
+    void add(const Rectangle& area);
+
+    /**
+     * @brief  Adds all areas in another region to this region.
+     *
+     * @param region  The region to add.
+     */
+    void add(const DamageRegion& region);
+
+    /**
+     * @brief  Removes all areas from the region.
+     */
+    void clear();
+
+    /**
+     * @brief  Checks if the region contains no areas.
+     *
+     * @return  Whether the region is empty.
+     */
+    bool isEmpty() const;
+
+    /**
+     * @brief  Gets the rectangles that make up the region.
+     *
+     * @return  The region's rectangles. These may overlap where combining
+     *          them would have covered too many unchanged pixels.
+     */
+    const std::vector<Rectangle>& getRects() const;
+
+    /**
+     * @brief  Gets the smallest rectangle that contains the entire region.
+     *
+     * @return  The region's bounding rectangle.
+     */
+    Rectangle getBounds() const;
+
+    /**
+     * @brief  Gets the maximum number of rectangles the region may hold.
+     *
+     * @return  The rectangle limit.
+     */
+    size_t getMaxRects() const;
+
+private:
+    /**
+     * @brief  Merges the pair of rectangles that adds the least extra area
+     *         when combined.
+     */
+    void mergeClosestPair();
+
+    // Maximum number of rectangles in the region:
+    size_t maxRects;
+    // All rectangles in the region:
+    std::vector<Rectangle> rects;
+};
@@ -0,0 +1,115 @@
+#include "DrawContext.h"
+#include "FrameBuffer.h"
+
+
+// Creates a context that initially clips to the frame buffer bounds.
+FBPainter::DrawContext::DrawContext(FrameBuffer* const frameBuffer) :
+    frameBuffer(frameBuffer)
+{
+    if (frameBuffer != nullptr && frameBuffer->isBufferOpen())
+    {
+        clipStack.push_back(Rectangle(0, 0, frameBuffer->getWidth(),
+                frameBuffer->getHeight()));
+    }
+    else
+    {
+        clipStack.push_back(Rectangle());
+    }
+}
+
+
+// Gets the frame buffer this context draws into.
+FBPainter::FrameBuffer* FBPainter::DrawContext::getFrameBuffer() const
+{
+    return frameBuffer;
+}
+
+
+// Gets the current clipping rectangle.
+const FBPainter::Rectangle& FBPainter::DrawContext::getClip() const
+{
+    return clipStack.back();
+}
+
+
+// Limits drawing to the intersection of the current clipping rectangle and a
+// new rectangle.
+void FBPainter::DrawContext::pushClip(const Rectangle& clipRect)
+{
+    clipStack.push_back(clipStack.back().getIntersection(clipRect));
+}
+
+
+// Restores the clipping rectangle that was active before the last call to
+// pushClip.
+void FBPainter::DrawContext::popClip()
+{
+    if (clipStack.size() > 1)
+    {
+        clipStack.pop_back();
+    }
+}
+
+
+// Copies a row of pixels out of the clipped area.
+void FBPainter::DrawContext::readSpan(const int xPos, const int yPos,
+        void* dest, const size_t count) const
+{
+    const Rectangle span = getClip().getIntersection(
+            Rectangle(xPos, yPos, count, 1));
+    if (! span.isEmpty())
+    {
+        const size_t offset = (span.getLeft() - xPos)
+                * frameBuffer->getBytesPerPixel();
+        frameBuffer->readSpan(span.getLeft(), yPos,
+                static_cast<uint8_t*>(dest) + offset, span.getWidth());
+    }
+}
+
+
+// Copies a row of pixels into the clipped area.
+void FBPainter::DrawContext::writeSpan(const int xPos, const int yPos,
+        const void* source, const size_t count)
+{
+    const Rectangle span = getClip().getIntersection(
+            Rectangle(xPos, yPos, count, 1));
+    if (! span.isEmpty())
+    {
+        const size_t offset = (span.getLeft() - xPos)
+                * frameBuffer->getBytesPerPixel();
+        frameBuffer->writeSpan(span.getLeft(), yPos,
+                static_cast<const uint8_t*>(source) + offset,
+                span.getWidth());
+    }
+}
+
+
+// Copies a rectangle of packed pixel data into the clipped area.
+void FBPainter::DrawContext::blitRect(const Rectangle& area,
+        const void* source, const size_t sourceStride)
+{
+    const Rectangle clipped = getClip().getIntersection(area);
+    if (clipped.isEmpty())
+    {
+        return;
+    }
+    const size_t offset = (clipped.getTop() - area.getTop()) * sourceStride
+            + (clipped.getLeft() - area.getLeft())
+            * frameBuffer->getBytesPerPixel();
+    frameBuffer->blitRect(clipped.getLeft(), clipped.getTop(),
+            clipped.getWidth(), clipped.getHeight(),
+            static_cast<const uint8_t*>(source) + offset, sourceStride);
+}
+
+
+// Sets every pixel within part of the clipped area to a single color.
+void FBPainter::DrawContext::fillRect(const Rectangle& area,
+        const RGBPixel color)
+{
+    const Rectangle clipped = getClip().getIntersection(area);
+    if (! clipped.isEmpty())
+    {
+        frameBuffer->fillRect(clipped.getLeft(), clipped.getTop(),
+                clipped.getWidth(), clipped.getHeight(), color);
+    }
+}
@@ -0,0 +1,138 @@
+/**
+ * @file  DrawContext.h
+ *
+ * @brief  Draws into a FrameBuffer using signed coordinates and a stack of
+ *         clipping rectangles.
+ */
+
+#pragma once
+#include "Rectangle.h"
+#include "RGBPixel.h"
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+namespace FBPainter
+{
+    class DrawContext;
+    class FrameBuffer;
+}
+
+/**
+ * @brief  Restricts drawing operations to a clipping rectangle within a frame
+ *         buffer.
+ *
+ *  Drawing operations may use any signed coordinates. Each operation is
+ * clipped once against the current clipping rectangle, and parts that fall
+ * outside of it are silently ignored. Clipping rectangles are kept in a
+ * stack, and each new rectangle is limited to the area of the one below it.
+ */
+class FBPainter::DrawContext
+{
+public:
+    /**
+     * @brief  Creates a context that initially clips to the frame buffer
+     *         bounds.
+     *
+     * @param frameBuffer  The frame buffer to draw into. This object is not
+     *                     owned by the DrawContext, and must remain valid
+     *                     while the context is in use.
+     */
+    DrawContext(FrameBuffer* const frameBuffer);
+
+    /**
+     * @brief  Gets the frame buffer this context draws into.
+     *
+     * @return  The frame buffer object.
+     */
+    FrameBuffer* getFrameBuffer() const;
+
+    /**
+     * @brief  Gets the current clipping rectangle.
+     *
+     * @return  The area that drawing operations are currently limited to.
+     *          This is always within the frame buffer bounds.
+     */
+    const Rectangle& getClip() const;
+
+    /**
+     * @brief  Limits drawing to the intersection of the current clipping
+     *         rectangle and a new rectangle.
+     *
+     * @param clipRect  The new area to draw within.
+     */
+    void pushClip(const Rectangle& clipRect);
+
+    /**
+     * @brief  Restores the clipping rectangle that was active before the last
+     *         call to pushClip.
+     *
+     *  This does nothing if the only remaining clipping rectangle is the frame
+     * buffer bounds.
+     */
+    void popClip();
+
+    /**
+     * @brief  Copies a row of pixels out of the clipped area.
+     *
+     * @param xPos   The x-coordinate of the first pixel to read.
+     *
+     * @param yPos   The y-coordinate of the row to read.
+     *
+     * @param dest   Memory with room for count pixels in the frame buffer's
+     *               pixel format, where the first pixel corresponds to
+     *               (xPos, yPos). Pixels outside of the clipping rectangle are
+     *               left unchanged.
+     *
+     * @param count  The number of pixels to read.
+     */
+    void readSpan(const int xPos, const int yPos, void* dest,
+            const size_t count) const;
+
+    /**
+     * @brief  Copies a row of pixels into the clipped area.
+     *
+     * @param xPos    The x-coordinate of the first pixel to write.
+     *
+     * @param yPos    The y-coordinate of the row to write.
+     *
+     * @param source  Memory holding count pixels in the frame buffer's pixel
+     *                format, where the first pixel holds the color at
+     *                (xPos, yPos).
+     *
+     * @param count   The number of pixels to write.
+     */
+    void writeSpan(const int xPos, const int yPos, const void* source,
+            const size_t count);
+
+    /**
+     * @brief  Copies a rectangle of packed pixel data into the clipped area.
+     *
+     * @param area          The frame buffer area to copy into.
+     *
+     * @param source        Row-major pixel data in the frame buffer's pixel
+     *                      format, where the first pixel holds the color at
+     *                      the area's top left corner.
+     *
+     * @param sourceStride  The number of bytes between the start of each row
+     *                      in the source data.
+     */
+    void blitRect(const Rectangle& area, const void* source,
+            const size_t sourceStride);
+
+    /**
+     * @brief  Sets every pixel within part of the clipped area to a single
+     *         color.
+     *
+     * @param area   The frame buffer area to fill.
+     *
+     * @param color  The color to copy into the area.
+     */
+    void fillRect(const Rectangle& area, const RGBPixel color);
+
+private:
+    // The frame buffer to draw into:
+    FrameBuffer* const frameBuffer;
+    // All active clipping rectangles, starting with the frame buffer bounds:
+    std::vector<Rectangle> clipStack;
+};
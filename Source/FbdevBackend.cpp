@@ -0,0 +1,252 @@
+#include "FbdevBackend.h"
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/ioctl.h>
+
+
+// Opens and memory maps the frame buffer file.
+FBPainter::FbdevBackend::FbdevBackend(const char* bufferPath)
+{
+    errno = 0;
+    bufferFD = open(bufferPath, O_RDWR);
+    if (bufferFD == -1)
+    {
+        perror("Opening frame buffer file failed");
+        bufferFD = 0;
+        return;
+    }
+    using std::min;
+    int ioResult = min(0, ioctl(bufferFD, FBIOGET_VSCREENINFO, &vInfo));
+    if (ioResult == 0)
+    {
+        // Prefer 32-bit color, but keep the current mode if the driver
+        // doesn't support it:
+        struct fb_var_screeninfo requestedInfo = vInfo;
+        requestedInfo.grayscale = 0;
+        requestedInfo.bits_per_pixel = 32;
+        ioctl(bufferFD, FBIOPUT_VSCREENINFO, &requestedInfo);
+    }
+    ioResult = min(ioResult, ioctl(bufferFD, FBIOGET_VSCREENINFO, &vInfo));
+    ioResult = min(ioResult, ioctl(bufferFD, FBIOGET_FSCREENINFO, &fInfo));
+    if (ioResult == -1)
+    {
+        perror("Reading frame buffer info failed");
+        closeAndClearData();
+        return;
+    }
+    pixelFormat = findPixelFormat(vInfo);
+    if (pixelFormat == PixelFormat::Unknown)
+    {
+        fprintf(stderr, "Unsupported frame buffer pixel format: %u bits per "
+                "pixel, RGB offsets %u/%u/%u\n", vInfo.bits_per_pixel,
+                vInfo.red.offset, vInfo.green.offset, vInfo.blue.offset);
+        closeAndClearData();
+        return;
+    }
+    mapBuffer();
+}
+
+
+// Closes and unmaps the frame buffer file on destruction.
+FBPainter::FbdevBackend::~FbdevBackend()
+{
+    closeAndClearData();
+}
+
+
+// Checks if the buffer is open and memory mapped.
+bool FBPainter::FbdevBackend::isOpen() const
+{
+    return bufferData != nullptr;
+}
+
+
+// Gets the visible width of the display.
+size_t FBPainter::FbdevBackend::getWidth() const
+{
+    return vInfo.xres;
+}
+
+
+// Gets the visible height of the display.
+size_t FBPainter::FbdevBackend::getHeight() const
+{
+    return vInfo.yres;
+}
+
+
+// Gets the virtual height reported by the driver.
+size_t FBPainter::FbdevBackend::getVirtualHeight() const
+{
+    return vInfo.yres_virtual;
+}
+
+
+// Gets the line length reported by the driver.
+size_t FBPainter::FbdevBackend::getStride() const
+{
+    return fInfo.line_length;
+}
+
+
+// Gets the pixel format detected when the device was opened.
+FBPainter::PixelFormat FBPainter::FbdevBackend::getPixelFormat() const
+{
+    return pixelFormat;
+}
+
+
+// Gets the address of the first display page in the buffer's memory map.
+uint8_t* FBPainter::FbdevBackend::getData() const
+{
+    if (bufferData == nullptr)
+    {
+        return nullptr;
+    }
+    return bufferData + vInfo.xoffset * FBPainter::getBytesPerPixel(
+            pixelFormat);
+}
+
+
+// Gets the driver's current y-offset.
+size_t FBPainter::FbdevBackend::getYOffset() const
+{
+    return vInfo.yoffset;
+}
+
+
+// Asks the driver to change the virtual height, remapping the buffer if the
+// driver agrees.
+bool FBPainter::FbdevBackend::setVirtualHeight(const size_t virtualHeight)
+{
+    if (bufferData == nullptr || virtualHeight == vInfo.yres_virtual)
+    {
+        return false;
+    }
+    struct fb_var_screeninfo requestedInfo = vInfo;
+    requestedInfo.yres_virtual = virtualHeight;
+    requestedInfo.yoffset = 0;
+    if (ioctl(bufferFD, FBIOPUT_VSCREENINFO, &requestedInfo) == -1
+            || ioctl(bufferFD, FBIOGET_VSCREENINFO, &vInfo) == -1
+            || ioctl(bufferFD, FBIOGET_FSCREENINFO, &fInfo) == -1)
+    {
+        return false;
+    }
+    if (vInfo.yres_virtual * fInfo.line_length != bufferSize)
+    {
+        munmap(bufferData, bufferSize);
+        bufferData = nullptr;
+        if (! mapBuffer())
+        {
+            return false;
+        }
+    }
+    return vInfo.yres_virtual == virtualHeight;
+}
+
+
+// Changes the visible page with FBIOPAN_DISPLAY.
+bool FBPainter::FbdevBackend::panTo(const size_t yOffset)
+{
+    struct fb_var_screeninfo panInfo = vInfo;
+    panInfo.yoffset = yOffset;
+    if (ioctl(bufferFD, FBIOPAN_DISPLAY, &panInfo) == -1)
+    {
+        perror("Frame buffer page flip failed");
+        return false;
+    }
+    vInfo.yoffset = panInfo.yoffset;
+    return true;
+}
+
+
+// Waits for vertical sync with FBIO_WAITFORVSYNC, if the driver supports it.
+void FBPainter::FbdevBackend::waitForVSync()
+{
+    // Not all drivers support this, so errors are ignored:
+    int screen = 0;
+    ioctl(bufferFD, FBIO_WAITFORVSYNC, &screen);
+}
+
+
+// Finds the pixel format described by frame buffer display info.
+FBPainter::PixelFormat FBPainter::FbdevBackend::findPixelFormat
+(const struct fb_var_screeninfo& displayInfo)
+{
+    const uint32_t red = displayInfo.red.offset;
+    const uint32_t green = displayInfo.green.offset;
+    const uint32_t blue = displayInfo.blue.offset;
+    switch (displayInfo.bits_per_pixel)
+    {
+        case 16:
+            if (red == 11 && green == 5 && blue == 0
+                    && displayInfo.green.length == 6)
+            {
+                return PixelFormat::RGB565;
+            }
+            break;
+        case 24:
+            if (red == 16 && green == 8 && blue == 0)
+            {
+                return PixelFormat::RGB888;
+            }
+            break;
+        case 32:
+            if (red == 16 && green == 8 && blue == 0)
+            {
+                return PixelFormat::XRGB8888;
+            }
+            if (red == 0 && green == 8 && blue == 16)
+            {
+                return PixelFormat::XBGR8888;
+            }
+            if (red == 8 && green == 16 && blue == 24)
+            {
+                return PixelFormat::BGRA8888;
+            }
+            break;
+    }
+    return PixelFormat::Unknown;
+}
+
+
+// Maps the frame buffer device's memory, closing the buffer if mapping fails.
+bool FBPainter::FbdevBackend::mapBuffer()
+{
+    bufferSize = vInfo.yres_virtual * fInfo.line_length;
+    bufferData = (uint8_t*) mmap(0, bufferSize, PROT_READ | PROT_WRITE,
+                        MAP_SHARED, bufferFD, (off_t) 0);
+    if (bufferData == MAP_FAILED)
+    {
+        perror("Failed to map frame buffer to memory");
+        bufferData = nullptr;
+        closeAndClearData();
+        return false;
+    }
+    return true;
+}
+
+
+// Unmaps the frame buffer from memory, closes the buffer file, and clears all
+// buffer information.
+void FBPainter::FbdevBackend::closeAndClearData()
+{
+    if (bufferData != nullptr)
+    {
+        munmap(bufferData, bufferSize);
+        bufferData = nullptr;
+    }
+    if (bufferFD != 0)
+    {
+        close(bufferFD);
+        bufferFD = 0;
+    }
+    fInfo = {};
+    vInfo = {};
+    bufferSize = 0;
+    pixelFormat = PixelFormat::Unknown;
+}
@@ -0,0 +1,159 @@
+/**
+ * @file  FbdevBackend.h
+ *
+ * @brief  Provides FrameBuffer memory from a Linux frame buffer device.
+ */
+
+#pragma once
+#include "FrameBufferBackend.h"
+#include <linux/fb.h>
+
+namespace FBPainter
+{
+    class FbdevBackend;
+}
+
+/**
+ * @brief  Memory maps a Linux frame buffer device file, such as /dev/fb0.
+ */
+class FBPainter::FbdevBackend : public FrameBufferBackend
+{
+public:
+    /**
+     * @brief  Opens and memory maps the frame buffer file.
+     *
+     *  32-bit color is requested when the device is opened, but the driver's
+     * current mode is kept if that request fails.
+     *
+     * @param bufferPath  The path to the frame buffer file.
+     */
+    FbdevBackend(const char* bufferPath);
+
+    /**
+     * @brief  Closes and unmaps the frame buffer file on destruction.
+     */
+    virtual ~FbdevBackend();
+
+    /**
+     * @brief  Checks if the buffer is open and memory mapped.
+     *
+     * @return  Whether the frame buffer is open and ready for IO.
+     */
+    bool isOpen() const override;
+
+    /**
+     * @brief  Gets the visible width of the display.
+     *
+     * @return  The display width in pixels.
+     */
+    size_t getWidth() const override;
+
+    /**
+     * @brief  Gets the visible height of the display.
+     *
+     * @return  The display height in pixels.
+     */
+    size_t getHeight() const override;
+
+    /**
+     * @brief  Gets the virtual height reported by the driver.
+     *
+     * @return  The total height of the mapped buffer in pixels.
+     */
+    size_t getVirtualHeight() const override;
+
+    /**
+     * @brief  Gets the line length reported by the driver.
+     *
+     * @return  The row stride in bytes.
+     */
+    size_t getStride() const override;
+
+    /**
+     * @brief  Gets the pixel format detected when the device was opened.
+     *
+     * @return  The device's pixel format.
+     */
+    PixelFormat getPixelFormat() const override;
+
+    /**
+     * @brief  Gets the address of the first display page in the buffer's
+     *         memory map.
+     *
+     * @return  The address of the page's top left pixel, or nullptr if the
+     *          buffer is closed.
+     */
+    uint8_t* getData() const override;
+
+    /**
+     * @brief  Gets the driver's current y-offset.
+     *
+     * @return  The index of the first visible row.
+     */
+    size_t getYOffset() const override;
+
+    /**
+     * @brief  Asks the driver to change the virtual height, remapping the
+     *         buffer if the driver agrees.
+     *
+     * @param virtualHeight  The requested virtual height in pixels.
+     *
+     * @return               Whether the virtual height changed.
+     */
+    bool setVirtualHeight(const size_t virtualHeight) override;
+
+    /**
+     * @brief  Changes the visible page with FBIOPAN_DISPLAY.
+     *
+     * @param yOffset  The new y-offset of the visible display page.
+     *
+     * @return         Whether the display was panned successfully.
+     */
+    bool panTo(const size_t yOffset) override;
+
+    /**
+     * @brief  Waits for vertical sync with FBIO_WAITFORVSYNC, if the driver
+     *         supports it.
+     */
+    void waitForVSync() override;
+
+private:
+    /**
+     * @brief  Finds the pixel format described by frame buffer display info.
+     *
+     * @param displayInfo  Variable display info read from the frame buffer.
+     *
+     * @return             The matching pixel format, or PixelFormat::Unknown
+     *                     if the format is not supported.
+     */
+    static PixelFormat findPixelFormat(
+            const struct fb_var_screeninfo& displayInfo);
+
+    /**
+     * @brief  Maps the frame buffer device's memory, closing the buffer if
+     *         mapping fails.
+     *
+     * @return  Whether the buffer was mapped successfully.
+     */
+    bool mapBuffer();
+
+    /**
+     * @brief  Unmaps the frame buffer from memory, closes the buffer file, and
+     *         clears all buffer information.
+     */
+    void closeAndClearData();
+
+    // Stored display info:
+	struct fb_fix_screeninfo fInfo = {};
+	struct fb_var_screeninfo vInfo = {};
+
+    // FrameBuffer file descriptor:
+	int bufferFD = 0;
+
+    // FrameBuffer file mapped to memory with mmap:
+    uint8_t* bufferData = nullptr;
+    size_t bufferSize = 0;
+
+    // The detected pixel layout:
+    PixelFormat pixelFormat = PixelFormat::Unknown;
+};
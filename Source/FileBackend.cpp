@@ -0,0 +1,23 @@
+#include "FileBackend.h"
+#include <fcntl.h>
+#include <stdio.h>
+
+
+// Opens or creates a file, and maps it as frame buffer memory.
+FBPainter::FileBackend::FileBackend(const char* filePath, const size_t width,
+        const size_t height, const PixelFormat format, const size_t stride,
+        const size_t virtualHeight) :
+    MemoryBackend(width, height, format, stride, virtualHeight,
+            openFile(filePath)) { }
+
+
+// Opens or creates a file for reading and writing.
+int FBPainter::FileBackend::openFile(const char* filePath)
+{
+    const int fileDescriptor = open(filePath, O_RDWR | O_CREAT, 0644);
+    if (fileDescriptor == -1)
+    {
+        perror("Opening frame buffer file failed");
+    }
+    return fileDescriptor;
+}
@@ -0,0 +1,59 @@
+/**
+ * @file  FileBackend.h
+ *
+ * @brief  Provides FrameBuffer memory by mapping a regular file.
+ */
+
+#pragma once
+#include "MemoryBackend.h"
+
+namespace FBPainter
+{
+    class FileBackend;
+}
+
+/**
+ * @brief  Maps a regular file with a configurable resolution, stride, and
+ *         pixel format.
+ *
+ *  The file is created if necessary and resized to hold every display page.
+ * Raw pixel data written through the FrameBuffer is visible to any other
+ * process that maps or reads the same file.
+ */
+class FBPainter::FileBackend : public MemoryBackend
+{
+public:
+    /**
+     * @brief  Opens or creates a file, and maps it as frame buffer memory.
+     *
+     * @param filePath       The path to the file. If it can't be opened, an
+     *                       error is printed and the backend won't be open.
+     *
+     * @param width          The display width in pixels.
+     *
+     * @param height         The display height in pixels.
+     *
+     * @param format         The pixel format to use.
+     *
+     * @param stride         The number of bytes between the start of each
+     *                       row, or zero to pack rows tightly.
+     *
+     * @param virtualHeight  The total height of all display pages, or zero
+     *                       to map a single page.
+     */
+    FileBackend(const char* filePath, const size_t width, const size_t height,
+            const PixelFormat format = PixelFormat::XRGB8888,
+            const size_t stride = 0, const size_t virtualHeight = 0);
+
+    virtual ~FileBackend() { }
+
+private:
+    /**
+     * @brief  Opens or creates a file for reading and writing.
+     *
+     * @param filePath  The path to the file.
+     *
+     * @return          The open file descriptor, or -1 if opening failed.
+     */
+    static int openFile(const char* filePath);
+};
@@ -0,0 +1,221 @@
+#include "FillKernels.h"
+#include <cstring>
+#if defined(__x86_64__) || defined(__i386__)
+    #include <immintrin.h>
+    #define FBP_FILL_X86 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+    #include <arm_neon.h>
+    #define FBP_FILL_NEON 1
+#endif
+
+// Kernels fill memory one block at a time. Blocks hold a whole number of
+// pixels for every supported pixel size, and a whole number of 32-byte
+// vectors:
+static const constexpr size_t blockSize = 96;
+// Kernels start writing at an address aligned to this many bytes:
+static const constexpr size_t alignment = 32;
+
+/**
+ * @brief  Writes a repeating block of pixel data.
+ *
+ * @param dest        An address aligned to the alignment constant.
+ *
+ * @param block       blockSize bytes of pixel data to repeat.
+ *
+ * @param blockCount  The number of times to copy the block.
+ *
+ * @param streaming   Whether to bypass the cache if possible.
+ */
+typedef void (*FillKernel)(uint8_t* dest, const uint8_t* block,
+        size_t blockCount, bool streaming);
+
+
+// Writes repeating blocks with ordinary memory copies.
+static void fillScalar(uint8_t* dest, const uint8_t* block,
+        size_t blockCount, bool /* streaming */)
+{
+    for (size_t i = 0; i < blockCount; i++)
+    {
+        memcpy(dest + i * blockSize, block, blockSize);
+    }
+}
+
+
+#ifdef FBP_FILL_X86
+// Writes repeating blocks with 16-byte SSE2 stores.
+__attribute__((target("sse2")))
+static void fillSSE2(uint8_t* dest, const uint8_t* block, size_t blockCount,
+        bool streaming)
+{
+    __m128i vectors[blockSize / 16];
+    for (size_t v = 0; v < blockSize / 16; v++)
+    {
+        vectors[v] = _mm_loadu_si128(
+                reinterpret_cast<const __m128i*>(block + v * 16));
+    }
+    __m128i* out = reinterpret_cast<__m128i*>(dest);
+    if (streaming)
+    {
+        for (size_t i = 0; i < blockCount; i++)
+        {
+            for (size_t v = 0; v < blockSize / 16; v++)
+            {
+                _mm_stream_si128(out++, vectors[v]);
+            }
+        }
+        _mm_sfence();
+        return;
+    }
+    for (size_t i = 0; i < blockCount; i++)
+    {
+        for (size_t v = 0; v < blockSize / 16; v++)
+        {
+            _mm_store_si128(out++, vectors[v]);
+        }
+    }
+}
+
+
+// Writes repeating blocks with 32-byte AVX2 stores.
+__attribute__((target("avx2")))
+static void fillAVX2(uint8_t* dest, const uint8_t* block, size_t blockCount,
+        bool streaming)
+{
+    const __m256i first = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i*>(block));
+    const __m256i second = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i*>(block + 32));
+    const __m256i third = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i*>(block + 64));
+    __m256i* out = reinterpret_cast<__m256i*>(dest);
+    if (streaming)
+    {
+        for (size_t i = 0; i < blockCount; i++, out += 3)
+        {
+            _mm256_stream_si256(out, first);
+            _mm256_stream_si256(out + 1, second);
+            _mm256_stream_si256(out + 2, third);
+        }
+        _mm_sfence();
+    }
+    else
+    {
+        for (size_t i = 0; i < blockCount; i++, out += 3)
+        {
+            _mm256_store_si256(out, first);
+            _mm256_store_si256(out + 1, second);
+            _mm256_store_si256(out + 2, third);
+        }
+    }
+    _mm256_zeroupper();
+}
+#endif
+
+
+#ifdef FBP_FILL_NEON
+// Writes repeating blocks with 16-byte NEON stores. NEON has no intrinsic for
+// non-temporal stores, so streaming fills use ordinary stores.
+static void fillNEON(uint8_t* dest, const uint8_t* block, size_t blockCount,
+        bool /* streaming */)
+{
+    uint8x16_t vectors[blockSize / 16];
+    for (size_t v = 0; v < blockSize / 16; v++)
+    {
+        vectors[v] = vld1q_u8(block + v * 16);
+    }
+    for (size_t i = 0; i < blockCount; i++)
+    {
+        for (size_t v = 0; v < blockSize / 16; v++, dest += 16)
+        {
+            vst1q_u8(dest, vectors[v]);
+        }
+    }
+}
+#endif
+
+
+// Selects the fastest fill kernel this CPU supports, along with its name.
+static FillKernel selectKernel(const char** name)
+{
+#ifdef FBP_FILL_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+    {
+        *name = "avx2";
+        return fillAVX2;
+    }
+    if (__builtin_cpu_supports("sse2"))
+    {
+        *name = "sse2";
+        return fillSSE2;
+    }
+#elif defined(FBP_FILL_NEON)
+    *name = "neon";
+    return fillNEON;
+#endif
+    *name = "scalar";
+    return fillScalar;
+}
+
+
+// Gets the selected kernel, choosing it on the first call.
+static FillKernel getKernel(const char** name = nullptr)
+{
+    static const char* kernelName = nullptr;
+    static const FillKernel kernel = selectKernel(&kernelName);
+    if (name != nullptr)
+    {
+        *name = kernelName;
+    }
+    return kernel;
+}
+
+
+// Sets a run of pixels to one value.
+void FBPainter::fillPixels(void* dest, const uint32_t value,
+        const size_t bytesPerPixel, const size_t count, const bool streaming)
+{
+    uint8_t* out = static_cast<uint8_t*>(dest);
+    const uint8_t* valueBytes = reinterpret_cast<const uint8_t*>(&value);
+    const size_t byteCount = count * bytesPerPixel;
+    if (bytesPerPixel == 0 || bytesPerPixel > 4)
+    {
+        return;
+    }
+    if (byteCount < alignment + blockSize)
+    {
+        for (size_t i = 0; i < count; i++, out += bytesPerPixel)
+        {
+            memcpy(out, valueBytes, bytesPerPixel);
+        }
+        return;
+    }
+
+    // Fill unaligned leading bytes, then build a block starting from the
+    // next byte of the pixel pattern:
+    const size_t headBytes = (alignment
+            - (reinterpret_cast<uintptr_t>(out) % alignment)) % alignment;
+    uint8_t block[blockSize];
+    for (size_t i = 0; i < headBytes; i++)
+    {
+        out[i] = valueBytes[i % bytesPerPixel];
+    }
+    for (size_t i = 0; i < blockSize; i++)
+    {
+        block[i] = valueBytes[(headBytes + i) % bytesPerPixel];
+    }
+    out += headBytes;
+    const size_t blockCount = (byteCount - headBytes) / blockSize;
+    getKernel()(out, block, blockCount, streaming);
+    out += blockCount * blockSize;
+    memcpy(out, block, (byteCount - headBytes) % blockSize);
+}
+
+
+// Gets the name of the fill kernel selected for this CPU.
+const char* FBPainter::getFillKernelName()
+{
+    const char* name;
+    getKernel(&name);
+    return name;
+}
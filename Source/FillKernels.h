@@ -0,0 +1,53 @@
+/**
+ * @file  FillKernels.h
+ *
+ * @brief  Fills pixel memory with a single color using the fastest vector
+ *         instructions the CPU supports.
+ */
+
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+namespace FBPainter
+{
+    /**
+     * @brief  The smallest fill, in bytes, that FrameBuffer writes with
+     *         streaming stores.
+     *
+     *  Streaming stores bypass the cache, which is much faster for large
+     * fills of uncached or write-combined frame buffer memory, but makes
+     * small fills slower to read back.
+     */
+    static const constexpr size_t streamingFillBytes = 256 * 1024;
+
+    /**
+     * @brief  Sets a run of pixels to one value.
+     *
+     *  The first call selects an AVX2, SSE2, NEON, or portable kernel based
+     * on the CPU, and every later call reuses that selection.
+     *
+     * @param dest           Memory holding count pixels to update. This does
+     *                       not need any particular alignment.
+     *
+     * @param value          The pixel value to copy, stored in the lowest
+     *                       bytesPerPixel bytes.
+     *
+     * @param bytesPerPixel  The size of each pixel, from one to four bytes.
+     *
+     * @param count          The number of pixels to update.
+     *
+     * @param streaming      Whether to use non-temporal stores that bypass
+     *                       the cache, if the kernel supports them.
+     */
+    void fillPixels(void* dest, const uint32_t value,
+            const size_t bytesPerPixel, const size_t count,
+            const bool streaming = false);
+
+    /**
+     * @brief  Gets the name of the fill kernel selected for this CPU.
+     *
+     * @return  "avx2", "sse2", "neon", or "scalar".
+     */
+    const char* getFillKernelName();
+}
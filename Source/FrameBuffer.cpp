@@ -1,50 +1,41 @@
 #include "FrameBuffer.h"
+#include "FbdevBackend.h"
 #include <algorithm>
-#include <iostream>
-#include <fcntl.h>
-#include <unistd.h>
+#include <cstring>
 #include <stdio.h>
-#include <errno.h>
-#include <sys/mman.h>
-#include <sys/ioctl.h>
 
 
-// Opens and memory maps the frame buffer file.
-FBPainter::FrameBuffer::FrameBuffer(const char* bufferPath)
+// Opens and memory maps a Linux frame buffer device file.
+FBPainter::FrameBuffer::FrameBuffer(const char* bufferPath) :
+    FrameBuffer(new FbdevBackend(bufferPath)) { }
+
+
+// Draws into memory provided by a frame buffer backend.
+FBPainter::FrameBuffer::FrameBuffer(FrameBufferBackend* backend) :
+    backend(backend)
 {
-    errno = 0;
-    bufferFD = open(bufferPath, O_RDWR);
-    if (bufferFD == -1)
+    if (backend == nullptr || ! backend->isOpen())
     {
-        perror("Opening frame buffer file failed");
-        return;
-    }
-    using std::min;
-    int ioResult = min(0, ioctl(bufferFD, FBIOGET_VSCREENINFO, &vInfo)); 
-    vInfo.grayscale = 0;
-    vInfo.bits_per_pixel = 32;
-    ioResult = min(ioResult, ioctl(bufferFD, FBIOPUT_VSCREENINFO, &vInfo)); 
-    ioResult = min(ioResult, ioctl(bufferFD, FBIOGET_VSCREENINFO, &vInfo)); 
-    ioResult = min(ioResult, ioctl(bufferFD, FBIOGET_FSCREENINFO, &fInfo)); 
-    if (ioResult == -1)
-    {
-        perror("Reading frame buffer info failed");
         closeAndClearData();
         return;
     }
-    bufferSize = vInfo.yres_virtual * fInfo.line_length;
-    bufferData = (uint8_t*) mmap(0, bufferSize, PROT_READ | PROT_WRITE,
-                        MAP_SHARED, bufferFD, (off_t) 0);
-    if (bufferData == MAP_FAILED)
+    pixelFormat = backend->getPixelFormat();
+    converter = PixelConverter::forFormat(pixelFormat);
+    if (converter == nullptr)
     {
-        perror("Failed to map frame buffer to memory");
-        bufferData = nullptr;
+        fprintf(stderr, "Unsupported frame buffer pixel format\n");
         closeAndClearData();
+        return;
     }
+    bytesPerPixel = FBPainter::getBytesPerPixel(pixelFormat);
+    bufferData = backend->getData();
+    width = backend->getWidth();
+    height = backend->getHeight();
+    stride = backend->getStride();
 }
 
 
-// Closes and unmaps the frame buffer file on destruction.
+// Flushes pending changes and releases the backend on destruction.
 FBPainter::FrameBuffer::~FrameBuffer()
 {
     closeAndClearData();
@@ -61,14 +52,36 @@ bool FBPainter::FrameBuffer::isBufferOpen() const
 // Gets the frame buffer's width.
 size_t FBPainter::FrameBuffer::getWidth() const
 {
-    return vInfo.xres;
+    return width;
 }
 
 
 // Gets the frame buffer's height.
 size_t FBPainter::FrameBuffer::getHeight() const
 {
-    return vInfo.yres;
+    return height;
+}
+
+
+// Gets the layout of pixels in the buffer.
+FBPainter::PixelFormat FBPainter::FrameBuffer::getPixelFormat() const
+{
+    return pixelFormat;
+}
+
+
+// Gets the number of bytes used to store each pixel in the buffer.
+size_t FBPainter::FrameBuffer::getBytesPerPixel() const
+{
+    return bytesPerPixel;
+}
+
+
+// Gets the number of single pixel reads or writes that were ignored because
+// they were out of bounds.
+size_t FBPainter::FrameBuffer::getOutOfBoundsCount() const
+{
+    return outOfBoundsCount;
 }
 
 
@@ -76,15 +89,14 @@ size_t FBPainter::FrameBuffer::getHeight() const
 FBPainter::RGBPixel FBPainter::FrameBuffer::getPixel
 (const size_t xPos, const size_t yPos)
 {
-    uint32_t* pixelPtr = getMappedPoint(xPos, yPos);
+    uint8_t* pixelPtr = getMappedPoint(xPos, yPos);
     if (pixelPtr == nullptr)
     {
         return RGBPixel(0, 0, 0);
     }
-    const uint32_t cValue = *pixelPtr;
-    return RGBPixel((uint8_t) (cValue >> vInfo.red.offset),
-            (uint8_t) (cValue >> vInfo.green.offset),
-            (uint8_t) (cValue >> vInfo.blue.offset));
+    uint32_t rgb;
+    converter->unpackSpan(pixelPtr, &rgb, 1);
+    return RGBPixel(rgb >> 16, rgb >> 8, rgb);
 }
 
 
@@ -92,64 +104,562 @@ FBPainter::RGBPixel FBPainter::FrameBuffer::getPixel
 void FBPainter::FrameBuffer::setPixel(const size_t xPos, const size_t yPos,
         const RGBPixel color)
 {
-    uint32_t* pixelPtr = getMappedPoint(xPos, yPos);
+    uint8_t* pixelPtr = getMappedPoint(xPos, yPos);
     if (pixelPtr == nullptr)
     {
         return;
     }
-    *pixelPtr = getPixelColor(color);
+    const uint32_t rgb = (color.getRed() << 16) | (color.getGreen() << 8)
+            | color.getBlue();
+    converter->packSpan(&rgb, pixelPtr, 1);
+    commitWrite(xPos, yPos, 1, 1);
+}
+
+
+// Copies a row of pixels out of the frame buffer.
+size_t FBPainter::FrameBuffer::readSpan
+(const size_t xPos, const size_t yPos, void* dest, const size_t count)
+{
+    const size_t clippedCount = clipSpan(xPos, yPos, count);
+    if (clippedCount > 0)
+    {
+        memcpy(dest, getMappedPoint(xPos, yPos), clippedCount * bytesPerPixel);
+    }
+    return clippedCount;
+}
+
+
+// Copies a row of pixels into the frame buffer.
+void FBPainter::FrameBuffer::writeSpan(const size_t xPos, const size_t yPos,
+        const void* source, const size_t count)
+{
+    const size_t clippedCount = clipSpan(xPos, yPos, count);
+    if (clippedCount > 0)
+    {
+        memcpy(getMappedPoint(xPos, yPos), source,
+                clippedCount * bytesPerPixel);
+        commitWrite(xPos, yPos, clippedCount, 1);
+    }
+}
+
+
+// Reads a row of pixels out of the frame buffer as 0x00RRGGBB color values.
+size_t FBPainter::FrameBuffer::readSpanRGB
+(const size_t xPos, const size_t yPos, uint32_t* dest, const size_t count)
+{
+    const size_t clippedCount = clipSpan(xPos, yPos, count);
+    if (clippedCount > 0)
+    {
+        converter->unpackSpan(getMappedPoint(xPos, yPos), dest, clippedCount);
+    }
+    return clippedCount;
+}
+
+
+// Writes a row of 0x00RRGGBB color values into the frame buffer.
+void FBPainter::FrameBuffer::writeSpanRGB(const size_t xPos,
+        const size_t yPos, const uint32_t* source, const size_t count)
+{
+    const size_t clippedCount = clipSpan(xPos, yPos, count);
+    if (clippedCount > 0)
+    {
+        converter->packSpan(source, getMappedPoint(xPos, yPos), clippedCount);
+        commitWrite(xPos, yPos, clippedCount, 1);
+    }
+}
+
+
+// Copies a rectangle of packed pixel data into the frame buffer.
+void FBPainter::FrameBuffer::blitRect(const size_t xPos, const size_t yPos,
+        const size_t width, const size_t height, const void* source,
+        const size_t sourceStride)
+{
+    const size_t clippedWidth = clipSpan(xPos, yPos, width);
+    if (clippedWidth == 0)
+    {
+        return;
+    }
+    const size_t clippedHeight = std::min(height, getHeight() - yPos);
+    const size_t rowBytes = clippedWidth * bytesPerPixel;
+    const uint8_t* sourceRow = static_cast<const uint8_t*>(source);
+    uint8_t* rowStart = getMappedPoint(xPos, yPos);
+    for (size_t y = 0; y < clippedHeight; y++)
+    {
+        memcpy(rowStart, sourceRow, rowBytes);
+        rowStart += getMappedStride();
+        sourceRow += sourceStride;
+    }
+    commitWrite(xPos, yPos, clippedWidth, clippedHeight);
 }
 
 
-// Unmaps the frame buffer from memory, closes the buffer file, and clears all
-// buffer information.
+// Copies a rectangle of pixels to another position in the frame buffer.
+void FBPainter::FrameBuffer::moveRect(const size_t xPos, const size_t yPos,
+        const size_t width, const size_t height, const size_t destX,
+        const size_t destY)
+{
+    const size_t clippedWidth = std::min(clipSpan(xPos, yPos, width),
+            clipSpan(destX, destY, width));
+    if (clippedWidth == 0)
+    {
+        return;
+    }
+    const size_t clippedHeight = std::min(height,
+            getHeight() - std::max(yPos, destY));
+    const size_t rowBytes = clippedWidth * bytesPerPixel;
+    const size_t rowStride = getMappedStride();
+    uint8_t* sourceRow = getMappedPoint(xPos, yPos);
+    uint8_t* destRow = getMappedPoint(destX, destY);
+    if (destY > yPos)
+    {
+        // Copy from the bottom up, so source rows are read before they're
+        // overwritten:
+        for (size_t y = clippedHeight; y > 0; y--)
+        {
+            memmove(destRow + (y - 1) * rowStride,
+                    sourceRow + (y - 1) * rowStride, rowBytes);
+        }
+    }
+    else
+    {
+        for (size_t y = 0; y < clippedHeight; y++)
+        {
+            memmove(destRow + y * rowStride, sourceRow + y * rowStride,
+                    rowBytes);
+        }
+    }
+    commitWrite(destX, destY, clippedWidth, clippedHeight);
+}
+
+
+// Sets every pixel within a rectangle to a single color.
+void FBPainter::FrameBuffer::fillRect(const size_t xPos, const size_t yPos,
+        const size_t width, const size_t height, const RGBPixel color)
+{
+    const size_t clippedWidth = clipSpan(xPos, yPos, width);
+    if (clippedWidth == 0)
+    {
+        return;
+    }
+    const size_t clippedHeight = std::min(height, getHeight() - yPos);
+    const uint32_t colorValue = getPixelColor(color);
+    const size_t rowBytes = clippedWidth * bytesPerPixel;
+    const bool streaming
+            = rowBytes * clippedHeight >= FBPainter::streamingFillBytes;
+    uint8_t* rowStart = getMappedPoint(xPos, yPos);
+    if (rowBytes == getMappedStride())
+    {
+        // Rows are contiguous, so fill them all at once:
+        fillPixels(rowStart, colorValue, bytesPerPixel,
+                clippedWidth * clippedHeight, streaming);
+    }
+    else
+    {
+        for (size_t y = 0; y < clippedHeight; y++)
+        {
+            fillPixels(rowStart, colorValue, bytesPerPixel, clippedWidth,
+                    streaming);
+            rowStart += getMappedStride();
+        }
+    }
+    commitWrite(xPos, yPos, clippedWidth, clippedHeight);
+}
+
+
+// Sets every pixel in the buffer to a single color.
+void FBPainter::FrameBuffer::clear(const RGBPixel color)
+{
+    fillRect(0, 0, width, height, color);
+}
+
+
+// Gets how the frame buffer uses a shadow copy of its contents in system
+// memory.
+FBPainter::FrameBuffer::ShadowMode FBPainter::FrameBuffer::getShadowMode()
+        const
+{
+    return shadowMode;
+}
+
+
+// Selects how the frame buffer uses a shadow copy of its contents in system
+// memory.
+void FBPainter::FrameBuffer::setShadowMode(const ShadowMode mode)
+{
+    if (mode == shadowMode || bufferData == nullptr)
+    {
+        return;
+    }
+    if (pageCount > 1)
+    {
+        // Page flipping needs a deferred shadow buffer, so turn it off first:
+        setPageCount(1);
+        if (mode == shadowMode)
+        {
+            return;
+        }
+    }
+    if (mode == ShadowMode::Disabled)
+    {
+        flush();
+        shadowBuffer.clear();
+        shadowBuffer.shrink_to_fit();
+        shadowStride = 0;
+    }
+    else if (shadowMode == ShadowMode::Disabled)
+    {
+        // Read the device once, so the shadow starts out matching the screen:
+        shadowStride = getWidth() * bytesPerPixel;
+        shadowBuffer.resize(shadowStride * getHeight());
+        for (size_t y = 0; y < getHeight(); y++)
+        {
+            memcpy(&shadowBuffer[y * shadowStride], getDevicePoint(0, y),
+                    shadowStride);
+        }
+    }
+    else
+    {
+        flush();
+    }
+    shadowMode = mode;
+}
+
+
+// Copies all changes made to the shadow buffer since the last flush into the
+// frame buffer device.
+void FBPainter::FrameBuffer::flush()
+{
+    if (pageCount > 1)
+    {
+        present(false);
+        return;
+    }
+    if (shadowMode != ShadowMode::Deferred || damage.isEmpty())
+    {
+        return;
+    }
+    uint8_t* const visibleOrigin = getDevicePoint(0, 0);
+    for (const Rectangle& area : damage.getRects())
+    {
+        copyShadowRect(area, visibleOrigin);
+    }
+    damage.clear();
+}
+
+
+// Gets the areas changed in the shadow buffer that have not been flushed or
+// presented yet.
+const FBPainter::DamageRegion& FBPainter::FrameBuffer::getDamage() const
+{
+    return damage;
+}
+
+
+// Gets the number of display pages the frame buffer cycles through when
+// presenting frames.
+size_t FBPainter::FrameBuffer::getPageCount() const
+{
+    return pageCount;
+}
+
+
+// Enables or disables double or triple buffering.
+bool FBPainter::FrameBuffer::setPageCount(const size_t requestedCount)
+{
+    if (bufferData == nullptr)
+    {
+        return false;
+    }
+    if (requestedCount <= 1)
+    {
+        if (pageCount > 1)
+        {
+            // Return to the first page, and make sure it is up to date:
+            copyShadowRect(getBounds(), getPageOrigin(0));
+            panToPage(0);
+            pageCount = 1;
+            pageDamage.clear();
+            damage.clear();
+        }
+        return false;
+    }
+
+    // All drawing now goes to the shadow buffer, and frames only reach the
+    // device when presented:
+    if (shadowMode != ShadowMode::Deferred)
+    {
+        setShadowMode(ShadowMode::Deferred);
+    }
+    if (backend->getVirtualHeight() < height * requestedCount)
+    {
+        // Ask the backend for more virtual height, which may move its memory:
+        backend->setVirtualHeight(height * requestedCount);
+        bufferData = backend->getData();
+        stride = backend->getStride();
+        if (bufferData == nullptr)
+        {
+            closeAndClearData();
+            return false;
+        }
+    }
+    const size_t availableCount = std::min<size_t>(requestedCount,
+            backend->getVirtualHeight() / height);
+    if (availableCount < 2)
+    {
+        // Without room for a second page, present by copying from the
+        // shadow buffer instead:
+        pageCount = 1;
+        return false;
+    }
+
+    // Fill every page with the current frame, and start on the first page:
+    pageCount = availableCount;
+    for (size_t page = 0; page < pageCount; page++)
+    {
+        copyShadowRect(getBounds(), getPageOrigin(page));
+    }
+    if (! panToPage(0))
+    {
+        pageCount = 1;
+        return false;
+    }
+    pageDamage.assign(pageCount, DamageRegion(damage.getMaxRects()));
+    damage.clear();
+    return true;
+}
+
+
+// Shows all changes made since the last frame was presented.
+void FBPainter::FrameBuffer::present(const bool waitForVSync)
+{
+    if (bufferData == nullptr)
+    {
+        return;
+    }
+    if (pageCount < 2)
+    {
+        if (waitForVSync)
+        {
+            waitForVerticalSync();
+        }
+        flush();
+        return;
+    }
+
+    // Every page that isn't the target missed this frame's changes, and must
+    // be updated before it is shown again:
+    if (! damage.isEmpty())
+    {
+        for (DamageRegion& missedDamage : pageDamage)
+        {
+            missedDamage.add(damage);
+        }
+        damage.clear();
+    }
+    const size_t targetPage = (displayedPage + 1) % pageCount;
+    DamageRegion& targetDamage = pageDamage[targetPage];
+    if (targetDamage.isEmpty())
+    {
+        return;
+    }
+    uint8_t* const pageOrigin = getPageOrigin(targetPage);
+    for (const Rectangle& area : targetDamage.getRects())
+    {
+        copyShadowRect(area, pageOrigin);
+    }
+    targetDamage.clear();
+    panToPage(targetPage);
+    if (waitForVSync)
+    {
+        waitForVerticalSync();
+    }
+}
+
+
+// Gets the backend that provides the buffer's memory.
+FBPainter::FrameBufferBackend* FBPainter::FrameBuffer::getBackend() const
+{
+    return backend.get();
+}
+
+
+// Flushes pending changes, releases the backend, and clears all buffer
+// information.
 void FBPainter::FrameBuffer::closeAndClearData()
 {
     if (bufferData != nullptr)
     {
-        munmap(bufferData, bufferSize);
+        flush();
         bufferData = nullptr;
     }
-    if (bufferFD != 0)
-    {
-        close(bufferFD);
-        bufferFD = 0;
-    }
-    fInfo = {0};
-    vInfo = {0};
-    bufferSize = 0;
+    backend.reset();
+    width = 0;
+    height = 0;
+    stride = 0;
+    pixelFormat = PixelFormat::Unknown;
+    converter = nullptr;
+    bytesPerPixel = 0;
+    shadowMode = ShadowMode::Disabled;
+    shadowBuffer.clear();
+    shadowBuffer.shrink_to_fit();
+    shadowStride = 0;
+    damage.clear();
+    pageCount = 1;
+    displayedPage = 0;
+    pageDamage.clear();
 }
 
 
-// Gets a 32-bit frame buffer color value from RGB color values.
+// Gets a frame buffer color value from RGB color values.
 uint32_t FBPainter::FrameBuffer::getPixelColor
 (const uint8_t red, const uint8_t green, const uint8_t blue) const
 {
-    return (red << vInfo.red.offset)
-        | (green << vInfo.green.offset)
-        | (blue << vInfo.blue.offset);
+    if (converter == nullptr)
+    {
+        return 0;
+    }
+    return converter->packColor((red << 16) | (green << 8) | blue);
 }
 
 
-// Gets a 32-bit frame buffer color value from a RGBPixel object.
+// Gets a frame buffer color value from a RGBPixel object.
 uint32_t FBPainter::FrameBuffer::getPixelColor(const RGBPixel& pixel) const
 {
     return getPixelColor(pixel.getRed(), pixel.getGreen(), pixel.getBlue());
 }
 
 
-// Gets the address in the frame buffer memory map where a specific
-// coordinate's pixel color is stored.
-uint32_t* FBPainter::FrameBuffer::getMappedPoint
+// Gets the RGBPixel represented by a frame buffer color value.
+FBPainter::RGBPixel FBPainter::FrameBuffer::getRGBPixel(const uint32_t color)
+        const
+{
+    if (converter == nullptr)
+    {
+        return RGBPixel(0, 0, 0);
+    }
+    const uint32_t rgb = converter->unpackColor(color);
+    return RGBPixel(rgb >> 16, rgb >> 8, rgb);
+}
+
+
+// Clips a span of pixels to the frame buffer bounds.
+size_t FBPainter::FrameBuffer::clipSpan
+(const size_t xPos, const size_t yPos, const size_t count) const
+{
+    if (bufferData == nullptr || xPos >= getWidth() || yPos >= getHeight())
+    {
+        return 0;
+    }
+    return std::min(count, getWidth() - xPos);
+}
+
+
+// Gets the address where a specific coordinate's pixel color is stored and
+// read.
+uint8_t* FBPainter::FrameBuffer::getMappedPoint
 (const size_t xPos, const size_t yPos)
 {
     if (bufferData == nullptr || xPos >= getWidth() || yPos >= getHeight())
     {
-        std::cerr << "buffer closed or (" << xPos << ", " << yPos
-                << ") out of bounds.\n";
+        outOfBoundsCount++;
         return nullptr;
     }
-    size_t offset = (xPos + vInfo.xoffset) * (vInfo.bits_per_pixel / 8)
-            + (yPos + vInfo.yoffset) * fInfo.line_length;
-    return reinterpret_cast<uint32_t*>(bufferData + offset);
+    if (shadowMode != ShadowMode::Disabled)
+    {
+        return &shadowBuffer[yPos * shadowStride + xPos * bytesPerPixel];
+    }
+    return getDevicePoint(xPos, yPos);
+}
+
+
+// Gets the number of bytes between rows of the memory returned by
+// getMappedPoint.
+size_t FBPainter::FrameBuffer::getMappedStride() const
+{
+    return (shadowMode != ShadowMode::Disabled)
+            ? shadowStride : stride;
+}
+
+
+// Gets the address in the backend's memory where a specific coordinate's
+// pixel color is displayed.
+uint8_t* FBPainter::FrameBuffer::getDevicePoint
+(const size_t xPos, const size_t yPos) const
+{
+    return bufferData + (yPos + backend->getYOffset()) * stride
+            + xPos * bytesPerPixel;
+}
+
+
+// Gets the frame buffer bounds.
+FBPainter::Rectangle FBPainter::FrameBuffer::getBounds() const
+{
+    return Rectangle(0, 0, getWidth(), getHeight());
+}
+
+
+// Gets the address in the backend's memory where one of its display pages
+// begins.
+uint8_t* FBPainter::FrameBuffer::getPageOrigin(const size_t page) const
+{
+    return bufferData + page * height * stride;
+}
+
+
+// Copies an area of the shadow buffer into backend memory.
+void FBPainter::FrameBuffer::copyShadowRect(const Rectangle& area,
+        uint8_t* const pageOrigin)
+{
+    const size_t rowBytes = area.getWidth() * bytesPerPixel;
+    const uint8_t* shadowRow = &shadowBuffer[area.getTop() * shadowStride
+            + area.getLeft() * bytesPerPixel];
+    uint8_t* pageRow = pageOrigin + area.getTop() * stride
+            + area.getLeft() * bytesPerPixel;
+    for (int y = area.getTop(); y < area.getBottom(); y++)
+    {
+        memcpy(pageRow, shadowRow, rowBytes);
+        shadowRow += shadowStride;
+        pageRow += stride;
+    }
+}
+
+
+// Makes one of the backend's display pages visible.
+bool FBPainter::FrameBuffer::panToPage(const size_t page)
+{
+    if (! backend->panTo(page * height))
+    {
+        return false;
+    }
+    displayedPage = page;
+    return true;
+}
+
+
+// Waits until the display's next vertical blanking interval.
+void FBPainter::FrameBuffer::waitForVerticalSync()
+{
+    backend->waitForVSync();
+}
+
+
+// Passes changes made in the shadow buffer on to the backend's memory.
+void FBPainter::FrameBuffer::commitWrite(const size_t xPos, const size_t yPos,
+        const size_t width, const size_t height)
+{
+    if (shadowMode == ShadowMode::Mirrored)
+    {
+        const size_t rowBytes = width * bytesPerPixel;
+        for (size_t y = yPos; y < yPos + height; y++)
+        {
+            memcpy(getDevicePoint(xPos, y),
+                    &shadowBuffer[y * shadowStride + xPos * bytesPerPixel],
+                    rowBytes);
+        }
+    }
+    else if (shadowMode == ShadowMode::Deferred)
+    {
+        std::lock_guard<std::mutex> lock(damageLock);
+        damage.add(Rectangle(xPos, yPos, width, height));
+    }
 }
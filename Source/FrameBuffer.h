@@ -1,14 +1,21 @@
 /**
  * @file  FrameBuffer.h
  *
- * @brief  Draws directly to a Linux framebuffer.
+ * @brief  Draws directly to a Linux framebuffer, or to any other
+ *         FrameBufferBackend.
  */
 
 #pragma once
 #include "RGBPixel.h"
-#include <linux/fb.h>
+#include "PixelFormat.h"
+#include "Rectangle.h"
+#include "DamageRegion.h"
+#include "FrameBufferBackend.h"
 #include <stdint.h>
 #include <stddef.h>
+#include <memory>
+#include <mutex>
+#include <vector>
 
 namespace FBPainter { class FrameBuffer; }
 
@@ -16,14 +23,41 @@ class FBPainter::FrameBuffer
 {
 public:
     /**
-     * @brief  Opens and memory maps the frame buffer file.
+     * @brief  Ways the frame buffer may use a shadow copy of its contents
+     *         stored in ordinary system memory.
+     *
+     *  Frame buffer device memory is often uncached, so reading it is very
+     * slow. While a shadow buffer is enabled, all reads are served from the
+     * shadow copy and all writes go to the shadow copy first.
+     */
+    enum class ShadowMode
+    {
+        // Read and write the device memory directly.
+        Disabled,
+        // Copy each write into device memory as soon as it is made.
+        Mirrored,
+        // Only copy changes into device memory when flush is called.
+        Deferred
+    };
+
+    /**
+     * @brief  Opens and memory maps a Linux frame buffer device file.
      *
      * @param bufferPath  The path to the frame buffer file.
      */
     FrameBuffer(const char* bufferPath);
 
     /**
-     * @brief  Closes and unmaps the frame buffer file on destruction.
+     * @brief  Draws into memory provided by a frame buffer backend.
+     *
+     * @param backend  The backend to use. The FrameBuffer takes ownership of
+     *                 the backend, and deletes it when the buffer closes.
+     */
+    FrameBuffer(FrameBufferBackend* backend);
+
+    /**
+     * @brief  Flushes pending changes and releases the backend on
+     *         destruction.
      */
     ~FrameBuffer();
 
@@ -48,6 +82,36 @@ public:
      */
     size_t getHeight() const;
 
+    /**
+     * @brief  Gets the layout of pixels in the buffer.
+     *
+     *  FrameBuffer requests 32-bit color when it opens a frame buffer device,
+     * but keeps the driver's current mode if that request fails.
+     *
+     * @return  The buffer's pixel format, or PixelFormat::Unknown if the
+     *          buffer is closed.
+     */
+    PixelFormat getPixelFormat() const;
+
+    /**
+     * @brief  Gets the number of bytes used to store each pixel in the
+     *         buffer.
+     *
+     * @return  The pixel size in bytes, or zero if the buffer is closed.
+     */
+    size_t getBytesPerPixel() const;
+
+    /**
+     * @brief  Gets the number of single pixel reads or writes that were
+     *         ignored because they were out of bounds.
+     *
+     *  Out of bounds pixel access is not treated as an error, so this counter
+     * is the only record of it.
+     *
+     * @return  The number of ignored getPixel and setPixel calls.
+     */
+    size_t getOutOfBoundsCount() const;
+
     /**
      * @brief  Gets the color set at a specific pixel in the buffer.
      *
@@ -74,14 +138,255 @@ public:
     void setPixel(const size_t xPos, const size_t yPos, const RGBPixel color);
 
     /**
-     * @brief  Unmaps the frame buffer from memory, closes the buffer file, and
-     *         clears all buffer information.
+     * @brief  Copies a row of pixels out of the frame buffer.
+     *
+     *  The span is clipped to the buffer bounds once, and only the pixels
+     * within the buffer are read. Pixels in the destination that correspond
+     * to pixels outside of the buffer are left unchanged.
+     *
+     * @param xPos   The x-coordinate of the first pixel to read.
+     *
+     * @param yPos   The y-coordinate of the row to read.
+     *
+     * @param dest   Memory with room for count pixels in the buffer's pixel
+     *               format, where the first pixel will receive the value at
+     *               (xPos, yPos).
+     *
+     * @param count  The number of pixels to read.
+     *
+     * @return       The number of pixels actually read.
      */
-    void closeAndClearData();
+    size_t readSpan(const size_t xPos, const size_t yPos, void* dest,
+            const size_t count);
+
+    /**
+     * @brief  Copies a row of pixels into the frame buffer.
+     *
+     *  The span is clipped to the buffer bounds once, and any part of it that
+     * falls outside of the buffer is ignored.
+     *
+     *  Span reads and writes on different rows may be made from multiple
+     * threads at once, as long as no other buffer functions are called until
+     * they finish.
+     *
+     * @param xPos    The x-coordinate of the first pixel to write.
+     *
+     * @param yPos    The y-coordinate of the row to write.
+     *
+     * @param source  Memory holding count pixels in the buffer's pixel
+     *                format, where the first pixel holds the new value at
+     *                (xPos, yPos).
+     *
+     * @param count   The number of pixels to write.
+     */
+    void writeSpan(const size_t xPos, const size_t yPos, const void* source,
+            const size_t count);
+
+    /**
+     * @brief  Reads a row of pixels out of the frame buffer as 0x00RRGGBB
+     *         color values.
+     *
+     * @param xPos   The x-coordinate of the first pixel to read.
+     *
+     * @param yPos   The y-coordinate of the row to read.
+     *
+     * @param dest   An array of at least count values, where dest[0] will
+     *               receive the color at (xPos, yPos). Entries that
+     *               correspond to pixels outside of the buffer are left
+     *               unchanged.
+     *
+     * @param count  The number of pixels to read.
+     *
+     * @return       The number of pixels actually read.
+     */
+    size_t readSpanRGB(const size_t xPos, const size_t yPos, uint32_t* dest,
+            const size_t count);
+
+    /**
+     * @brief  Writes a row of 0x00RRGGBB color values into the frame buffer.
+     *
+     * @param xPos    The x-coordinate of the first pixel to write.
+     *
+     * @param yPos    The y-coordinate of the row to write.
+     *
+     * @param source  An array of at least count color values, where source[0]
+     *                holds the new color at (xPos, yPos).
+     *
+     * @param count   The number of pixels to write.
+     */
+    void writeSpanRGB(const size_t xPos, const size_t yPos,
+            const uint32_t* source, const size_t count);
+
+    /**
+     * @brief  Copies a rectangle of packed pixel data into the frame buffer.
+     *
+     * @param xPos          The x-coordinate of the rectangle's top left
+     *                      corner.
+     *
+     * @param yPos          The y-coordinate of the rectangle's top left
+     *                      corner.
+     *
+     * @param width         The rectangle width in pixels.
+     *
+     * @param height        The rectangle height in pixels.
+     *
+     * @param source        Row-major pixel data in the buffer's pixel format,
+     *                      where the first pixel holds the new value at
+     *                      (xPos, yPos).
+     *
+     * @param sourceStride  The number of bytes between the start of each row
+     *                      in the source data.
+     */
+    void blitRect(const size_t xPos, const size_t yPos, const size_t width,
+            const size_t height, const void* source,
+            const size_t sourceStride);
+
+    /**
+     * @brief  Copies a rectangle of pixels to another position in the frame
+     *         buffer.
+     *
+     *  Rows are copied in an order that keeps the result correct when the
+     * source and destination overlap. Any part of either rectangle that falls
+     * outside of the buffer is ignored.
+     *
+     * @param xPos   The x-coordinate of the source rectangle's top left
+     *               corner.
+     *
+     * @param yPos   The y-coordinate of the source rectangle's top left
+     *               corner.
+     *
+     * @param width  The rectangle width in pixels.
+     *
+     * @param height The rectangle height in pixels.
+     *
+     * @param destX  The x-coordinate where the source rectangle's top left
+     *               pixel will be copied.
+     *
+     * @param destY  The y-coordinate where the source rectangle's top left
+     *               pixel will be copied.
+     */
+    void moveRect(const size_t xPos, const size_t yPos, const size_t width,
+            const size_t height, const size_t destX, const size_t destY);
+
+    /**
+     * @brief  Sets every pixel within a rectangle to a single color.
+     *
+     *  Fills use the fastest vector instructions the CPU supports, and fills
+     * of at least FBPainter::streamingFillBytes use non-temporal stores so
+     * that they run at memory bandwidth without evicting cached data.
+     *
+     * @param xPos    The x-coordinate of the rectangle's top left corner.
+     *
+     * @param yPos    The y-coordinate of the rectangle's top left corner.
+     *
+     * @param width   The rectangle width in pixels.
+     *
+     * @param height  The rectangle height in pixels.
+     *
+     * @param color   The color to copy into the rectangle.
+     */
+    void fillRect(const size_t xPos, const size_t yPos, const size_t width,
+            const size_t height, const RGBPixel color);
+
+    /**
+     * @brief  Sets every pixel in the buffer to a single color.
+     *
+     * @param color  The color to copy into the buffer.
+     */
+    void clear(const RGBPixel color = RGBPixel(0, 0, 0));
+
+    /**
+     * @brief  Gets how the frame buffer uses a shadow copy of its contents in
+     *         system memory.
+     *
+     * @return  The current shadow buffer mode.
+     */
+    ShadowMode getShadowMode() const;
+
+    /**
+     * @brief  Selects how the frame buffer uses a shadow copy of its contents
+     *         in system memory.
+     *
+     *  Enabling the shadow buffer reads the entire device buffer once to
+     * initialize the shadow copy. Disabling it, or switching it from deferred
+     * mode to mirrored mode, flushes any pending changes first. Page flipping
+     * is disabled if the new mode is not ShadowMode::Deferred.
+     *
+     * @param mode  The new shadow buffer mode.
+     */
+    void setShadowMode(const ShadowMode mode);
+
+    /**
+     * @brief  Copies all changes made to the shadow buffer since the last
+     *         flush into the backend's memory.
+     *
+     *  Only the damaged areas of each row are copied.
+     *
+     *  This only has an effect when the shadow mode is ShadowMode::Deferred.
+     * If page flipping is enabled, this presents a new frame.
+     */
+    void flush();
+
+    /**
+     * @brief  Gets the areas changed in the shadow buffer that have not been
+     *         flushed or presented yet.
+     *
+     *  Every write to a deferred shadow buffer marks its area as damaged, and
+     * flush and present copy only the damaged areas into device memory.
+     *
+     * @return  The pending damage region. This is always empty unless the
+     *          shadow mode is ShadowMode::Deferred.
+     */
+    const DamageRegion& getDamage() const;
+
+    /**
+     * @brief  Gets the number of display pages the frame buffer cycles through
+     *         when presenting frames.
+     *
+     * @return  The number of pages in use, or 1 if page flipping is disabled.
+     */
+    size_t getPageCount() const;
+
+    /**
+     * @brief  Enables or disables double or triple buffering.
+     *
+     *  When page flipping is enabled, all drawing goes to a deferred shadow
+     * buffer, and nothing reaches the screen until present is called.
+     * present copies each frame's changes into an off-screen page within the
+     * buffer's virtual resolution, then switches to that page with
+     * FBIOPAN_DISPLAY so the frame appears all at once.
+     *
+     *  If the driver can't provide enough virtual height for a second page,
+     * the shadow buffer is still enabled, and present copies changes directly
+     * into the visible page instead.
+     *
+     *  Disabling page flipping returns the display to the first page, and
+     * leaves the shadow buffer in deferred mode.
+     *
+     * @param requestedCount  The number of pages to cycle through: 2 for
+     *                        double buffering, 3 for triple buffering, or 1
+     *                        to disable page flipping.
+     *
+     * @return                Whether hardware page flipping is now in use.
+     */
+    bool setPageCount(const size_t requestedCount);
 
-private:
     /**
-     * @brief  Gets a 32-bit frame buffer color value from RGB color values.
+     * @brief  Shows all changes made since the last frame was presented.
+     *
+     *  With page flipping enabled, this updates the next page and pans the
+     * display to it. Otherwise, this flushes the shadow buffer.
+     *
+     * @param waitForVSync  Whether to wait for the display's vertical
+     *                      blanking interval. With page flipping this waits
+     *                      after the flip, so the previous page is no longer
+     *                      being scanned out when the next frame is written.
+     *                      Without page flipping this waits before copying.
+     */
+    void present(const bool waitForVSync = false);
+
+    /**
+     * @brief  Gets a frame buffer color value from RGB color values.
      *
      * @param red    The red component of the color.
      *
@@ -89,23 +394,68 @@ private:
      *
      * @param blue   The blue component of the color.
      *
-     * @return       A color value that can be copied directly into the buffer.
+     * @return       The color in the buffer's pixel format, stored in the
+     *               lowest bits of the returned value.
      */
     uint32_t getPixelColor(const uint8_t red, const uint8_t green,
             const uint8_t blue) const;
 
     /**
-     * @brief  Gets a 32-bit frame buffer color value from a RGBPixel object.
+     * @brief  Gets a frame buffer color value from a RGBPixel object.
      *
      * @param pixel  The pixel color data to convert.
      *
-     * @return       A color value that can be copied directly into the buffer.
+     * @return       The color in the buffer's pixel format, stored in the
+     *               lowest bits of the returned value.
      */
     uint32_t getPixelColor(const RGBPixel& pixel) const;
 
     /**
-     * @brief  Gets the address in the frame buffer memory map where a specific
-     *         coordinate's pixel color is stored.
+     * @brief  Gets the RGBPixel represented by a frame buffer color value.
+     *
+     * @param color  A color value in the buffer's pixel format, stored in the
+     *               lowest bits.
+     *
+     * @return       The equivalent RGB color.
+     */
+    RGBPixel getRGBPixel(const uint32_t color) const;
+
+    /**
+     * @brief  Gets the backend that provides the buffer's memory.
+     *
+     * @return  The buffer's backend, or nullptr if the buffer is closed.
+     */
+    FrameBufferBackend* getBackend() const;
+
+    /**
+     * @brief  Flushes pending changes, releases the backend, and clears all
+     *         buffer information.
+     */
+    void closeAndClearData();
+
+private:
+
+    /**
+     * @brief  Clips a span of pixels to the frame buffer bounds.
+     *
+     * @param xPos   The x-coordinate of the first pixel in the span.
+     *
+     * @param yPos   The y-coordinate of the span's row.
+     *
+     * @param count  The number of pixels in the span.
+     *
+     * @return       The number of pixels in the span that are within the
+     *               buffer bounds, or zero if the buffer is closed.
+     */
+    size_t clipSpan(const size_t xPos, const size_t yPos,
+            const size_t count) const;
+
+    /**
+     * @brief  Gets the address where a specific coordinate's pixel color is
+     *         stored and read.
+     *
+     *  This is in the shadow buffer when it is enabled, and in the backend's
+     * memory otherwise.
      *
      * @param xPos   The pixel x-coordinate.
      *
@@ -114,16 +464,120 @@ private:
      * @return       An address within the buffer, or nullptr if the buffer is
      *               closed or the point is out of bounds.
      */
-    uint32_t* getMappedPoint(const size_t xPos, const size_t yPos);
+    uint8_t* getMappedPoint(const size_t xPos, const size_t yPos);
+
+    /**
+     * @brief  Gets the number of bytes between rows of the memory returned by
+     *         getMappedPoint.
+     *
+     * @return  The shadow buffer or device row stride.
+     */
+    size_t getMappedStride() const;
+
+    /**
+     * @brief  Gets the address in the backend's memory where a specific
+     *         coordinate's pixel color is displayed.
+     *
+     * @param xPos   The pixel x-coordinate, which must be in bounds.
+     *
+     * @param yPos   The pixel y-coordinate, which must be in bounds.
+     *
+     * @return       An address within backend memory.
+     */
+    uint8_t* getDevicePoint(const size_t xPos, const size_t yPos) const;
 
-    // Stored display info:
-	struct fb_fix_screeninfo fInfo = {0};
-	struct fb_var_screeninfo vInfo = {0};
+    /**
+     * @brief  Gets the frame buffer bounds.
+     *
+     * @return  A rectangle at the origin, with the buffer's size.
+     */
+    Rectangle getBounds() const;
 
-    // FrameBuffer file descriptor:
-	int bufferFD = 0;
+    /**
+     * @brief  Gets the address in the backend's memory where one of its
+     *         display pages begins.
+     *
+     * @param page  The index of a display page.
+     *
+     * @return      The address of the page's top left pixel.
+     */
+    uint8_t* getPageOrigin(const size_t page) const;
 
-    // FrameBuffer file mapped to memory with mmap:
+    /**
+     * @brief  Copies an area of the shadow buffer into frame buffer device
+     *         memory.
+     *
+     * @param area        The area to copy, which must be within the buffer
+     *                    bounds.
+     *
+     * @param pageOrigin  The address of the destination page's top left
+     *                    pixel in device memory.
+     */
+    void copyShadowRect(const Rectangle& area, uint8_t* const pageOrigin);
+
+    /**
+     * @brief  Makes one of the backend's display pages visible.
+     *
+     * @param page  The index of the page to show.
+     *
+     * @return      Whether the display was panned successfully.
+     */
+    bool panToPage(const size_t page);
+
+    /**
+     * @brief  Waits until the display's next vertical blanking interval.
+     */
+    void waitForVerticalSync();
+
+    /**
+     * @brief  Passes changes made in the shadow buffer on to the backend's
+     *         memory.
+     *
+     *  Mirrored changes are copied immediately, and deferred changes are
+     * added to the damage region. This does nothing if the shadow buffer is
+     * disabled.
+     *
+     * @param xPos    The x-coordinate of the changed area's top left corner.
+     *
+     * @param yPos    The y-coordinate of the changed area's top left corner.
+     *
+     * @param width   The width of the changed area.
+     *
+     * @param height  The height of the changed area.
+     */
+    void commitWrite(const size_t xPos, const size_t yPos, const size_t width,
+            const size_t height);
+
+    // The source of the buffer's memory and display controls:
+    std::unique_ptr<FrameBufferBackend> backend;
+
+    // Backend memory and geometry, cached for fast pixel access:
     uint8_t* bufferData = nullptr;
-    size_t bufferSize = 0;
+    size_t width = 0;
+    size_t height = 0;
+    size_t stride = 0;
+
+    // Pixel layout, and the converter used to write that layout:
+    PixelFormat pixelFormat = PixelFormat::Unknown;
+    const PixelConverter* converter = nullptr;
+    size_t bytesPerPixel = 0;
+
+    // Cached copy of the buffer contents, used when shadowMode is not
+    // ShadowMode::Disabled:
+    ShadowMode shadowMode = ShadowMode::Disabled;
+    std::vector<uint8_t> shadowBuffer;
+    size_t shadowStride = 0;
+    // Areas changed in the shadow buffer since the last flush, guarded so
+    // that different rows can be written from multiple threads at once:
+    DamageRegion damage;
+    std::mutex damageLock;
+
+    // Display pages used for page flipping, the page currently on screen, and
+    // the areas each page is missing from previously presented frames:
+    size_t pageCount = 1;
+    size_t displayedPage = 0;
+    std::vector<DamageRegion> pageDamage;
+
+    // Number of ignored out of bounds getPixel and setPixel calls:
+    size_t outOfBoundsCount = 0;
 };
@@ -0,0 +1,120 @@
+/**
+ * @file  FrameBufferBackend.h
+ *
+ * @brief  An abstract basis for the memory a FrameBuffer draws into.
+ */
+
+#pragma once
+#include "PixelFormat.h"
+#include <stdint.h>
+#include <stddef.h>
+
+namespace FBPainter
+{
+    class FrameBufferBackend;
+}
+
+/**
+ * @brief  Provides a FrameBuffer with mapped pixel memory and display
+ *         controls.
+ *
+ *  Backend memory holds one or more display pages stacked vertically, each
+ * with the backend's width and height. Pages share a row stride, and the
+ * visible page is selected by its y-offset within the virtual height.
+ */
+class FBPainter::FrameBufferBackend
+{
+public:
+    FrameBufferBackend() { }
+
+    virtual ~FrameBufferBackend() { }
+
+    /**
+     * @brief  Checks if the backend's memory is mapped and ready for IO.
+     *
+     * @return  Whether the backend is usable.
+     */
+    virtual bool isOpen() const = 0;
+
+    /**
+     * @brief  Gets the width of each display page.
+     *
+     * @return  The page width in pixels.
+     */
+    virtual size_t getWidth() const = 0;
+
+    /**
+     * @brief  Gets the height of each display page.
+     *
+     * @return  The page height in pixels.
+     */
+    virtual size_t getHeight() const = 0;
+
+    /**
+     * @brief  Gets the total height of all display pages.
+     *
+     * @return  The virtual height in pixels.
+     */
+    virtual size_t getVirtualHeight() const = 0;
+
+    /**
+     * @brief  Gets the number of bytes between the start of each row.
+     *
+     * @return  The row stride in bytes.
+     */
+    virtual size_t getStride() const = 0;
+
+    /**
+     * @brief  Gets the layout of pixels in the backend's memory.
+     *
+     * @return  The pixel format.
+     */
+    virtual PixelFormat getPixelFormat() const = 0;
+
+    /**
+     * @brief  Gets the address of the top left pixel of the first display
+     *         page.
+     *
+     *  This address may change after a call to setVirtualHeight.
+     *
+     * @return  The start of the backend's pixel memory, or nullptr if the
+     *          backend is not open.
+     */
+    virtual uint8_t* getData() const = 0;
+
+    /**
+     * @brief  Gets the y-offset of the visible display page within the
+     *         virtual height.
+     *
+     * @return  The index of the first visible row.
+     */
+    virtual size_t getYOffset() const = 0;
+
+    /**
+     * @brief  Attempts to change the total height of all display pages.
+     *
+     *  This may remap the backend's memory, and existing pixel data is not
+     * guaranteed to be preserved.
+     *
+     * @param virtualHeight  The requested virtual height in pixels.
+     *
+     * @return               Whether the virtual height changed.
+     */
+    virtual bool setVirtualHeight(const size_t virtualHeight) = 0;
+
+    /**
+     * @brief  Changes which rows of the virtual height are visible.
+     *
+     * @param yOffset  The new y-offset of the visible display page.
+     *
+     * @return         Whether the visible page changed.
+     */
+    virtual bool panTo(const size_t yOffset) = 0;
+
+    /**
+     * @brief  Waits until the display's next vertical blanking interval.
+     *
+     *  Backends that are not connected to a display return immediately.
+     */
+    virtual void waitForVSync() = 0;
+};
@@ -0,0 +1,57 @@
+#include "Image.h"
+#include <algorithm>
+
+// Copies a run of pixels from one image row.
+void FBPainter::Image::readRow(const size_t yPos, const size_t xStart,
+        const size_t count, uint32_t* dest, const RowFormat format) const
+{
+    const size_t width = getWidth();
+    const size_t inBounds = (yPos < getHeight() && xStart < width)
+            ? std::min(count, width - xStart) : 0;
+    const uint8_t* rowData = (inBounds > 0) ? getRowData(yPos) : nullptr;
+    if (rowData != nullptr)
+    {
+        const uint8_t* pixel = rowData + xStart * 4;
+        for (size_t i = 0; i < inBounds; i++, pixel += 4)
+        {
+            dest[i] = packRowPixel(pixel[0], pixel[1], pixel[2], pixel[3],
+                    format);
+        }
+    }
+    else
+    {
+        for (size_t i = 0; i < inBounds; i++)
+        {
+            const RGBAPixel pixel = getRGBAPixel(xStart + i, yPos);
+            dest[i] = packRowPixel(pixel.getRed(), pixel.getGreen(),
+                    pixel.getBlue(), pixel.getAlpha(), format);
+        }
+    }
+    std::fill(dest + inBounds, dest + count, 0);
+}
+
+
+// Gets direct access to one row of image pixels.
+const uint8_t* FBPainter::Image::getRowData(const size_t /* yPos */)
+        const
+{
+    return nullptr;
+}
+
+
+// Gets direct access to one row of premultiplied pixels.
+const uint32_t* FBPainter::Image::getPremultipliedRow
+(const size_t /* yPos */) const
+{
+    return nullptr;
+}
+
+
+// Gets the runs of transparent, opaque, and partially transparent pixels in
+// one image row.
+const FBPainter::PixelRun* FBPainter::Image::getRowRuns
+(const size_t /* yPos */, size_t& count) const
+{
+    count = 0;
+    return nullptr;
+}
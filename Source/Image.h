@@ -7,11 +7,25 @@
 #pragma once
 #include "RGBPixel.h"
 #include "RGBAPixel.h"
+#include "BlendKernels.h"
+#include "PixelRun.h"
 #include <cstddef>
+#include <stdint.h>
 
 namespace FBPainter
 {
     class Image;
+
+    /**
+     * @brief  Layouts of the pixel values copied by Image::readRow.
+     */
+    enum class RowFormat
+    {
+        // 0xAARRGGBB values with unscaled color components:
+        ARGB,
+        // 0xAARRGGBB values with each color component scaled by alpha:
+        PremultipliedARGB
+    };
 }
 
 class FBPainter::Image
@@ -60,5 +74,102 @@ public:
      */
     virtual RGBAPixel getRGBAPixel(const size_t xPos, const size_t yPos)
             const = 0;
+
+    /**
+     * @brief  Copies a run of pixels from one image row.
+     *
+     *  The default implementation converts pixels straight from getRowData
+     * when the image provides it, and otherwise reads each pixel with
+     * getRGBAPixel. Images that store their pixels in another way should
+     * override this to copy whole rows without a virtual call per pixel.
+     *
+     * @param yPos    The y-coordinate of the row to read.
+     *
+     * @param xStart  The x-coordinate of the first pixel to read.
+     *
+     * @param count   The number of pixels to read.
+     *
+     * @param dest    A buffer with room for count pixel values. Pixels
+     *                outside of the image bounds are set to zero.
+     *
+     * @param format  The layout of the pixel values written to dest.
+     */
+    virtual void readRow(const size_t yPos, const size_t xStart,
+            const size_t count, uint32_t* dest, const RowFormat format) const;
+
+    /**
+     * @brief  Gets direct access to one row of image pixels, for images that
+     *         keep their pixels in memory.
+     *
+     * @param yPos  The y-coordinate of the row.
+     *
+     * @return      The row's pixels, stored as four bytes each holding the
+     *              red, green, blue, and unscaled alpha components, or
+     *              nullptr if the image doesn't store its pixels that way or
+     *              the row is out of bounds. The pointer remains valid until
+     *              the image changes or is destroyed.
+     */
+    virtual const uint8_t* getRowData(const size_t yPos) const;
+
+    /**
+     * @brief  Gets direct access to one row of premultiplied pixels, for
+     *         images that keep them in memory.
+     *
+     *  ImagePainter draws straight from these rows when an image provides
+     * them along with its runs, instead of keeping its own copy of the image.
+     *
+     * @param yPos  The y-coordinate of the row.
+     *
+     * @return      The row's premultiplied 0xAARRGGBB pixels, or nullptr if
+     *              the image doesn't store its pixels that way or the row is
+     *              out of bounds. The pointer remains valid until the image
+     *              changes or is destroyed.
+     */
+    virtual const uint32_t* getPremultipliedRow(const size_t yPos) const;
+
+    /**
+     * @brief  Gets the runs of transparent, opaque, and partially transparent
+     *         pixels in one image row, for images that keep them in memory.
+     *
+     * @param yPos   The y-coordinate of the row.
+     *
+     * @param count  Set to the number of runs in the row, or zero if the
+     *               image has no runs for the row.
+     *
+     * @return       The row's runs, sorted by position and covering the whole
+     *               row, or nullptr if the image doesn't store runs or the
+     *               row is out of bounds. The pointer remains valid until the
+     *               image changes or is destroyed.
+     */
+    virtual const PixelRun* getRowRuns(const size_t yPos, size_t& count)
+            const;
+
+protected:
+    /**
+     * @brief  Packs color components into a row pixel value.
+     *
+     * @param red     The red color component.
+     *
+     * @param green   The green color component.
+     *
+     * @param blue    The blue color component.
+     *
+     * @param alpha   The unscaled alpha component.
+     *
+     * @param format  The layout of the packed value.
+     *
+     * @return        The pixel value in the requested layout.
+     */
+    static inline uint32_t packRowPixel(const uint8_t red,
+            const uint8_t green, const uint8_t blue, const uint8_t alpha,
+            const RowFormat format)
+    {
+        if (format == RowFormat::PremultipliedARGB)
+        {
+            return premultiplyColor(red, green, blue, alpha);
+        }
+        return (static_cast<uint32_t>(alpha) << 24) | (red << 16)
+                | (green << 8) | blue;
+    }
 };
 
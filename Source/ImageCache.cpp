@@ -0,0 +1,221 @@
+#include "ImageCache.h"
+#include "RawImage.h"
+#include "QoiImage.h"
+#include "PreparedImage.h"
+#include <new>
+// The library makefile defines USE_PNG as 0 when libpng support is disabled,
+// so check its value rather than whether it's defined:
+#if USE_PNG
+#include "PngImage.h"
+#endif
+
+// Checks if a string ends with a file extension.
+static bool hasExtension(const std::string& path, const std::string& extension)
+{
+    return path.size() >= extension.size() && path.compare(path.size()
+            - extension.size(), extension.size(), extension) == 0;
+}
+
+
+// Creates an empty image cache.
+FBPainter::ImageCache::ImageCache(const size_t budget, const Loader& loader) :
+    loader(loader ? loader : Loader(loadFile)), budget(budget) { }
+
+
+// Gets the image cache shared by the entire process.
+FBPainter::ImageCache& FBPainter::ImageCache::getShared()
+{
+    static ImageCache sharedCache;
+    return sharedCache;
+}
+
+
+// Gets a cached image, loading it if it isn't cached.
+std::shared_ptr<const FBPainter::Image> FBPainter::ImageCache::getImage
+(const std::string& key)
+{
+    {
+        std::lock_guard<std::mutex> cacheLock(lock);
+        const auto found = keyEntries.find(key);
+        if (found != keyEntries.end())
+        {
+            statistics.hits++;
+            // Move the entry to the front of the list:
+            entries.splice(entries.begin(), entries, found->second);
+            return found->second->image;
+        }
+        statistics.misses++;
+    }
+    // Images are prepared before taking the lock again, as preparing reads
+    // every pixel:
+    const std::shared_ptr<const Image> image = PreparedImage::prepare(
+            std::shared_ptr<const Image>(loader(key)));
+    if (image == nullptr)
+    {
+        return image;
+    }
+    std::lock_guard<std::mutex> cacheLock(lock);
+    // Another thread may have loaded the same image in the meantime. Keep
+    // the first copy, so every painter shares one image:
+    const auto found = keyEntries.find(key);
+    if (found != keyEntries.end())
+    {
+        entries.splice(entries.begin(), entries, found->second);
+        return found->second->image;
+    }
+    insertEntry(key, image);
+    return image;
+}
+
+
+// Adds an image to the cache, replacing any image already cached with the
+// same key.
+std::shared_ptr<const FBPainter::Image> FBPainter::ImageCache::addImage
+(const std::string& key, Image* image)
+{
+    const std::shared_ptr<const Image> sharedImage
+            = PreparedImage::prepare(std::shared_ptr<const Image>(image));
+    if (sharedImage != nullptr)
+    {
+        std::lock_guard<std::mutex> cacheLock(lock);
+        insertEntry(key, sharedImage);
+    }
+    return sharedImage;
+}
+
+
+// Removes an image from the cache.
+void FBPainter::ImageCache::removeImage(const std::string& key)
+{
+    std::lock_guard<std::mutex> cacheLock(lock);
+    const auto found = keyEntries.find(key);
+    if (found != keyEntries.end())
+    {
+        statistics.residentBytes -= found->second->size;
+        statistics.imageCount--;
+        entries.erase(found->second);
+        keyEntries.erase(found);
+    }
+}
+
+
+// Removes every image from the cache.
+void FBPainter::ImageCache::clear()
+{
+    std::lock_guard<std::mutex> cacheLock(lock);
+    entries.clear();
+    keyEntries.clear();
+    statistics.residentBytes = 0;
+    statistics.imageCount = 0;
+}
+
+
+// Gets the number of bytes cached images may use.
+size_t FBPainter::ImageCache::getBudget() const
+{
+    std::lock_guard<std::mutex> cacheLock(lock);
+    return budget;
+}
+
+
+// Sets the number of bytes cached images may use.
+void FBPainter::ImageCache::setBudget(const size_t budget)
+{
+    std::lock_guard<std::mutex> cacheLock(lock);
+    this->budget = budget;
+    evict();
+}
+
+
+// Gets cache activity counters and memory use.
+FBPainter::ImageCache::Statistics FBPainter::ImageCache::getStatistics() const
+{
+    std::lock_guard<std::mutex> cacheLock(lock);
+    return statistics;
+}
+
+
+// Loads an image from a file path, based on its extension.
+FBPainter::Image* FBPainter::ImageCache::loadFile(const std::string& path)
+{
+    Image* image = nullptr;
+    if (hasExtension(path, ".fbraw"))
+    {
+        image = new RawImage(path.c_str());
+    }
+    else if (hasExtension(path, ".qoi"))
+    {
+        image = new QoiImage(path.c_str());
+    }
+#if USE_PNG
+    else if (hasExtension(path, ".png"))
+    {
+        try
+        {
+            image = new PngImage(path.c_str());
+        }
+        catch (const std::exception&)
+        {
+            return nullptr;
+        }
+    }
+#endif
+    // Images that failed to load have no pixels:
+    if (image != nullptr && (image->getWidth() == 0
+            || image->getHeight() == 0))
+    {
+        delete image;
+        image = nullptr;
+    }
+    return image;
+}
+
+
+// Estimates the memory used by a cached image.
+size_t FBPainter::ImageCache::getImageSize(const Image& image)
+{
+    const PreparedImage* prepared = dynamic_cast<const PreparedImage*>(&image);
+    if (prepared != nullptr)
+    {
+        return prepared->getStorageSize();
+    }
+    return image.getWidth() * image.getHeight() * sizeof(uint32_t);
+}
+
+
+// Adds an entry as the most recently used image, replacing any entry with the
+// same key, then evicts images until the cache is within its budget.
+void FBPainter::ImageCache::insertEntry(const std::string& key,
+        const std::shared_ptr<const Image>& image)
+{
+    const auto found = keyEntries.find(key);
+    if (found != keyEntries.end())
+    {
+        statistics.residentBytes -= found->second->size;
+        statistics.imageCount--;
+        entries.erase(found->second);
+        keyEntries.erase(found);
+    }
+    const size_t size = getImageSize(*image);
+    entries.push_front({ key, image, size });
+    keyEntries[key] = entries.begin();
+    statistics.residentBytes += size;
+    statistics.imageCount++;
+    evict();
+}
+
+
+// Evicts the least recently used images until the cache is within its
+// budget.
+void FBPainter::ImageCache::evict()
+{
+    while (statistics.residentBytes > budget && ! entries.empty())
+    {
+        const Entry& oldest = entries.back();
+        statistics.residentBytes -= oldest.size;
+        statistics.imageCount--;
+        statistics.evictions++;
+        keyEntries.erase(oldest.key);
+        entries.pop_back();
+    }
+}
@@ -0,0 +1,221 @@
+/**
+ * @file  ImageCache.h
+ *
+ * @brief  Shares loaded images between painters, keeping recently used
+ *         images within a memory budget.
+ */
+
+#pragma once
+#include "Image.h"
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <stddef.h>
+
+namespace FBPainter
+{
+    class ImageCache;
+}
+
+/**
+ * @brief  Loads each image once, and hands out shared read-only copies of it
+ *         to every painter that asks for the same key.
+ *
+ *  Images are identified by a key, which is usually a file path but may be
+ * any asset ID understood by the cache's loader. The cache tracks the memory
+ * used by its images against a budget, and when the budget is exceeded, the
+ * least recently used images are evicted. Evicted images remain valid for as
+ * long as any painter still holds them, and are loaded again the next time
+ * they're requested.
+ *
+ *  Images are prepared for drawing as they're added to the cache, so every
+ * ImagePainter drawing a cached image shares one copy of its premultiplied
+ * pixels and pixel runs. Images that already provide both, such as
+ * premultiplied RawImages, are cached as they are. Any other image is wrapped
+ * in a PreparedImage, which uses the image's rows in place if it keeps
+ * premultiplied rows in memory, and otherwise replaces the loaded image with
+ * a premultiplied copy. A painter created from an image that isn't cached
+ * prepares its own private copy instead, costing about four bytes per pixel
+ * plus the runs for every painter.
+ *
+ *  Image memory use is estimated as four bytes per pixel, plus the memory
+ * used by any runs the cache prepared.
+ *
+ *  All cache functions may be called from any thread. Images are loaded
+ * without holding the cache lock, so a slow load never blocks other threads
+ * from using cached images.
+ *
+ *      ImagePainter icon(ImageCache::getShared().getImage("icons/home.png"));
+ */
+class FBPainter::ImageCache
+{
+public:
+    /**
+     * @brief  Loads an image for a cache key.
+     *
+     *  The function receives the requested key, and returns a new image that
+     * the cache will own, or nullptr if the image couldn't be loaded.
+     */
+    typedef std::function<Image*(const std::string&)> Loader;
+
+    /**
+     * @brief  Counts cache activity and memory use.
+     */
+    struct Statistics
+    {
+        // The number of requests for images that were already cached:
+        size_t hits;
+        // The number of requests that loaded an image:
+        size_t misses;
+        // The number of images evicted to stay within the budget:
+        size_t evictions;
+        // The number of cached images:
+        size_t imageCount;
+        // The estimated memory used by all cached images, in bytes:
+        size_t residentBytes;
+    };
+
+    // The memory budget used by the shared cache, in bytes:
+    static const constexpr size_t defaultBudget = 32 * 1024 * 1024;
+
+    /**
+     * @brief  Creates an empty image cache.
+     *
+     * @param budget  The number of bytes cached images may use.
+     *
+     * @param loader  The function used to load images that aren't cached.
+     *                If null, keys are treated as file paths, and loaded as
+     *                RawImages if they end with ".fbraw", as QoiImages if
+     *                they end with ".qoi", or as PngImages if they end with
+     *                ".png" and libpng support is enabled.
+     */
+    ImageCache(const size_t budget = defaultBudget,
+            const Loader& loader = Loader());
+
+    /**
+     * @brief  Gets the image cache shared by the entire process.
+     *
+     * @return  The shared cache, which loads images from file paths using
+     *          the default budget until changed.
+     */
+    static ImageCache& getShared();
+
+    /**
+     * @brief  Gets a cached image, loading it if it isn't cached.
+     *
+     * @param key  The image's path or asset ID.
+     *
+     * @return     The shared image prepared for drawing, or nullptr if it
+     *             couldn't be loaded.
+     */
+    std::shared_ptr<const Image> getImage(const std::string& key);
+
+    /**
+     * @brief  Adds an image to the cache, replacing any image already cached
+     *         with the same key.
+     *
+     * @param key    The key used to find the image.
+     *
+     * @param image  An image, which will be owned by the cache.
+     *
+     * @return       The shared image prepared for drawing.
+     */
+    std::shared_ptr<const Image> addImage(const std::string& key,
+            Image* image);
+
+    /**
+     * @brief  Removes an image from the cache.
+     *
+     * @param key  The image's path or asset ID.
+     */
+    void removeImage(const std::string& key);
+
+    /**
+     * @brief  Removes every image from the cache.
+     */
+    void clear();
+
+    /**
+     * @brief  Gets the number of bytes cached images may use.
+     *
+     * @return  The cache's memory budget.
+     */
+    size_t getBudget() const;
+
+    /**
+     * @brief  Sets the number of bytes cached images may use, evicting the
+     *         least recently used images if they now exceed the budget.
+     *
+     * @param budget  The new memory budget.
+     */
+    void setBudget(const size_t budget);
+
+    /**
+     * @brief  Gets cache activity counters and memory use.
+     *
+     * @return  The current statistics.
+     */
+    Statistics getStatistics() const;
+
+    /**
+     * @brief  Loads an image from a file path, based on its extension.
+     *
+     * @param path  A path to a .fbraw raw image file, a .qoi image file, or a
+     *              .png image file if libpng support is enabled.
+     *
+     * @return      The new image, or nullptr if the file type isn't supported
+     *              or the image couldn't be loaded.
+     */
+    static Image* loadFile(const std::string& path);
+
+private:
+    /**
+     * @brief  Estimates the memory used by a cached image.
+     *
+     * @param image  An image returned by PreparedImage::prepare.
+     *
+     * @return       The image's estimated size in bytes.
+     */
+    static size_t getImageSize(const Image& image);
+
+    /**
+     * @brief  A cached image.
+     */
+    struct Entry
+    {
+        std::string key;
+        std::shared_ptr<const Image> image;
+        // The estimated memory used by the image:
+        size_t size;
+    };
+
+    /**
+     * @brief  Adds an entry as the most recently used image, replacing any
+     *         entry with the same key, then evicts images until the cache is
+     *         within its budget. The cache lock must be held.
+     *
+     * @param key    The image's key.
+     *
+     * @param image  The image to cache.
+     */
+    void insertEntry(const std::string& key,
+            const std::shared_ptr<const Image>& image);
+
+    /**
+     * @brief  Evicts the least recently used images until the cache is
+     *         within its budget. The cache lock must be held.
+     */
+    void evict();
+
+    Loader loader;
+    size_t budget;
+    // Cached images, from most to least recently used:
+    std::list<Entry> entries;
+    // Finds the entry for each key:
+    std::unordered_map<std::string, std::list<Entry>::iterator> keyEntries;
+    Statistics statistics = { 0, 0, 0, 0, 0 };
+    mutable std::mutex lock;
+};
@@ -0,0 +1,230 @@
+#include "ImageLoader.h"
+#include "ImageCache.h"
+#include "PreparedImage.h"
+#include <algorithm>
+
+
+// Starts all decoding threads.
+FBPainter::ImageLoader::ImageLoader(const size_t threadCount,
+        ImageCache* cache) : cache(cache)
+{
+    size_t totalThreads = threadCount;
+    if (totalThreads == 0)
+    {
+        totalThreads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    for (size_t i = 0; i < totalThreads; i++)
+    {
+        threads.emplace_back(&ImageLoader::workerLoop, this);
+    }
+}
+
+
+// Cancels all queued jobs, and joins all threads once any jobs being decoded
+// finish.
+FBPainter::ImageLoader::~ImageLoader()
+{
+    cancelAll();
+    {
+        std::lock_guard<std::mutex> lock(queueLock);
+        stopping = true;
+    }
+    jobQueued.notify_all();
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+}
+
+
+// Gets the number of threads that decode images.
+size_t FBPainter::ImageLoader::getThreadCount() const
+{
+    return threads.size();
+}
+
+
+// Queues a job that loads an image file.
+std::shared_ptr<FBPainter::ImageLoader::Handle>
+FBPainter::ImageLoader::loadFile(const std::string& path)
+{
+    ImageCache* const cache = this->cache;
+    return load([cache, path]()
+    {
+        if (cache != nullptr)
+        {
+            return cache->getImage(path);
+        }
+        return std::shared_ptr<const Image>(ImageCache::loadFile(path));
+    });
+}
+
+
+// Queues a job that creates an image using any function.
+std::shared_ptr<FBPainter::ImageLoader::Handle> FBPainter::ImageLoader::load
+(const Decoder& decoder)
+{
+    const std::shared_ptr<Handle> handle(new Handle(decoder));
+    {
+        std::lock_guard<std::mutex> lock(queueLock);
+        queue.push_back(handle);
+    }
+    jobQueued.notify_one();
+    return handle;
+}
+
+
+// Cancels every job that isn't finished.
+void FBPainter::ImageLoader::cancelAll()
+{
+    std::deque<std::shared_ptr<Handle>> cancelled;
+    {
+        std::lock_guard<std::mutex> lock(queueLock);
+        cancelled.swap(queue);
+        cancelled.insert(cancelled.end(), activeJobs.begin(),
+                activeJobs.end());
+    }
+    for (const std::shared_ptr<Handle>& handle : cancelled)
+    {
+        handle->cancel();
+    }
+}
+
+
+// Decodes queued jobs until the loader is destroyed.
+void FBPainter::ImageLoader::workerLoop()
+{
+    std::unique_lock<std::mutex> lock(queueLock);
+    while (true)
+    {
+        jobQueued.wait(lock, [this]()
+        {
+            return stopping || ! queue.empty();
+        });
+        if (stopping)
+        {
+            return;
+        }
+        const std::shared_ptr<Handle> handle = queue.front();
+        queue.pop_front();
+        activeJobs.push_back(handle);
+        lock.unlock();
+
+        // Jobs cancelled while queued are skipped:
+        if (handle->start())
+        {
+            std::shared_ptr<const Image> image;
+            try
+            {
+                // Images are prepared here as well, so creating their
+                // painters never reads every pixel on the drawing thread:
+                image = PreparedImage::prepare(handle->decoder());
+            }
+            catch (const std::exception&)
+            {
+                image.reset();
+            }
+            handle->finish(image);
+        }
+
+        lock.lock();
+        activeJobs.erase(std::find(activeJobs.begin(), activeJobs.end(),
+                handle));
+    }
+}
+
+
+// Stores the function that creates the image.
+FBPainter::ImageLoader::Handle::Handle(const Decoder& decoder) :
+    decoder(decoder) { }
+
+
+// Gets the job's current stage.
+FBPainter::ImageLoader::Handle::State
+FBPainter::ImageLoader::Handle::getState() const
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return state;
+}
+
+
+// Checks if the image has been decoded.
+bool FBPainter::ImageLoader::Handle::isReady() const
+{
+    return getState() == State::Ready;
+}
+
+
+// Checks if the job is finished, successfully or not.
+bool FBPainter::ImageLoader::Handle::isDone() const
+{
+    const State current = getState();
+    return current != State::Queued && current != State::Decoding;
+}
+
+
+// Gets the decoded image.
+std::shared_ptr<const FBPainter::Image>
+FBPainter::ImageLoader::Handle::getImage() const
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return image;
+}
+
+
+// Waits until the job is finished.
+std::shared_ptr<const FBPainter::Image>
+FBPainter::ImageLoader::Handle::wait() const
+{
+    std::unique_lock<std::mutex> guard(lock);
+    finished.wait(guard, [this]()
+    {
+        return state != State::Queued && state != State::Decoding;
+    });
+    return image;
+}
+
+
+// Cancels the job if it isn't finished.
+void FBPainter::ImageLoader::Handle::cancel()
+{
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        if (state != State::Queued && state != State::Decoding)
+        {
+            return;
+        }
+        state = State::Cancelled;
+    }
+    finished.notify_all();
+}
+
+
+// Marks the job as decoding, unless it was cancelled.
+bool FBPainter::ImageLoader::Handle::start()
+{
+    std::lock_guard<std::mutex> guard(lock);
+    if (state != State::Queued)
+    {
+        return false;
+    }
+    state = State::Decoding;
+    return true;
+}
+
+
+// Stores the decoded image, unless the job was cancelled.
+void FBPainter::ImageLoader::Handle::finish
+(const std::shared_ptr<const Image>& image)
+{
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        if (state != State::Decoding)
+        {
+            return;
+        }
+        state = (image != nullptr) ? State::Ready : State::Failed;
+        this->image = image;
+    }
+    finished.notify_all();
+}
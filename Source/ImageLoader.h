@@ -0,0 +1,226 @@
+/**
+ * @file  ImageLoader.h
+ *
+ * @brief  Decodes images on background threads, so loading assets never
+ *         blocks the thread that draws.
+ */
+
+#pragma once
+#include "Image.h"
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <stddef.h>
+
+namespace FBPainter
+{
+    class ImageLoader;
+    class ImageCache;
+}
+
+/**
+ * @brief  Queues image decoding jobs, and runs them in parallel on a fixed
+ *         set of background threads.
+ *
+ *  Each queued job returns a Handle right away. The handle reports when the
+ * image is ready, and can be used to wait for it or to cancel the job. Jobs
+ * start in the order they were queued.
+ *
+ *  Decoded images are also prepared for drawing on the background thread, as
+ * ImageCache prepares the images it caches. Creating an ImagePainter for a
+ * loaded image then only reads its rows' runs, rather than every pixel.
+ *
+ *      ImageLoader loader;
+ *      auto handle = loader.loadFile("background.png");
+ *      ...
+ *      if (handle->isReady())
+ *      {
+ *          ImagePainter painter(handle->getImage());
+ *      }
+ */
+class FBPainter::ImageLoader
+{
+public:
+    /**
+     * @brief  A function run on a background thread that creates an image.
+     *
+     *  It returns the decoded image, or nullptr if decoding failed.
+     */
+    typedef std::function<std::shared_ptr<const Image>()> Decoder;
+
+    /**
+     * @brief  Tracks the progress of one queued job, and holds its image
+     *         once decoded.
+     *
+     *  Handles may be used from any thread, and remain valid after the
+     * loader that created them is destroyed.
+     */
+    class Handle
+    {
+    public:
+        /**
+         * @brief  The stages of a job.
+         */
+        enum class State
+        {
+            // Waiting in the queue:
+            Queued,
+            // Being decoded on a background thread:
+            Decoding,
+            // Decoded, with the image available:
+            Ready,
+            // Decoding didn't produce an image:
+            Failed,
+            // Cancelled before decoding finished:
+            Cancelled
+        };
+
+        /**
+         * @brief  Gets the job's current stage.
+         *
+         * @return  The job state.
+         */
+        State getState() const;
+
+        /**
+         * @brief  Checks if the image has been decoded.
+         *
+         * @return  Whether the image is ready to draw.
+         */
+        bool isReady() const;
+
+        /**
+         * @brief  Checks if the job is finished, successfully or not.
+         *
+         * @return  Whether the job is ready, failed, or cancelled.
+         */
+        bool isDone() const;
+
+        /**
+         * @brief  Gets the decoded image.
+         *
+         * @return  The image prepared for drawing, or nullptr if it isn't
+         *          ready.
+         */
+        std::shared_ptr<const Image> getImage() const;
+
+        /**
+         * @brief  Waits until the job is finished.
+         *
+         * @return  The decoded image, or nullptr if the job failed or was
+         *          cancelled.
+         */
+        std::shared_ptr<const Image> wait() const;
+
+        /**
+         * @brief  Cancels the job if it isn't finished.
+         *
+         *  Queued jobs are never decoded. Jobs that are already decoding run
+         * to completion, but their image is released instead of being kept.
+         */
+        void cancel();
+
+    private:
+        friend class ImageLoader;
+
+        /**
+         * @brief  Stores the function that creates the image.
+         *
+         * @param decoder  The job's decoding function.
+         */
+        Handle(const Decoder& decoder);
+
+        /**
+         * @brief  Marks the job as decoding, unless it was cancelled.
+         *
+         * @return  Whether the job should be decoded.
+         */
+        bool start();
+
+        /**
+         * @brief  Stores the decoded image, unless the job was cancelled.
+         *
+         * @param image  The decoded image, or nullptr if decoding failed.
+         */
+        void finish(const std::shared_ptr<const Image>& image);
+
+        Decoder decoder;
+        State state = State::Queued;
+        std::shared_ptr<const Image> image;
+        mutable std::mutex lock;
+        mutable std::condition_variable finished;
+    };
+
+    /**
+     * @brief  Starts all decoding threads.
+     *
+     * @param threadCount  The number of background threads that decode
+     *                     images. If zero, one thread is used for each
+     *                     available core.
+     *
+     * @param cache        An optional image cache used by loadFile, which
+     *                     must outlive the loader. Cached images are returned
+     *                     without decoding them again, and newly decoded
+     *                     images are added to the cache.
+     */
+    ImageLoader(const size_t threadCount = 0, ImageCache* cache = nullptr);
+
+    /**
+     * @brief  Cancels all queued jobs, and joins all threads once any jobs
+     *         being decoded finish.
+     */
+    ~ImageLoader();
+
+    /**
+     * @brief  Gets the number of threads that decode images.
+     *
+     * @return  The number of background threads.
+     */
+    size_t getThreadCount() const;
+
+    /**
+     * @brief  Queues a job that loads an image file.
+     *
+     * @param path  A path to any image file supported by ImageCache.
+     *
+     * @return      The job's handle.
+     */
+    std::shared_ptr<Handle> loadFile(const std::string& path);
+
+    /**
+     * @brief  Queues a job that creates an image using any function.
+     *
+     * @param decoder  The function run on a background thread to create the
+     *                 image.
+     *
+     * @return         The job's handle.
+     */
+    std::shared_ptr<Handle> load(const Decoder& decoder);
+
+    /**
+     * @brief  Cancels every job that isn't finished, such as when leaving a
+     *         screen whose images are still loading.
+     */
+    void cancelAll();
+
+private:
+    /**
+     * @brief  Decodes queued jobs until the loader is destroyed.
+     */
+    void workerLoop();
+
+    // Used by loadFile, if not null:
+    ImageCache* const cache;
+    std::vector<std::thread> threads;
+    // Jobs waiting for a thread, and jobs being decoded:
+    std::deque<std::shared_ptr<Handle>> queue;
+    std::vector<std::shared_ptr<Handle>> activeJobs;
+    std::mutex queueLock;
+    std::condition_variable jobQueued;
+    bool stopping = false;
+};
@@ -1,38 +1,77 @@
 #include "ImagePainter.h"
 #include "FrameBuffer.h"
+#include "DrawContext.h"
+#include "WorkerPool.h"
+#include "BlendKernels.h"
 #include <algorithm>
+#include <cstring>
 #include <new>
-#include <limits>
 
-// Represents an invalid index:
-const size_t FBPainter::ImagePainter::invalidIndex
-        = std::numeric_limits<size_t>::max();
+// Areas smaller than this many pixels are always painted on one thread, as
+// waking workers would cost more than it saves:
+static const constexpr size_t minParallelPixels = 128 * 128;
+// Minimum number of rows in each band painted by a worker:
+static const constexpr size_t minBandRows = 8;
+// Bands per worker, so faster workers can pick up extra bands:
+static const constexpr size_t bandsPerWorker = 2;
 
-// Stores image data on construction.
-FBPainter::ImagePainter::ImagePainter(Image* image) : image(image)
+
+// Finds the first pixel in a span where a row either matches or differs from
+// another row read at an offset.
+static int findMatch(const uint32_t* row, const uint32_t* otherRow,
+        const int offset, int xPos, const int xEnd, const bool matching)
 {
-    if (image != nullptr)
-    {
-        imageWidth = image->getWidth();
-        imageHeight = image->getHeight();
-    }
-    replacedPixels = new (std::nothrow) RGBPixel [imageWidth * imageHeight];
-    if (replacedPixels == nullptr)
+    while (xPos < xEnd && (row[xPos] == otherRow[xPos + offset]) != matching)
     {
-        this->image.reset(nullptr);
+        xPos++;
     }
+    return xPos;
 }
 
+// Stores image data on construction.
+FBPainter::ImagePainter::ImagePainter(Image* image) :
+    ImagePainter(std::shared_ptr<const Image>(image)) { }
 
-// Clears buffered data on destruction.
-FBPainter::ImagePainter::~ImagePainter()
+
+// Stores shared image data on construction.
+FBPainter::ImagePainter::ImagePainter(std::shared_ptr<const Image> image) :
+    image(image)
 {
-    if (replacedPixels != nullptr)
+    if (image == nullptr)
+    {
+        return;
+    }
+    imageWidth = image->getWidth();
+    imageHeight = image->getHeight();
+    drawnImage = image.get();
+    bool prepared = true;
+    if (! PreparedImage::isPrepared(*image))
+    {
+        try
+        {
+            preparedImage.reset(new PreparedImage(image));
+            drawnImage = preparedImage.get();
+        }
+        catch (const std::bad_alloc&)
+        {
+            prepared = false;
+        }
+        prepared = prepared && preparedImage->getWidth() == imageWidth
+                && preparedImage->getHeight() == imageHeight;
+    }
+    if (! prepared || ! findOpaqueRows() || ! allocateSavedPixels())
     {
-        delete [] replacedPixels;
+        // Without image data to draw, the painter draws nothing:
+        preparedImage.reset();
+        drawnImage = nullptr;
+        this->image.reset();
     }
 }
 
+
+// Clears buffered data on destruction.
+FBPainter::ImagePainter::~ImagePainter() { }
+
 // Gets the width of the image.
 size_t FBPainter::ImagePainter::getWidth() const
 {
@@ -48,37 +87,244 @@ size_t FBPainter::ImagePainter::getHeight() const
 
 
 // Gets the image's origin's x-coordinate in the FrameBuffer.
-size_t FBPainter::ImagePainter::getImageXOrigin() const
+int FBPainter::ImagePainter::getImageXOrigin() const
 {
     return xOrigin;
 }
 
 
 // Gets the image's origin's y-coordinate in the FrameBuffer.
-size_t FBPainter::ImagePainter::getImageYOrigin() const
+int FBPainter::ImagePainter::getImageYOrigin() const
 {
     return yOrigin;
 }
 
 
+// Gets the area the image covers in the FrameBuffer.
+FBPainter::Rectangle FBPainter::ImagePainter::getBounds() const
+{
+    return Rectangle(xOrigin, yOrigin, imageWidth, imageHeight);
+}
+
+
+// Gets the worker pool used to draw and clear large areas.
+FBPainter::WorkerPool* FBPainter::ImagePainter::getWorkerPool() const
+{
+    return workerPool;
+}
+
+
+// Selects a worker pool to share large draw and clear operations across
+// multiple threads.
+void FBPainter::ImagePainter::setWorkerPool(WorkerPool* pool)
+{
+    workerPool = pool;
+}
+
+
 // Draws the entire image into the frame buffer.
 void FBPainter::ImagePainter::drawImage(FrameBuffer* const frameBuffer)
 {
-    if (image == nullptr || frameBuffer == nullptr)
+    if (frameBuffer != nullptr)
+    {
+        DrawContext context(frameBuffer);
+        drawImage(context);
+    }
+}
+
+
+// Draws the part of the image within a clipping rectangle.
+void FBPainter::ImagePainter::drawImage(FrameBuffer* const frameBuffer,
+        const Rectangle& clip)
+{
+    if (frameBuffer != nullptr)
+    {
+        DrawContext context(frameBuffer);
+        context.pushClip(clip);
+        drawImage(context);
+    }
+}
+
+
+// Draws the part of the image within a draw context's clipping rectangle.
+void FBPainter::ImagePainter::drawImage(DrawContext& context)
+{
+    FrameBuffer* const frameBuffer = context.getFrameBuffer();
+    const Rectangle area = context.getClip().getIntersection(getBounds());
+    if (image == nullptr || frameBuffer == nullptr || area.isEmpty())
+    {
+        return;
+    }
+    if (! setPixelFormat(frameBuffer->getPixelFormat()))
     {
         return;
     }
-    const size_t frameWidth = frameBuffer->getWidth();
-    const size_t frameHeight = frameBuffer->getHeight();
-    const size_t xMax = std::min(frameWidth, xOrigin + imageWidth) - 1;
-    const size_t yMax = std::min(frameHeight, yOrigin + imageHeight) - 1;
-    for (int y = yOrigin; y <= yMax; y++)
+    paintBands(area, [this, frameBuffer](const Rectangle& band,
+            std::vector<uint32_t>& rowBuffer)
     {
+        drawRows(band, frameBuffer, rowBuffer);
+    });
+    if (area == getBounds())
+    {
+        imageDrawn = true;
+    }
+}
+
+
+// Reads one pixel of packed native pixel data.
+static inline uint32_t loadPixel(const uint8_t* pixel,
+        const size_t bytesPerPixel)
+{
+    uint32_t value = 0;
+    switch (bytesPerPixel)
+    {
+        case 4:
+            memcpy(&value, pixel, 4);
+            break;
+        case 3:
+            memcpy(&value, pixel, 3);
+            break;
+        case 2:
+            memcpy(&value, pixel, 2);
+            break;
+        default:
+            memcpy(&value, pixel, 1);
+    }
+    return value;
+}
+
+
+// Draws image pixels into every row of a frame buffer area.
+void FBPainter::ImagePainter::drawRows(const Rectangle& area,
+        FrameBuffer* const frameBuffer, std::vector<uint32_t>& rowBuffer)
+{
+    const size_t spanWidth = area.getWidth();
+    const size_t imageXStart = area.getLeft() - xOrigin;
+    const size_t imageXEnd = imageXStart + spanWidth;
+    const size_t bytesPerPixel = getBytesPerPixel(nativeFormat);
+    // The row buffer holds native frame buffer pixels, then colors being
+    // blended, then the blended colors in the native format:
+    uint8_t* const bufferRow = reinterpret_cast<uint8_t*>(rowBuffer.data());
+    uint32_t* const blendedColors = rowBuffer.data() + spanWidth;
+    uint8_t* const blendedRow = reinterpret_cast<uint8_t*>(
+            rowBuffer.data() + spanWidth * 2);
+    for (int y = area.getTop(); y < area.getBottom(); y++)
+    {
+        const size_t imageY = y - yOrigin;
+        size_t runCount;
+        const PixelRun* const rowRuns = drawnImage->getRowRuns(imageY,
+                runCount);
+        const uint32_t* const rowPixels
+                = drawnImage->getPremultipliedRow(imageY);
+        if (rowRuns == nullptr || rowPixels == nullptr)
         {
-            for (int x = xOrigin; x <= xMax; x++)
+            continue;
+        }
+        frameBuffer->readSpan(area.getLeft(), y, bufferRow, spanWidth);
+        // Track the changed part of the row, so only that part gets written:
+        size_t firstChanged = spanWidth;
+        size_t lastChanged = 0;
+        // Runs are sorted by position, so skip straight to the first run
+        // that reaches the area, and stop at the first run past it:
+        const PixelRun* const rowEnd = rowRuns + runCount;
+        const PixelRun* firstRun = std::upper_bound(rowRuns, rowEnd,
+                imageXStart, [](const size_t xPos, const PixelRun& run)
+                {
+                    return xPos < static_cast<size_t>(run.start) + run.length;
+                });
+        for (const PixelRun* runIter = firstRun; runIter != rowEnd
+                && runIter->start < imageXEnd; runIter++)
+        {
+            const PixelRun& run = *runIter;
+            const size_t runStart = std::max<size_t>(run.start, imageXStart);
+            const size_t runEnd = std::min<size_t>(
+                    static_cast<size_t>(run.start) + run.length, imageXEnd);
+            if (runStart >= runEnd)
             {
-                drawPixel(x, y, frameBuffer);
+                continue;
             }
+            const size_t offset = runStart - imageXStart;
+            const size_t count = runEnd - runStart;
+            uint8_t* const bufferPixels = bufferRow + offset * bytesPerPixel;
+            if (run.type == RunType::Transparent)
+            {
+                // Transparent pixels only restore saved backgrounds:
+                for (size_t savedStart = savedPixels.findSaved(runStart,
+                        runEnd, imageY); savedStart < runEnd;
+                        savedStart = savedPixels.findSaved(savedStart,
+                        runEnd, imageY))
+                {
+                    const size_t savedEnd = savedPixels.findUnsaved(
+                            savedStart, runEnd, imageY);
+                    savedPixels.copyPixels(savedStart, savedEnd - savedStart,
+                            imageY, bufferRow + (savedStart - imageXStart)
+                            * bytesPerPixel);
+                    savedPixels.discardPixels(savedStart, savedEnd, imageY);
+                    firstChanged = std::min(firstChanged,
+                            savedStart - imageXStart);
+                    lastChanged = std::max(lastChanged,
+                            savedEnd - 1 - imageXStart);
+                    savedStart = savedEnd;
+                }
+                continue;
+            }
+
+            if (run.type == RunType::Opaque)
+            {
+                // Opaque premultiplied pixels already hold their color, and
+                // packing ignores their alpha byte:
+                converter->packSpan(rowPixels + runStart, blendedRow, count);
+            }
+            else
+            {
+                // Blend the run over saved backgrounds where they exist, and
+                // over the current frame buffer colors everywhere else:
+                converter->unpackSpan(bufferPixels, blendedColors, count);
+                for (size_t i = 0; i < count; i++)
+                {
+                    if (savedPixels.isSaved(runStart + i, imageY))
+                    {
+                        blendedColors[i]
+                                = savedPixels.getColor(runStart + i, imageY);
+                    }
+                }
+                blendSpan(rowPixels + runStart, blendedColors, count);
+                converter->packSpan(blendedColors, blendedRow, count);
+            }
+            const uint8_t* const imagePixels = blendedRow;
+            const size_t runBytes = count * bytesPerPixel;
+            if (memcmp(bufferPixels, imagePixels, runBytes) == 0)
+            {
+                continue;
+            }
+            // Save every pixel the run changes before copying it:
+            size_t firstRunChange = count;
+            size_t lastRunChange = 0;
+            for (size_t i = 0; i < count; i++)
+            {
+                const uint32_t bufferValue = loadPixel(
+                        bufferPixels + i * bytesPerPixel, bytesPerPixel);
+                if (bufferValue != loadPixel(imagePixels + i * bytesPerPixel,
+                        bytesPerPixel))
+                {
+                    if (! savedPixels.isSaved(runStart + i, imageY))
+                    {
+                        savedPixels.savePixel(runStart + i, imageY,
+                                bufferValue);
+                    }
+                    firstRunChange = std::min(firstRunChange, i);
+                    lastRunChange = i;
+                }
+            }
+            memcpy(bufferPixels, imagePixels, runBytes);
+            firstChanged = std::min(firstChanged, offset + firstRunChange);
+            lastChanged = std::max(lastChanged, offset + lastRunChange);
+        }
+        if (firstChanged < spanWidth)
+        {
+            frameBuffer->writeSpan(area.getLeft() + firstChanged, y,
+                    bufferRow + firstChanged * bytesPerPixel,
+                    lastChanged - firstChanged + 1);
         }
     }
 }
@@ -87,161 +333,556 @@ void FBPainter::ImagePainter::drawImage(FrameBuffer* const frameBuffer)
 // Clears drawn image date from the frame buffer.
 void FBPainter::ImagePainter::clearImage(FrameBuffer* const frameBuffer)
 {
-    if (image == nullptr || frameBuffer == nullptr)
+    if (frameBuffer != nullptr)
     {
-        return;
+        DrawContext context(frameBuffer);
+        clearImage(context);
+    }
+}
+
+
+// Clears drawn image data within a clipping rectangle.
+void FBPainter::ImagePainter::clearImage(FrameBuffer* const frameBuffer,
+        const Rectangle& clip)
+{
+    if (frameBuffer != nullptr)
+    {
+        DrawContext context(frameBuffer);
+        context.pushClip(clip);
+        clearImage(context);
+    }
+}
+
+
+// Clears drawn image data within a draw context's clipping rectangle.
+void FBPainter::ImagePainter::clearImage(DrawContext& context)
+{
+    FrameBuffer* const frameBuffer = context.getFrameBuffer();
+    if (image != nullptr && frameBuffer != nullptr)
+    {
+        setPixelFormat(frameBuffer->getPixelFormat());
+        restorePixels(context.getClip().getIntersection(getBounds()),
+                frameBuffer);
+        imageDrawn = false;
     }
-    const size_t frameWidth = frameBuffer->getWidth();
-    const size_t frameHeight = frameBuffer->getHeight();
-    const size_t xMax = std::min(frameWidth, xOrigin + imageWidth) - 1;
-    const size_t yMax = std::min(frameHeight, yOrigin + imageHeight) - 1;
-    for (int y = yOrigin; y <= yMax; y++)
+}
+
+
+// Sets the image's origin in the FrameBuffer.
+void FBPainter::ImagePainter::setImageOrigin(const int xPos, const int yPos,
+        FrameBuffer* const frameBuffer)
+{
+    if (frameBuffer == nullptr)
     {
+        if (image != nullptr)
         {
-            for (int x = xOrigin; x <= xMax; x++)
-            {
-                clearPixel(x, y, frameBuffer);
-            }
+            xOrigin = xPos;
+            yOrigin = yPos;
         }
+        return;
     }
+    DrawContext context(frameBuffer);
+    setImageOrigin(xPos, yPos, context);
 }
 
 
-// Sets the image's origin in the FrameBuffer.
-void FBPainter::ImagePainter::setImageOrigin(const size_t xPos,
-        const size_t yPos, FrameBuffer* const frameBuffer)
+// Sets the image's origin, and updates image data within a draw context's
+// clipping rectangle.
+void FBPainter::ImagePainter::setImageOrigin(const int xPos, const int yPos,
+        DrawContext& context)
 {
     if (image == nullptr || (xPos == xOrigin && yPos == yOrigin))
     {
         return;
     }
+    FrameBuffer* const frameBuffer = context.getFrameBuffer();
     if (frameBuffer == nullptr)
     {
-        xOrigin = xPos;
-        yOrigin = yPos;
+        // Without a frame buffer to update, only the origin changes:
+        setImageOrigin(xPos, yPos, nullptr);
         return;
     }
-    const size_t oldXMax = std::min(xOrigin + imageWidth,
-            frameBuffer->getWidth()) - 1;
-    const size_t oldYMax = std::min(yOrigin + imageHeight,
-            frameBuffer->getHeight()) - 1;
-    const size_t newXMax = std::min(xPos + imageWidth,
-            frameBuffer->getWidth()) - 1;
-    const size_t newYMax = std::min(yPos + imageHeight,
-            frameBuffer->getHeight()) - 1;
-    for (int y = yOrigin; y <= oldYMax; y++)
-    {
-        const bool yOverlap = (y >= yPos && y <= newYMax);
-        for (int x = xOrigin; x <= oldXMax; x++)
-        {
-            const bool xOverlap = (x >= xPos && x <= newXMax);
-            if(! yOverlap || ! xOverlap)
+    setPixelFormat(frameBuffer->getPixelFormat());
+    const Rectangle& clip = context.getClip();
+    const Rectangle oldBounds = getBounds();
+    const Rectangle newBounds(xPos, yPos, imageWidth, imageHeight);
+    if (imageDrawn && clip.contains(oldBounds) && clip.contains(newBounds)
+            && oldBounds.intersects(newBounds))
+    {
+        if (nonOpaqueRowCount == 0)
+        {
+            moveOpaque(newBounds, frameBuffer);
+        }
+        else
+        {
+            moveBlended(newBounds, frameBuffer);
+        }
+        return;
+    }
+
+    // Without a fully drawn image to shift, restore the old area and draw the
+    // image again at its new origin:
+    restorePixels(clip.getIntersection(oldBounds), frameBuffer);
+    if (! clip.contains(oldBounds))
+    {
+        // Pixels saved outside of the clip can't follow the image, so they're
+        // discarded:
+        savedPixels.clear();
+    }
+    xOrigin = xPos;
+    yOrigin = yPos;
+    imageDrawn = false;
+    drawImage(context);
+}
+
+
+// Moves a drawn opaque image by copying its pixels within the frame buffer.
+void FBPainter::ImagePainter::moveOpaque(const Rectangle& newBounds,
+        FrameBuffer* const frameBuffer)
+{
+    const Rectangle oldBounds = getBounds();
+    // Save the background under newly covered strips before anything moves:
+    const std::vector<Rectangle> coveredStrips
+            = newBounds.getDifference(oldBounds);
+    std::vector<uint32_t> coveredPixels;
+    for (const Rectangle& strip : coveredStrips)
+    {
+        for (int y = strip.getTop(); y < strip.getBottom(); y++)
+        {
+            const size_t start = coveredPixels.size();
+            coveredPixels.resize(start + strip.getWidth());
+            frameBuffer->readSpanRGB(strip.getLeft(), y,
+                    coveredPixels.data() + start, strip.getWidth());
+        }
+    }
+
+    frameBuffer->moveRect(oldBounds.getLeft(), oldBounds.getTop(),
+            imageWidth, imageHeight, newBounds.getLeft(), newBounds.getTop());
+    for (const Rectangle& strip : oldBounds.getDifference(newBounds))
+    {
+        restorePixels(strip, frameBuffer);
+    }
+    const int xOffset = newBounds.getLeft() - xOrigin;
+    const int yOffset = newBounds.getTop() - yOrigin;
+    savedPixels.shift(xOffset, yOffset);
+    xOrigin = newBounds.getLeft();
+    yOrigin = newBounds.getTop();
+
+    // Missing saved pixels under the old image mean the background matched
+    // the drawn image color, so that color is saved in their place. Opaque
+    // premultiplied pixels already hold their color:
+    const Rectangle overlap = oldBounds.getIntersection(newBounds)
+            .getTranslated(-xOrigin, -yOrigin);
+    const size_t overlapEnd = overlap.getRight();
+    for (int y = overlap.getTop(); y < overlap.getBottom(); y++)
+    {
+        const uint32_t* const oldRow
+                = drawnImage->getPremultipliedRow(y + yOffset);
+        for (size_t x = savedPixels.findUnsaved(overlap.getLeft(),
+                overlapEnd, y); x < overlapEnd;
+                x = savedPixels.findUnsaved(x + 1, overlapEnd, y))
+        {
+            savedPixels.saveColor(x, y, oldRow[x + xOffset] & 0xffffff);
+        }
+    }
+
+    size_t pixelIndex = 0;
+    for (const Rectangle& strip : coveredStrips)
+    {
+        for (int y = strip.getTop(); y < strip.getBottom(); y++)
+        {
+            for (int x = strip.getLeft(); x < strip.getRight(); x++)
             {
-                clearPixel(x, y, frameBuffer);
+                savedPixels.saveColor(x - xOrigin, y - yOrigin,
+                        coveredPixels[pixelIndex++]);
             }
-            else
+        }
+    }
+}
+
+
+// Moves a drawn image with transparency, only blending pixels where the image
+// pixel over the background has changed.
+void FBPainter::ImagePainter::moveBlended(const Rectangle& newBounds,
+        FrameBuffer* const frameBuffer)
+{
+    const Rectangle oldBounds = getBounds();
+    for (const Rectangle& strip : oldBounds.getDifference(newBounds))
+    {
+        restorePixels(strip, frameBuffer);
+    }
+    if (rowBuffers.empty())
+    {
+        rowBuffers.resize(1);
+    }
+    std::vector<uint32_t>& rowBuffer = rowBuffers[0];
+    rowBuffer.resize(imageWidth * 3);
+
+    // Where the image pixel becomes transparent, restore the background
+    // saved under the old image pixel. Rows without runs aren't drawn, so
+    // they're restored entirely:
+    const Rectangle overlap = oldBounds.getIntersection(newBounds);
+    for (int y = overlap.getTop(); y < overlap.getBottom(); y++)
+    {
+        size_t runCount;
+        const PixelRun* const rowRuns = drawnImage->getRowRuns(
+                y - newBounds.getTop(), runCount);
+        if (rowRuns == nullptr)
+        {
+            restoreRows(Rectangle(overlap.getLeft(), y, overlap.getWidth(), 1),
+                    frameBuffer, rowBuffer);
+            continue;
+        }
+        for (size_t i = 0; i < runCount; i++)
+        {
+            const PixelRun& run = rowRuns[i];
+            const int left = std::max<int>(newBounds.getLeft() + run.start,
+                    overlap.getLeft());
+            const int right = std::min<int>(newBounds.getLeft() + run.start
+                    + run.length, overlap.getRight());
+            if (run.type == RunType::Transparent && left < right)
             {
-                RGBAPixel imagePixel = image->getRGBAPixel(x - xPos, y - yPos);
-                if (imagePixel.isTransparent())
+                restoreRows(Rectangle(left, y, right - left, 1), frameBuffer,
+                        rowBuffer);
+            }
+        }
+    }
+
+    const int xOffset = newBounds.getLeft() - xOrigin;
+    const int yOffset = newBounds.getTop() - yOrigin;
+    savedPixels.shift(xOffset, yOffset);
+    xOrigin = newBounds.getLeft();
+    yOrigin = newBounds.getTop();
+
+    // Where the same image pixel now covers the same background, the frame
+    // buffer and shifted saved pixels are already correct. Every other
+    // non-transparent pixel is blended again, one changed span at a time:
+    const int width = imageWidth;
+    const int height = imageHeight;
+    for (int imageY = 0; imageY < height; imageY++)
+    {
+        size_t runCount;
+        const PixelRun* const rowRuns = drawnImage->getRowRuns(imageY,
+                runCount);
+        if (rowRuns == nullptr)
+        {
+            continue;
+        }
+        const uint32_t* const row = drawnImage->getPremultipliedRow(imageY);
+        // Old rows without runs weren't drawn, so none of their pixels can
+        // be reused:
+        const int oldY = imageY + yOffset;
+        size_t oldRunCount = 0;
+        const uint32_t* const oldRow = (oldY >= 0 && oldY < height
+                && drawnImage->getRowRuns(oldY, oldRunCount) != nullptr)
+                ? drawnImage->getPremultipliedRow(oldY) : nullptr;
+        // Image columns that were also covered by the old image:
+        const int sharedStart = (oldRow != nullptr)
+                ? std::max(0, -xOffset) : 0;
+        const int sharedEnd = (oldRow != nullptr)
+                ? std::min(width, width - xOffset) : 0;
+        for (size_t i = 0; i < runCount; i++)
+        {
+            const PixelRun& run = rowRuns[i];
+            if (run.type == RunType::Transparent)
+            {
+                continue;
+            }
+            // Only pixels within the shared columns may be unchanged:
+            const int runEnd = run.start + run.length;
+            const int sameStart = std::min(std::max<int>(sharedStart,
+                    run.start), runEnd);
+            const int sameEnd = std::min(std::max(sharedEnd, sameStart),
+                    runEnd);
+            int changeStart = run.start;
+            int x = sameStart;
+            while (true)
+            {
+                x = findMatch(row, oldRow, xOffset, x, sameEnd, true);
+                const int changeEnd = (x == sameEnd) ? runEnd : x;
+                if (changeEnd > changeStart)
+                {
+                    drawRows(Rectangle(xOrigin + changeStart,
+                            yOrigin + imageY, changeEnd - changeStart, 1),
+                            frameBuffer, rowBuffer);
+                }
+                if (x == sameEnd)
                 {
-                    clearPixel(x, y, frameBuffer);
+                    break;
                 }
+                x = findMatch(row, oldRow, xOffset, x, sameEnd, false);
+                changeStart = x;
             }
         }
     }
-    xOrigin = xPos;
-    yOrigin = yPos;
-    drawImage(frameBuffer);
 }
 
 
-// Draws one image pixel into a FrameBuffer.
-void FBPainter::ImagePainter::drawPixel
-(const size_t xPos, const size_t yPos, FrameBuffer* const frameBuffer)
+// Restores saved frame buffer pixels within part of the image bounds.
+void FBPainter::ImagePainter::restorePixels(const Rectangle& area,
+        FrameBuffer* const frameBuffer)
 {
-    // Ignore pixels outside of the frame or image bounds:
-    if (outOfBounds(xPos, yPos, frameBuffer))
+    if (area.isEmpty())
     {
         return;
     }
-    const size_t imageX = xPos - xOrigin;
-    const size_t imageY = yPos - yOrigin;
-    const RGBAPixel sourcePixel = image->getRGBAPixel(imageX, imageY);
-    if (sourcePixel.isTransparent())
+    paintBands(area, [this, frameBuffer](const Rectangle& band,
+            std::vector<uint32_t>& rowBuffer)
     {
-        clearPixel(xPos, yPos, frameBuffer);
-        return;
-    }
+        restoreRows(band, frameBuffer, rowBuffer);
+    });
+}
 
-    // If relevant, apply transparency to get the new pixel color:
-    const RGBPixel bufferPixel = frameBuffer->getPixel(xPos, yPos);
-    const int pixelIdx = bufferIndex(imageX, imageY);
-    const RGBPixel& replacedPixel = replacedPixels[pixelIdx];
-    RGBPixel pixelToDraw = sourcePixel.getCombinedPixel(
-            replacedPixel.isNull() ? bufferPixel : replacedPixel);
-    // Ignore pixels that already match the frame buffer pixel:
-    if (pixelToDraw == bufferPixel)
+
+// Restores saved frame buffer pixels within every row of a frame buffer area.
+void FBPainter::ImagePainter::restoreRows(const Rectangle& area,
+        FrameBuffer* const frameBuffer, std::vector<uint32_t>& rowBuffer)
+{
+    const size_t imageXStart = area.getLeft() - xOrigin;
+    const size_t imageXEnd = imageXStart + area.getWidth();
+    // Saved pixels are copied out in the frame buffer's own format:
+    uint8_t* const bufferRow = reinterpret_cast<uint8_t*>(rowBuffer.data());
+    for (int y = area.getTop(); y < area.getBottom(); y++)
     {
-        return;
+        const size_t imageY = y - yOrigin;
+        // Restore each run of saved pixels with a single span write:
+        for (size_t savedStart = savedPixels.findSaved(imageXStart, imageXEnd,
+                imageY); savedStart < imageXEnd; savedStart = savedPixels
+                .findSaved(savedStart, imageXEnd, imageY))
+        {
+            const size_t savedEnd = savedPixels.findUnsaved(savedStart,
+                    imageXEnd, imageY);
+            const size_t count = savedEnd - savedStart;
+            savedPixels.copyPixels(savedStart, count, imageY, bufferRow);
+            savedPixels.discardPixels(savedStart, savedEnd, imageY);
+            frameBuffer->writeSpan(xOrigin + savedStart, y, bufferRow, count);
+            savedStart = savedEnd;
+        }
     }
+}
 
-    // Update the frame buffer pixel, saving the old frame buffer pixel to the
-    // replaced pixel buffer:
-    if (replacedPixel.isNull())
+
+// Gets the image being drawn.
+const FBPainter::Image* FBPainter::ImagePainter::getImage() const
+{
+    return image.get();
+}
+
+
+// Limits saved pixel storage to a range of columns in each image row.
+bool FBPainter::ImagePainter::reserveSavedPixels
+(const std::vector<size_t>& firstColumns,
+        const std::vector<size_t>& lastColumns)
+{
+    if (image != nullptr && ! savedPixels.allocate(firstColumns, lastColumns))
     {
-        replacedPixels[pixelIdx] = bufferPixel;
+        image.reset();
     }
-    frameBuffer->setPixel(xPos, yPos, pixelToDraw);
+    return image != nullptr;
 }
 
 
-// Removes image data from one pixel in a frame buffer.
-void FBPainter::ImagePainter::clearPixel(const size_t xPos, const size_t yPos,
-        FrameBuffer* const frameBuffer)
+// Reloads image pixels within areas of the image after the image data
+// changes, and redraws those areas if the image is drawn.
+void FBPainter::ImagePainter::updateImagePixels
+(const std::vector<Rectangle>& areas, DrawContext* const context)
 {
-    // Ignore pixels outside of the frame or image bounds:
-    if (outOfBounds(xPos, yPos, frameBuffer))
+    if (image == nullptr)
     {
         return;
     }
-    const size_t imageX = xPos - xOrigin;
-    const size_t imageY = yPos - yOrigin;
-    const int pixelIdx = bufferIndex(imageX, imageY);
-    const RGBPixel& oldPixel = replacedPixels[pixelIdx];
-    if (oldPixel.isNull())
+    // A context without a frame buffer can't be redrawn, so changes are only
+    // reloaded:
+    DrawContext* const drawContext = (context != nullptr
+            && context->getFrameBuffer() != nullptr) ? context : nullptr;
+    if (drawContext != nullptr && ! setPixelFormat(
+            drawContext->getFrameBuffer()->getPixelFormat()))
     {
         return;
     }
-    frameBuffer->setPixel(xPos, yPos, oldPixel);
-    replacedPixels[pixelIdx] = RGBPixel();
+    // Images drawn directly already hold their changes:
+    if (preparedImage != nullptr)
+    {
+        preparedImage->update(*image, areas);
+    }
+    const Rectangle imageBounds(0, 0, imageWidth, imageHeight);
+    for (const Rectangle& area : areas)
+    {
+        const Rectangle imageArea = area.getIntersection(imageBounds);
+        for (int y = imageArea.getTop(); y < imageArea.getBottom(); y++)
+        {
+            updateOpaqueRow(y);
+        }
+    }
+    // Changed areas of an image that isn't fully drawn would leave a partial
+    // image behind, so they wait for the next full draw:
+    if (drawContext == nullptr || ! imageDrawn)
+    {
+        return;
+    }
+    FrameBuffer* const frameBuffer = drawContext->getFrameBuffer();
+    for (const Rectangle& area : areas)
+    {
+        const Rectangle bufferArea = drawContext->getClip().getIntersection(
+                Rectangle(area.getLeft() + xOrigin, area.getTop() + yOrigin,
+                        area.getWidth(), area.getHeight()))
+                .getIntersection(getBounds());
+        if (bufferArea.isEmpty())
+        {
+            continue;
+        }
+        paintBands(bufferArea, [this, frameBuffer](const Rectangle& band,
+                std::vector<uint32_t>& rowBuffer)
+        {
+            drawRows(band, frameBuffer, rowBuffer);
+        });
+    }
 }
 
 
-// Gets the index of a pixel in the replaced pixel buffer.
-size_t FBPainter::ImagePainter::bufferIndex
-(const size_t xPos, const size_t yPos) const
+// Checks if every pixel in an image row is fully opaque.
+static bool isOpaqueRow(const FBPainter::Image& image, const size_t yPos)
 {
-    if (xPos >= imageWidth || yPos >= imageHeight)
+    // Rows without runs aren't drawn, so they can't be moved by copying
+    // their pixels:
+    size_t runCount;
+    const FBPainter::PixelRun* rowRuns = image.getRowRuns(yPos, runCount);
+    return rowRuns != nullptr && std::all_of(rowRuns, rowRuns + runCount,
+            [](const FBPainter::PixelRun& run)
+            {
+                return run.type == FBPainter::RunType::Opaque;
+            });
+}
+
+
+// Checks the runs in every image row to find which rows are fully opaque.
+bool FBPainter::ImagePainter::findOpaqueRows()
+{
+    try
+    {
+        opaqueRows.assign(imageHeight, false);
+    }
+    catch (const std::bad_alloc&)
     {
-        return invalidIndex;
+        return false;
     }
-    return yPos * imageWidth + xPos;
+    nonOpaqueRowCount = 0;
+    for (size_t y = 0; y < imageHeight; y++)
+    {
+        opaqueRows[y] = isOpaqueRow(*drawnImage, y);
+        if (! opaqueRows[y])
+        {
+            nonOpaqueRowCount++;
+        }
+    }
+    return true;
 }
 
 
-// Checks if a coordinate is outside either the framebuffer bounds or the image
-// bounds.
-bool FBPainter::ImagePainter::outOfBounds(const size_t xPos, const size_t yPos,
-        FrameBuffer* const frameBuffer)
+// Checks whether one image row is still fully opaque after its pixels change.
+void FBPainter::ImagePainter::updateOpaqueRow(const size_t yPos)
+{
+    const bool opaque = isOpaqueRow(*drawnImage, yPos);
+    if (opaque != opaqueRows[yPos])
+    {
+        opaqueRows[yPos] = opaque;
+        nonOpaqueRowCount += opaque ? -1 : 1;
+    }
+}
+
+
+// Allocates saved pixel storage covering every non-transparent run.
+bool FBPainter::ImagePainter::allocateSavedPixels()
 {
-    if (image == nullptr || frameBuffer == nullptr)
+    std::vector<size_t> firstColumns;
+    std::vector<size_t> lastColumns;
+    try
+    {
+        firstColumns.assign(imageHeight, 1);
+        lastColumns.assign(imageHeight, 0);
+    }
+    catch (const std::bad_alloc&)
+    {
+        return false;
+    }
+    for (size_t y = 0; y < imageHeight; y++)
     {
-        return true;
+        // Rows without runs are never drawn, so they need no storage:
+        size_t runCount;
+        const PixelRun* rowRuns = drawnImage->getRowRuns(y, runCount);
+        for (size_t i = 0; i < runCount; i++)
+        {
+            const PixelRun& run = rowRuns[i];
+            if (run.type == RunType::Transparent)
+            {
+                continue;
+            }
+            if (firstColumns[y] > lastColumns[y])
+            {
+                firstColumns[y] = run.start;
+            }
+            lastColumns[y] = run.start + run.length - 1;
+        }
     }
-    const size_t frameWidth = frameBuffer->getWidth();
-    const size_t frameHeight = frameBuffer->getHeight();
-    const size_t xMax = std::min(frameWidth, xOrigin + imageWidth) - 1;
-    const size_t yMax = std::min(frameHeight, yOrigin + imageHeight) - 1;
+    return savedPixels.allocate(firstColumns, lastColumns);
+}
 
-    return xPos > xMax || yPos > yMax || xPos < xOrigin || yPos < yOrigin;
+
+// Selects the pixel format used to draw the image and save frame buffer
+// pixels.
+bool FBPainter::ImagePainter::setPixelFormat(const PixelFormat format)
+{
+    savedPixels.setPixelFormat(format);
+    if (format != nativeFormat)
+    {
+        converter = PixelConverter::forFormat(format);
+        nativeFormat = format;
+    }
+    return converter != nullptr;
 }
+
+
+// Paints an area in bands of whole rows, sharing the bands across the worker
+// pool if the area is large enough.
+void FBPainter::ImagePainter::paintBands(const Rectangle& area,
+        const BandPainter& painter)
+{
+    const size_t rows = area.getHeight();
+    size_t bandCount = 1;
+    if (workerPool != nullptr
+            && static_cast<size_t>(area.getWidth()) * rows >= minParallelPixels)
+    {
+        bandCount = std::min(workerPool->getThreadCount() * bandsPerWorker,
+                std::max<size_t>(1, rows / minBandRows));
+    }
+    const size_t workerCount = (bandCount > 1)
+            ? workerPool->getThreadCount() : 1;
+    if (rowBuffers.size() < workerCount)
+    {
+        rowBuffers.resize(workerCount);
+    }
+    // Pad each row buffer by a cache line, so no two workers write to the
+    // same line even if their buffers were allocated next to each other:
+    const size_t padding = WorkerPool::cacheLineSize / sizeof(uint32_t);
+    for (size_t i = 0; i < workerCount; i++)
+    {
+        rowBuffers[i].reserve(area.getWidth() * 3 + padding);
+        rowBuffers[i].resize(area.getWidth() * 3);
+    }
+    if (bandCount == 1)
+    {
+        painter(area, rowBuffers[0]);
+        return;
+    }
+    // Each band covers whole rows, so workers never write to the same pixels
+    // or saved pixel rows:
+    workerPool->run(bandCount, [this, &area, &painter, rows, bandCount]
+            (const size_t band, const size_t worker)
+    {
+        const int top = area.getTop() + rows * band / bandCount;
+        const int bottom = area.getTop() + rows * (band + 1) / bandCount;
+        painter(Rectangle(area.getLeft(), top, area.getWidth(), bottom - top),
+                rowBuffers[worker]);
+    });
+}
+
@@ -6,14 +6,22 @@
 
 #pragma once
 #include "Image.h"
+#include "PreparedImage.h"
+#include "PixelFormat.h"
+#include "Rectangle.h"
 #include "RGBPixel.h"
 #include "RGBAPixel.h"
+#include "SaveUnderBuffer.h"
+#include <functional>
 #include <memory>
+#include <vector>
 
 namespace FBPainter
 {
     class ImagePainter;
     class FrameBuffer;
+    class DrawContext;
+    class WorkerPool;
 }
 
 class FBPainter::ImagePainter
@@ -27,6 +35,20 @@ public:
      */
     ImagePainter(Image* image);
 
+    /**
+     * @brief  Stores shared image data on construction.
+     *
+     *  The image is only read, so one image, such as an image from an
+     * ImageCache, may be shared by any number of painters. Images that
+     * provide premultiplied rows and runs, such as a PreparedImage or a
+     * premultiplied RawImage, are drawn straight from those rows. Any other
+     * image is read into a PreparedImage owned by the painter.
+     *
+     * @param image  An image data object, to be released when the
+     *               ImagePainter is destroyed.
+     */
+    ImagePainter(std::shared_ptr<const Image> image);
+
     /**
      * @brief  Clears buffered data on destruction.
      */
@@ -50,17 +72,53 @@ public:
      * @brief  Gets the image origin's x-coordinate in the FrameBuffer.
      *
      * @return  The x-coordinates of the image's top left corner within the
-     *          frame buffer.
+     *          frame buffer. This may be negative if the image extends past
+     *          the left edge of the buffer.
      */
-    size_t getImageXOrigin() const;
+    int getImageXOrigin() const;
 
     /**
      * @brief  Gets the image origin's y-coordinate in the FrameBuffer.
      *
      * @return  The y-coordinates of the image's top left corner within the
-     *          frame buffer.
+     *          frame buffer. This may be negative if the image extends past
+     *          the top edge of the buffer.
+     */
+    int getImageYOrigin() const;
+
+    /**
+     * @brief  Gets the area the image covers in the FrameBuffer.
+     *
+     * @return  The image bounds, which may extend outside of the frame buffer.
+     */
+    Rectangle getBounds() const;
+
+    /**
+     * @brief  Gets the worker pool used to draw and clear large areas.
+     *
+     * @return  The painter's worker pool, or nullptr if it only draws on the
+     *          calling thread.
      */
-    size_t getImageYOrigin() const;
+    WorkerPool* getWorkerPool() const;
+
+    /**
+     * @brief  Selects a worker pool to share large draw and clear operations
+     *         across multiple threads.
+     *
+     *  Large areas are split into bands of whole rows, and each band is
+     * painted by one worker with its own row buffer. Results are identical to
+     * drawing on a single thread.
+     *
+     *  While a pool is in use, the frame buffer may receive span writes from
+     * several threads at once, so it must not be accessed by any other thread
+     * until the operation returns.
+     *
+     * @param pool  A worker pool that will outlive the painter, or nullptr to
+     *              always draw on the calling thread. The painter does not
+     *              take ownership of the pool, so it can be shared by any
+     *              number of painters.
+     */
+    void setWorkerPool(WorkerPool* pool);
 
     /**
      * @brief  Sets the image's origin in the FrameBuffer.
@@ -74,9 +132,30 @@ public:
      * @param frameBuffer  If this buffer pointer is non-null, image data will
      *                     be updated with the change in origin.
      */
-    void setImageOrigin(const size_t xPos, const size_t yPos,
+    void setImageOrigin(const int xPos, const int yPos,
             FrameBuffer* const frameBuffer = nullptr);
 
+    /**
+     * @brief  Sets the image's origin, and updates image data within a draw
+     *         context's clipping rectangle.
+     *
+     *  If the whole image is drawn, and stays within the clipping rectangle
+     * at both origins, only the strips it uncovers are restored. Opaque
+     * images are then moved by copying their pixels within the frame buffer,
+     * and other images only blend pixels where the image pixel over the
+     * background changed. Otherwise, the old area is restored and the image
+     * is drawn again.
+     *
+     * @param xPos     The new x-coordinate of the image's top left corner in
+     *                 the frame buffer.
+     *
+     * @param yPos     The new y-coordinate of the image's top left corner in
+     *                 the frame buffer.
+     *
+     * @param context  The draw context used to update image data.
+     */
+    void setImageOrigin(const int xPos, const int yPos, DrawContext& context);
+
     /**
      * @brief  Draws the entire image into the frame buffer.
      *
@@ -84,6 +163,28 @@ public:
      */
     void drawImage(FrameBuffer* const frameBuffer);
 
+    /**
+     * @brief  Draws the part of the image within a clipping rectangle.
+     *
+     *  Only image rows and runs within the clipping rectangle are visited,
+     * so the cost depends on the size of the clipped area rather than the
+     * size of the image. This can repair a small damaged area of a large
+     * image that is already drawn.
+     *
+     * @param frameBuffer  The frame buffer object.
+     *
+     * @param clip         The frame buffer area to draw within.
+     */
+    void drawImage(FrameBuffer* const frameBuffer, const Rectangle& clip);
+
+    /**
+     * @brief  Draws the part of the image within a draw context's clipping
+     *         rectangle.
+     *
+     * @param context  The draw context used to draw the image.
+     */
+    void drawImage(DrawContext& context);
+
     /**
      * @brief  Clears drawn image date from the frame buffer.
      *
@@ -91,71 +192,236 @@ public:
      */
     void clearImage(FrameBuffer* const frameBuffer);
 
+    /**
+     * @brief  Clears drawn image data within a clipping rectangle.
+     *
+     *  Only saved pixels within the clipping rectangle are restored, so the
+     * cost depends on the size of the clipped area rather than the size of
+     * the image.
+     *
+     * @param frameBuffer  The frame buffer object.
+     *
+     * @param clip         The frame buffer area to clear.
+     */
+    void clearImage(FrameBuffer* const frameBuffer, const Rectangle& clip);
+
+    /**
+     * @brief  Clears drawn image data within a draw context's clipping
+     *         rectangle.
+     *
+     * @param context  The draw context used to clear the image.
+     */
+    void clearImage(DrawContext& context);
+
+protected:
+    /**
+     * @brief  Gets the image being drawn.
+     *
+     * @return  The image, or nullptr if it was null or couldn't be loaded.
+     */
+    const Image* getImage() const;
+
+    /**
+     * @brief  Limits saved pixel storage to a range of columns in each image
+     *         row, for images that may later cover more pixels than they do
+     *         now.
+     *
+     *  This discards all saved pixels, so it should only be called before
+     * the image is drawn. If the storage can't be allocated, the image is
+     * deleted, just as if it had failed to load.
+     *
+     * @param firstColumns  The first x-coordinate the image may cover in each
+     *                      row.
+     *
+     * @param lastColumns   The last x-coordinate the image may cover in each
+     *                      row, or a value below the first column if the row
+     *                      is never covered.
+     *
+     * @return              Whether the storage was allocated successfully.
+     */
+    bool reserveSavedPixels(const std::vector<size_t>& firstColumns,
+            const std::vector<size_t>& lastColumns);
+
+    /**
+     * @brief  Reloads image pixels within areas of the image after the image
+     *         data changes, and redraws those areas if the image is drawn.
+     *
+     *  Only pixels within the given areas are read from the image, and
+     * only the rows they touch have their runs and opacity checked again.
+     * Changed areas are only redrawn if the whole image is currently drawn.
+     * The image's dimensions must not change.
+     *
+     * @param areas    The changed areas, in image coordinates.
+     *
+     * @param context  The draw context used to redraw the changed areas
+     *                 within its clipping rectangle, or nullptr to only
+     *                 reload the changed pixels.
+     */
+    void updateImagePixels(const std::vector<Rectangle>& areas,
+            DrawContext* const context);
+
 private:
     /**
-     * @brief  Draws one image pixel into a FrameBuffer.
+     * @brief  A function that paints one band of rows, using a row buffer
+     *         reserved for the thread that runs it, with room for three rows
+     *         of the band.
+     */
+    typedef std::function<void(const Rectangle&, std::vector<uint32_t>&)>
+            BandPainter;
+
+    /**
+     * @brief  Checks the runs in every image row to find which rows are
+     *         fully opaque.
+     *
+     * @return  Whether there was enough memory to store the row flags.
+     */
+    bool findOpaqueRows();
+
+    /**
+     * @brief  Checks whether one image row is still fully opaque after its
+     *         pixels change.
+     *
+     * @param yPos  The y-coordinate of the changed row.
+     */
+    void updateOpaqueRow(const size_t yPos);
+
+    /**
+     * @brief  Allocates saved pixel storage covering every non-transparent
+     *         run, so coverage comes from the runs instead of another read
+     *         of the whole image.
+     *
+     * @return  Whether the storage was allocated successfully.
+     */
+    bool allocateSavedPixels();
+
+    /**
+     * @brief  Selects the pixel format used to draw the image and save frame
+     *         buffer pixels.
+     *
+     * @param format  The pixel format of the frame buffer being updated.
      *
-     * @param xPos         X-coordinate of a pixel in the frameBuffer.
+     * @return        Whether the image can be drawn in that format.
+     */
+    bool setPixelFormat(const PixelFormat format);
+
+    /**
+     * @brief  Paints an area in bands of whole rows, sharing the bands across
+     *         the worker pool if the area is large enough.
      *
-     * @param yPos         Y-coordinate of a pixel in the frameBuffer.
+     * @param area     The frame buffer area to paint.
      *
-     * @param frameBuffer  Frame buffer where the pixel will be drawn.
+     * @param painter  The function used to paint each band.
      */
-    void drawPixel(const size_t xPos, const size_t yPos,
-            FrameBuffer* const frameBuffer);
+    void paintBands(const Rectangle& area, const BandPainter& painter);
 
     /**
-     * @brief  Removes image data from one pixel in a frame buffer.
+     * @brief  Draws image pixels into every row of a frame buffer area.
      *
-     * @param xPos         X-coordinate of a pixel in the frameBuffer.
+     *  Each row is handled one run at a time. Opaque runs are packed
+     * straight from the image row, blended runs are blended as one span, and
+     * transparent runs only restore saved pixels. Rows without runs are
+     * skipped.
      *
-     * @param yPos         Y-coordinate of a pixel in the frameBuffer.
+     * @param area         An area within both the image bounds and the frame
+     *                     buffer bounds.
      *
-     * @param frameBuffer  Frame buffer where the pixel will be cleared.
+     * @param frameBuffer  The frame buffer where the image is drawn.
+     *
+     * @param rowBuffer    A buffer with room for three rows of the area, used
+     *                     to hold native frame buffer pixels, blended colors,
+     *                     and packed image pixels.
      */
-    void clearPixel(const size_t xPos, const size_t yPos,
-            FrameBuffer* const frameBuffer);
+    void drawRows(const Rectangle& area, FrameBuffer* const frameBuffer,
+            std::vector<uint32_t>& rowBuffer);
+
+    /**
+     * @brief  Restores saved frame buffer pixels within part of the image
+     *         bounds.
+     *
+     * @param area           The frame buffer area to restore. This must be
+     *                       within both the image bounds and the frame buffer
+     *                       bounds.
+     *
+     * @param frameBuffer    Frame buffer where the pixels will be restored.
+     */
+    void restorePixels(const Rectangle& area, FrameBuffer* const frameBuffer);
 
     /**
-     * @brief  Gets the index of a pixel in the replaced pixel buffer.
+     * @brief  Restores saved frame buffer pixels within every row of a frame
+     *         buffer area.
      *
-     * @param xPos  The pixel's x-coordinate in the image.
+     * @param area         The frame buffer area to restore.
      *
-     * @param yPos  The pixel's y-coordinate in the image.
+     * @param frameBuffer  Frame buffer where the pixels will be restored.
      *
-     * @return      The buffer index, or ImagePainter::invalidIndex if the
-     *              coordinates are out of bounds.
+     * @param rowBuffer    A buffer with room for one row of the area.
      */
-    size_t bufferIndex(const size_t xPos, const size_t yPos) const;
+    void restoreRows(const Rectangle& area, FrameBuffer* const frameBuffer,
+            std::vector<uint32_t>& rowBuffer);
 
     /**
-     * @brief  Checks if a coordinate is outside either the framebuffer bounds
-     *         or the image bounds.
+     * @brief  Moves a drawn opaque image by copying its pixels within the
+     *         frame buffer.
+     *
+     *  Only the strips the image uncovers are restored, and only the strips
+     * it newly covers are saved. The old and new image bounds must overlap,
+     * and both must be within the frame buffer.
+     *
+     * @param newBounds    The image bounds at its new origin.
      *
-     * @param xPos         X-coordinate of a pixel in the frameBuffer.
+     * @param frameBuffer  The frame buffer holding the drawn image.
+     */
+    void moveOpaque(const Rectangle& newBounds, FrameBuffer* const frameBuffer);
+
+    /**
+     * @brief  Moves a drawn image with transparency, only blending pixels
+     *         where the image pixel over the background has changed.
      *
-     * @param yPos         Y-coordinate of a pixel in the frameBuffer.
+     *  Saved pixels move with the image one row at a time, and pixels where
+     * the same image pixel still covers the same background are left alone,
+     * so a small move only costs about as much as the image's changed edges.
+     * The old and new image bounds must overlap, and both must be within the
+     * frame buffer.
      *
-     * @param frameBuffer  Frame buffer used to check buffer size.
+     * @param newBounds    The image bounds at its new origin.
      *
-     * @return             Whether the given coordinate is within both sets of
-     *                     bounds.
+     * @param frameBuffer  The frame buffer holding the drawn image.
      */
-    bool outOfBounds(const size_t xPos, const size_t yPos,
+    void moveBlended(const Rectangle& newBounds,
             FrameBuffer* const frameBuffer);
 
-    // Source image data:
-    std::unique_ptr<Image> image;
+    // Source image data, which may be shared with other painters:
+    std::shared_ptr<const Image> image;
+    // The painter's own prepared copy of the image, or nullptr if the source
+    // image already provides premultiplied rows and runs:
+    std::unique_ptr<PreparedImage> preparedImage;
+    // The image whose rows and runs are drawn, either the source image or
+    // preparedImage:
+    const Image* drawnImage = nullptr;
+    // The pixel format of the frame buffer being drawn:
+    PixelFormat nativeFormat = PixelFormat::Unknown;
+    // Converts colors to and from the native pixel format:
+    const PixelConverter* converter = nullptr;
     // Saved image dimensions:
     size_t imageWidth = 0;
     size_t imageHeight = 0;
     // Holds the image origin within the frame buffer:
-    size_t xOrigin = 0;
-    size_t yOrigin = 0;
+    int xOrigin = 0;
+    int yOrigin = 0;
     // Stores framebuffer pixels overwritten by the image, so that they can be
     // restored when the image is moved or cleared:
-    RGBPixel* replacedPixels = nullptr;
-    // Represents an invalid index:
-    static const size_t invalidIndex;
+    SaveUnderBuffer savedPixels;
+    // Whether every pixel in each image row is fully opaque:
+    std::vector<bool> opaqueRows;
+    // The number of image rows that aren't fully opaque. The image can only
+    // be moved by copying its pixels when this is zero:
+    size_t nonOpaqueRowCount = 0;
+    // Whether the entire image is currently drawn at its origin:
+    bool imageDrawn = false;
+    // Optional threads used to paint large areas:
+    WorkerPool* workerPool = nullptr;
+    // Holds three rows of frame buffer pixels or colors for each thread
+    // that draws:
+    std::vector<std::vector<uint32_t>> rowBuffers;
 };
 
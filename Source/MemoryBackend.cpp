@@ -0,0 +1,194 @@
+#include "MemoryBackend.h"
+#include <algorithm>
+#include <cstring>
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+
+// Maps zero-initialized memory for a virtual display.
+FBPainter::MemoryBackend::MemoryBackend(const size_t width,
+        const size_t height, const PixelFormat format, const size_t stride,
+        const size_t virtualHeight) :
+    MemoryBackend(width, height, format, stride, virtualHeight, -1, false)
+    { }
+
+
+// Maps a file as the backend's memory.
+FBPainter::MemoryBackend::MemoryBackend(const size_t width,
+        const size_t height, const PixelFormat format, const size_t stride,
+        const size_t virtualHeight, const int fileDescriptor) :
+    MemoryBackend(width, height, format, stride, virtualHeight,
+            fileDescriptor, true) { }
+
+
+// Maps either anonymous memory or a file.
+FBPainter::MemoryBackend::MemoryBackend(const size_t width,
+        const size_t height, const PixelFormat format, const size_t stride,
+        const size_t virtualHeight, const int fileDescriptor,
+        const bool fileBacked) :
+    width(width), height(height), format(format),
+    stride(std::max(stride, width * FBPainter::getBytesPerPixel(format))),
+    virtualHeight(std::max(virtualHeight, height)),
+    fileDescriptor(fileDescriptor), fileBacked(fileBacked)
+{
+    if (fileBacked && fileDescriptor == -1)
+    {
+        // The file couldn't be opened, and silently falling back to anonymous
+        // memory would hide that nothing reaches the file:
+        return;
+    }
+    if (width == 0 || height == 0 || format == PixelFormat::Unknown)
+    {
+        fprintf(stderr, "Invalid memory frame buffer geometry\n");
+        return;
+    }
+    data = mapMemory();
+}
+
+
+// Unmaps all memory on destruction.
+FBPainter::MemoryBackend::~MemoryBackend()
+{
+    if (data != nullptr)
+    {
+        munmap(data, virtualHeight * stride);
+        data = nullptr;
+    }
+    if (fileDescriptor != -1)
+    {
+        close(fileDescriptor);
+        fileDescriptor = -1;
+    }
+}
+
+
+// Checks if the backend's memory is mapped.
+bool FBPainter::MemoryBackend::isOpen() const
+{
+    return data != nullptr;
+}
+
+
+// Gets the width of each display page.
+size_t FBPainter::MemoryBackend::getWidth() const
+{
+    return width;
+}
+
+
+// Gets the height of each display page.
+size_t FBPainter::MemoryBackend::getHeight() const
+{
+    return height;
+}
+
+
+// Gets the total height of all display pages.
+size_t FBPainter::MemoryBackend::getVirtualHeight() const
+{
+    return virtualHeight;
+}
+
+
+// Gets the number of bytes between the start of each row.
+size_t FBPainter::MemoryBackend::getStride() const
+{
+    return stride;
+}
+
+
+// Gets the pixel format selected on construction.
+FBPainter::PixelFormat FBPainter::MemoryBackend::getPixelFormat() const
+{
+    return format;
+}
+
+
+// Gets the address of the top left pixel of the first display page.
+uint8_t* FBPainter::MemoryBackend::getData() const
+{
+    return data;
+}
+
+
+// Gets the y-offset of the visible display page.
+size_t FBPainter::MemoryBackend::getYOffset() const
+{
+    return yOffset;
+}
+
+
+// Remaps the backend's memory with a new virtual height.
+bool FBPainter::MemoryBackend::setVirtualHeight(const size_t newHeight)
+{
+    if (data == nullptr || newHeight < height || newHeight == virtualHeight)
+    {
+        return false;
+    }
+    uint8_t* const oldData = data;
+    const size_t oldHeight = virtualHeight;
+    if (fileBacked)
+    {
+        // File mappings can't be copied into a new mapping of the same file,
+        // so unmap first and let the file preserve the contents:
+        munmap(oldData, oldHeight * stride);
+        virtualHeight = newHeight;
+        yOffset = 0;
+        data = mapMemory();
+        return data != nullptr;
+    }
+    virtualHeight = newHeight;
+    data = mapMemory();
+    if (data == nullptr)
+    {
+        data = oldData;
+        virtualHeight = oldHeight;
+        return false;
+    }
+    memcpy(data, oldData, std::min(oldHeight, newHeight) * stride);
+    munmap(oldData, oldHeight * stride);
+    yOffset = 0;
+    return true;
+}
+
+
+// Records which rows are visible.
+bool FBPainter::MemoryBackend::panTo(const size_t newOffset)
+{
+    if (newOffset + height > virtualHeight)
+    {
+        return false;
+    }
+    yOffset = newOffset;
+    return true;
+}
+
+
+// Maps memory for the current virtual height.
+uint8_t* FBPainter::MemoryBackend::mapMemory()
+{
+    const size_t size = virtualHeight * stride;
+    void* mapped;
+    if (! fileBacked)
+    {
+        mapped = mmap(0, size, PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    }
+    else
+    {
+        if (ftruncate(fileDescriptor, size) == -1)
+        {
+            perror("Failed to resize frame buffer file");
+            return nullptr;
+        }
+        mapped = mmap(0, size, PROT_READ | PROT_WRITE, MAP_SHARED,
+                fileDescriptor, 0);
+    }
+    if (mapped == MAP_FAILED)
+    {
+        perror("Failed to map frame buffer memory");
+        return nullptr;
+    }
+    return static_cast<uint8_t*>(mapped);
+}
@@ -0,0 +1,205 @@
+/**
+ * @file  MemoryBackend.h
+ *
+ * @brief  Provides FrameBuffer memory that isn't connected to a display, for
+ *         headless rendering, testing, and benchmarking.
+ */
+
+#pragma once
+#include "FrameBufferBackend.h"
+
+namespace FBPainter
+{
+    class MemoryBackend;
+}
+
+/**
+ * @brief  Maps anonymous memory with a configurable resolution, stride, and
+ *         pixel format.
+ *
+ *  Memory is mapped with mmap just like a frame buffer device, so
+ * FrameBuffer uses the same code paths with either backend.
+ */
+class FBPainter::MemoryBackend : public FrameBufferBackend
+{
+public:
+    /**
+     * @brief  Maps zero-initialized memory for a virtual display.
+     *
+     * @param width          The display width in pixels.
+     *
+     * @param height         The display height in pixels.
+     *
+     * @param format         The pixel format to use.
+     *
+     * @param stride         The number of bytes between the start of each
+     *                       row, or zero to pack rows tightly.
+     *
+     * @param virtualHeight  The total height of all display pages, or zero
+     *                       to allocate a single page.
+     */
+    MemoryBackend(const size_t width, const size_t height,
+            const PixelFormat format = PixelFormat::XRGB8888,
+            const size_t stride = 0, const size_t virtualHeight = 0);
+
+    /**
+     * @brief  Unmaps all memory on destruction.
+     */
+    virtual ~MemoryBackend();
+
+    /**
+     * @brief  Checks if the backend's memory is mapped.
+     *
+     * @return  Whether the backend is ready for IO.
+     */
+    bool isOpen() const override;
+
+    /**
+     * @brief  Gets the width of each display page.
+     *
+     * @return  The page width in pixels.
+     */
+    size_t getWidth() const override;
+
+    /**
+     * @brief  Gets the height of each display page.
+     *
+     * @return  The page height in pixels.
+     */
+    size_t getHeight() const override;
+
+    /**
+     * @brief  Gets the total height of all display pages.
+     *
+     * @return  The virtual height in pixels.
+     */
+    size_t getVirtualHeight() const override;
+
+    /**
+     * @brief  Gets the number of bytes between the start of each row.
+     *
+     * @return  The row stride in bytes.
+     */
+    size_t getStride() const override;
+
+    /**
+     * @brief  Gets the pixel format selected on construction.
+     *
+     * @return  The backend's pixel format.
+     */
+    PixelFormat getPixelFormat() const override;
+
+    /**
+     * @brief  Gets the address of the top left pixel of the first display
+     *         page.
+     *
+     * @return  The start of the mapped memory, or nullptr if mapping failed.
+     */
+    uint8_t* getData() const override;
+
+    /**
+     * @brief  Gets the y-offset of the visible display page.
+     *
+     * @return  The y-offset most recently passed to panTo.
+     */
+    size_t getYOffset() const override;
+
+    /**
+     * @brief  Remaps the backend's memory with a new virtual height.
+     *
+     *  Existing rows that fit within the new virtual height are preserved.
+     *
+     * @param virtualHeight  The new virtual height, which must be at least
+     *                       the display height.
+     *
+     * @return               Whether the virtual height changed.
+     */
+    bool setVirtualHeight(const size_t virtualHeight) override;
+
+    /**
+     * @brief  Records which rows are visible.
+     *
+     * @param yOffset  The new y-offset of the visible display page.
+     *
+     * @return         Whether the offset leaves room for a full page within
+     *                 the virtual height.
+     */
+    bool panTo(const size_t yOffset) override;
+
+    /**
+     * @brief  Returns immediately, as there is no display to wait for.
+     */
+    void waitForVSync() override { }
+
+protected:
+    /**
+     * @brief  Maps a file as the backend's memory.
+     *
+     * @param width          The display width in pixels.
+     *
+     * @param height         The display height in pixels.
+     *
+     * @param format         The pixel format to use.
+     *
+     * @param stride         The number of bytes between the start of each
+     *                       row, or zero to pack rows tightly.
+     *
+     * @param virtualHeight  The total height of all display pages, or zero
+     *                       to allocate a single page.
+     *
+     * @param fileDescriptor An open, writable file descriptor that the
+     *                       backend will take ownership of, or -1 if the
+     *                       file couldn't be opened. Nothing is mapped
+     *                       without a file, so the backend won't be open.
+     */
+    MemoryBackend(const size_t width, const size_t height,
+            const PixelFormat format, const size_t stride,
+            const size_t virtualHeight, const int fileDescriptor);
+
+private:
+    /**
+     * @brief  Maps either anonymous memory or a file.
+     *
+     * @param width          The display width in pixels.
+     *
+     * @param height         The display height in pixels.
+     *
+     * @param format         The pixel format to use.
+     *
+     * @param stride         The number of bytes between the start of each
+     *                       row, or zero to pack rows tightly.
+     *
+     * @param virtualHeight  The total height of all display pages, or zero
+     *                       to allocate a single page.
+     *
+     * @param fileDescriptor The file to map, or -1 if there is no file.
+     *
+     * @param fileBacked     Whether memory should map a file instead of
+     *                       anonymous memory.
+     */
+    MemoryBackend(const size_t width, const size_t height,
+            const PixelFormat format, const size_t stride,
+            const size_t virtualHeight, const int fileDescriptor,
+            const bool fileBacked);
+
+    /**
+     * @brief  Maps memory for the current virtual height.
+     *
+     * @return  The mapped memory, or nullptr if mapping failed.
+     */
+    uint8_t* mapMemory();
+
+    // Display geometry:
+    const size_t width;
+    const size_t height;
+    const PixelFormat format;
+    const size_t stride;
+    size_t virtualHeight;
+    size_t yOffset = 0;
+
+    // Mapped memory, and the file it maps if not anonymous:
+    uint8_t* data = nullptr;
+    int fileDescriptor = -1;
+    // Whether memory maps a file, even if the file couldn't be opened:
+    const bool fileBacked;
+};
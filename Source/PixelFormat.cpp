@@ -0,0 +1,51 @@
+#include "PixelFormat.h"
+
+
+// Gets the number of bytes used to store each pixel in a format.
+size_t FBPainter::getBytesPerPixel(const PixelFormat format)
+{
+    switch (format)
+    {
+        case PixelFormat::RGB565:
+            return sizeof(PixelTraits<PixelFormat::RGB565>::Storage);
+        case PixelFormat::RGB888:
+            return sizeof(PixelTraits<PixelFormat::RGB888>::Storage);
+        case PixelFormat::XRGB8888:
+            return sizeof(PixelTraits<PixelFormat::XRGB8888>::Storage);
+        case PixelFormat::XBGR8888:
+            return sizeof(PixelTraits<PixelFormat::XBGR8888>::Storage);
+        case PixelFormat::BGRA8888:
+            return sizeof(PixelTraits<PixelFormat::BGRA8888>::Storage);
+        case PixelFormat::Unknown:
+            break;
+    }
+    return 0;
+}
+
+
+// Gets the converter used for a specific pixel format.
+const FBPainter::PixelConverter* FBPainter::PixelConverter::forFormat
+(const PixelFormat format)
+{
+    static const FormatConverter<PixelFormat::RGB565> rgb565;
+    static const FormatConverter<PixelFormat::RGB888> rgb888;
+    static const FormatConverter<PixelFormat::XRGB8888> xrgb8888;
+    static const FormatConverter<PixelFormat::XBGR8888> xbgr8888;
+    static const FormatConverter<PixelFormat::BGRA8888> bgra8888;
+    switch (format)
+    {
+        case PixelFormat::RGB565:
+            return &rgb565;
+        case PixelFormat::RGB888:
+            return &rgb888;
+        case PixelFormat::XRGB8888:
+            return &xrgb8888;
+        case PixelFormat::XBGR8888:
+            return &xbgr8888;
+        case PixelFormat::BGRA8888:
+            return &bgra8888;
+        case PixelFormat::Unknown:
+            break;
+    }
+    return nullptr;
+}
@@ -0,0 +1,325 @@
+/**
+ * @file  PixelFormat.h
+ *
+ * @brief  Defines the pixel layouts FBPainter can read and write, and the
+ *         compile-time specialized conversions between them.
+ */
+
+#pragma once
+#include "FillKernels.h"
+#include <stdint.h>
+#include <stddef.h>
+#include <algorithm>
+#include <cstring>
+
+namespace FBPainter
+{
+    /**
+     * @brief  Pixel layouts used by frame buffers.
+     *
+     *  Layouts are named from the most significant to the least significant
+     * bits of each pixel value, which is stored in native (little-endian)
+     * byte order.
+     */
+    enum class PixelFormat
+    {
+        // An unsupported or undetected pixel layout:
+        Unknown,
+        // 16-bit pixels: 5 bits red, 6 bits green, 5 bits blue.
+        RGB565,
+        // 24-bit pixels: 8 bits each of red, green, and blue.
+        RGB888,
+        // 32-bit pixels: 8 unused bits, then red, green, and blue.
+        XRGB8888,
+        // 32-bit pixels: 8 unused bits, then blue, green, and red.
+        XBGR8888,
+        // 32-bit pixels: blue, green, and red, then 8 unused bits.
+        BGRA8888
+    };
+
+    template <PixelFormat format> struct PixelTraits;
+    template <PixelFormat format> class FormatConverter;
+    class PixelConverter;
+
+    /**
+     * @brief  Gets the number of bytes used to store each pixel in a format.
+     *
+     * @param format  A pixel format.
+     *
+     * @return        The size of one pixel in bytes, or zero if the format is
+     *                unknown.
+     */
+    size_t getBytesPerPixel(const PixelFormat format);
+}
+
+
+/**
+ * @brief  Converts 0x00RRGGBB color values to and from a specific pixel
+ *         format.
+ *
+ *  Each specialization defines the Storage type used to hold one pixel in
+ * memory, along with inline pack and unpack functions. All shift amounts are
+ * compile-time constants, so loops over these functions are free to be
+ * vectorized by the compiler. Pack functions ignore the highest byte of each
+ * color, so opaque premultiplied 0xFFRRGGBB pixels can be packed directly.
+ */
+template <FBPainter::PixelFormat format>
+struct FBPainter::PixelTraits { };
+
+
+template <>
+struct FBPainter::PixelTraits<FBPainter::PixelFormat::RGB565>
+{
+    typedef uint16_t Storage;
+
+    static inline Storage pack(const uint32_t rgb)
+    {
+        return ((rgb >> 8) & 0xf800) | ((rgb >> 5) & 0x07e0)
+                | ((rgb >> 3) & 0x001f);
+    }
+
+    static inline uint32_t unpack(const Storage value)
+    {
+        const uint32_t red = (value >> 11) & 0x1f;
+        const uint32_t green = (value >> 5) & 0x3f;
+        const uint32_t blue = value & 0x1f;
+        return (((red << 3) | (red >> 2)) << 16)
+                | (((green << 2) | (green >> 4)) << 8)
+                | ((blue << 3) | (blue >> 2));
+    }
+};
+
+
+template <>
+struct FBPainter::PixelTraits<FBPainter::PixelFormat::RGB888>
+{
+    struct Storage
+    {
+        uint8_t blue;
+        uint8_t green;
+        uint8_t red;
+    } __attribute__((packed));
+
+    static inline Storage pack(const uint32_t rgb)
+    {
+        return { (uint8_t) rgb, (uint8_t) (rgb >> 8), (uint8_t) (rgb >> 16) };
+    }
+
+    static inline uint32_t unpack(const Storage value)
+    {
+        return (value.red << 16) | (value.green << 8) | value.blue;
+    }
+};
+
+
+template <>
+struct FBPainter::PixelTraits<FBPainter::PixelFormat::XRGB8888>
+{
+    typedef uint32_t Storage;
+
+    static inline Storage pack(const uint32_t rgb)
+    {
+        return rgb & 0xffffff;
+    }
+
+    static inline uint32_t unpack(const Storage value)
+    {
+        return value & 0xffffff;
+    }
+};
+
+
+template <>
+struct FBPainter::PixelTraits<FBPainter::PixelFormat::XBGR8888>
+{
+    typedef uint32_t Storage;
+
+    static inline Storage pack(const uint32_t rgb)
+    {
+        return ((rgb & 0xff) << 16) | (rgb & 0xff00) | ((rgb >> 16) & 0xff);
+    }
+
+    static inline uint32_t unpack(const Storage value)
+    {
+        return pack(value);
+    }
+};
+
+
+template <>
+struct FBPainter::PixelTraits<FBPainter::PixelFormat::BGRA8888>
+{
+    typedef uint32_t Storage;
+
+    static inline Storage pack(const uint32_t rgb)
+    {
+        return __builtin_bswap32(rgb & 0xffffff);
+    }
+
+    static inline uint32_t unpack(const Storage value)
+    {
+        return __builtin_bswap32(value) & 0xffffff;
+    }
+};
+
+
+/**
+ * @brief  Converts spans of pixels between 0x00RRGGBB color values and a
+ *         frame buffer's pixel format.
+ *
+ *  A PixelConverter is selected once when a frame buffer is opened, so the
+ * cost of choosing a pixel format is paid once per span instead of once per
+ * pixel.
+ */
+class FBPainter::PixelConverter
+{
+public:
+    virtual ~PixelConverter() { }
+
+    /**
+     * @brief  Gets the converter used for a specific pixel format.
+     *
+     * @param format  A pixel format.
+     *
+     * @return        The shared converter for that format, or nullptr if the
+     *                format is unknown.
+     */
+    static const PixelConverter* forFormat(const PixelFormat format);
+
+    /**
+     * @brief  Gets the pixel format handled by this converter.
+     *
+     * @return  The converter's pixel format.
+     */
+    virtual PixelFormat getFormat() const = 0;
+
+    /**
+     * @brief  Converts one 0x00RRGGBB color to this converter's format.
+     *
+     * @param rgb  The color value to convert. Its highest byte is ignored.
+     *
+     * @return     The converted pixel value, stored in the lowest bits.
+     */
+    virtual uint32_t packColor(const uint32_t rgb) const = 0;
+
+    /**
+     * @brief  Converts one pixel value in this converter's format to a
+     *         0x00RRGGBB color.
+     *
+     * @param value  A pixel value, stored in the lowest bits.
+     *
+     * @return       The equivalent color value.
+     */
+    virtual uint32_t unpackColor(const uint32_t value) const = 0;
+
+    /**
+     * @brief  Converts a span of 0x00RRGGBB colors to this converter's format.
+     *
+     * @param source  The color values to convert. The highest byte of each
+     *                value is ignored.
+     *
+     * @param dest    Memory where count pixels of converted data will be
+     *                written. This doesn't need to be aligned to the pixel
+     *                size.
+     *
+     * @param count   The number of pixels to convert.
+     */
+    virtual void packSpan(const uint32_t* source, void* dest,
+            const size_t count) const = 0;
+
+    /**
+     * @brief  Converts a span of pixels in this converter's format to
+     *         0x00RRGGBB colors.
+     *
+     * @param source  Memory holding count pixels to convert. This doesn't
+     *                need to be aligned to the pixel size.
+     *
+     * @param dest    An array where count color values will be written.
+     *
+     * @param count   The number of pixels to convert.
+     */
+    virtual void unpackSpan(const void* source, uint32_t* dest,
+            const size_t count) const = 0;
+
+    /**
+     * @brief  Sets every pixel in a span to a single color.
+     *
+     * @param dest   Memory holding count pixels to update.
+     *
+     * @param value  A pixel value in this converter's format, created with
+     *               packColor.
+     *
+     * @param count  The number of pixels to update.
+     */
+    virtual void fillSpan(void* dest, const uint32_t value,
+            const size_t count) const = 0;
+};
+
+
+/**
+ * @brief  Implements the PixelConverter interface for a single pixel format.
+ *
+ * @tparam format  The pixel format to convert to and from.
+ */
+template <FBPainter::PixelFormat format>
+class FBPainter::FormatConverter : public PixelConverter
+{
+public:
+    typedef PixelTraits<format> Traits;
+    typedef typename Traits::Storage Storage;
+
+    virtual ~FormatConverter() { }
+
+    PixelFormat getFormat() const override
+    {
+        return format;
+    }
+
+    uint32_t packColor(const uint32_t rgb) const override
+    {
+        const Storage packed = Traits::pack(rgb);
+        uint32_t value = 0;
+        std::copy_n(reinterpret_cast<const uint8_t*>(&packed),
+                sizeof(Storage), reinterpret_cast<uint8_t*>(&value));
+        return value;
+    }
+
+    uint32_t unpackColor(const uint32_t value) const override
+    {
+        Storage packed;
+        std::copy_n(reinterpret_cast<const uint8_t*>(&value),
+                sizeof(Storage), reinterpret_cast<uint8_t*>(&packed));
+        return Traits::unpack(packed);
+    }
+
+    void packSpan(const uint32_t* source, void* dest, const size_t count)
+            const override
+    {
+        // Frame buffer rows may place pixels at any byte offset, so pixels
+        // are copied as bytes rather than stored through a Storage pointer:
+        uint8_t* destBytes = static_cast<uint8_t*>(dest);
+        for (size_t i = 0; i < count; i++)
+        {
+            const Storage packed = Traits::pack(source[i]);
+            memcpy(destBytes + i * sizeof(Storage), &packed, sizeof(Storage));
+        }
+    }
+
+    void unpackSpan(const void* source, uint32_t* dest, const size_t count)
+            const override
+    {
+        const uint8_t* sourceBytes = static_cast<const uint8_t*>(source);
+        for (size_t i = 0; i < count; i++)
+        {
+            Storage packed;
+            memcpy(&packed, sourceBytes + i * sizeof(Storage), sizeof(Storage));
+            dest[i] = Traits::unpack(packed);
+        }
+    }
+
+    void fillSpan(void* dest, const uint32_t value, const size_t count)
+            const override
+    {
+        fillPixels(dest, value, sizeof(Storage), count);
+    }
+};
@@ -0,0 +1,44 @@
+/**
+ * @file  PixelRun.h
+ *
+ * @brief  Describes runs of image pixels within a row that are all drawn the
+ *         same way.
+ */
+
+#pragma once
+#include <stdint.h>
+
+namespace FBPainter
+{
+    /**
+     * @brief  Describes how a run of pixels covers the background.
+     */
+    enum class RunType : uint32_t
+    {
+        // Every pixel in the run has zero alpha, so it only shows the
+        // background:
+        Transparent = 0,
+        // Every pixel in the run is fully opaque, so it hides the background:
+        Opaque = 1,
+        // Every pixel in the run is partially transparent, so it's blended
+        // over the background:
+        Blended = 2
+    };
+
+    /**
+     * @brief  A run of consecutive pixels within one image row that all have
+     *         the same RunType.
+     *
+     *  Raw image files store their runs in this exact layout, so images can
+     * share them straight from the mapped file.
+     */
+    struct PixelRun
+    {
+        // The x-coordinate of the first pixel in the run:
+        uint32_t start;
+        // The number of pixels in the run:
+        uint32_t length;
+        // The RunType of every pixel in the run:
+        RunType type;
+    };
+}
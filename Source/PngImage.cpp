@@ -44,3 +44,16 @@ FBPainter::RGBAPixel FBPainter::PngImage::getRGBAPixel
     const png::rgba_pixel px = sourceImage.get_pixel(xPos, yPos);
     return RGBAPixel(px.red, px.green, px.blue, px.alpha);
 }
+
+
+// Gets direct access to one row of image pixels.
+const uint8_t* FBPainter::PngImage::getRowData(const size_t yPos) const
+{
+    if (yPos >= getHeight())
+    {
+        return nullptr;
+    }
+    static_assert(sizeof(RGBApng) == 4, "PNG pixels must be packed RGBA bytes");
+    return reinterpret_cast<const uint8_t*>(
+            sourceImage.get_pixbuf().get_row(yPos));
+}
@@ -67,6 +67,19 @@ public:
      */
     RGBAPixel getRGBAPixel(const size_t xPos, const size_t yPos) const override;
 
+    /**
+     * @brief  Gets direct access to one row of image pixels.
+     *
+     *  Decoded pixels are stored contiguously as red, green, blue, and alpha
+     * bytes, so rows are read without copying or converting each pixel.
+     *
+     * @param yPos  The y-coordinate of the row.
+     *
+     * @return      The row's pixels as red, green, blue, and alpha bytes, or
+     *              nullptr if the row is out of bounds.
+     */
+    const uint8_t* getRowData(const size_t yPos) const override;
+
 private:
     typedef png::rgba_pixel RGBApng;
     // Image type used to store the source image:
@@ -0,0 +1,304 @@
+#include "PngStream.h"
+#include "DrawContext.h"
+#include "FrameBuffer.h"
+#include "PixelFormat.h"
+#include "BlendKernels.h"
+#include <algorithm>
+#include <fcntl.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <new>
+
+// Number of bytes read from a file in each chunk:
+static const constexpr size_t fileChunkSize = 16 * 1024;
+
+// Prepares to decode PNG data, passing each decoded row to a handler
+// function.
+FBPainter::PngStream::PngStream(const RowHandler& handler,
+        const RowFormat format) : handler(handler), rowFormat(format)
+{
+    initDecoder();
+}
+
+
+// Prepares to decode PNG data straight into a frame buffer.
+FBPainter::PngStream::PngStream(DrawContext& context, const int xPos,
+        const int yPos) :
+    rowFormat(RowFormat::PremultipliedARGB), context(&context), xOrigin(xPos),
+    yOrigin(yPos)
+{
+    handler = [this](const size_t yPos, const uint32_t* pixels)
+    {
+        drawRow(yPos, pixels);
+    };
+    initDecoder();
+}
+
+
+// Releases libpng decoder data on destruction.
+FBPainter::PngStream::~PngStream()
+{
+    if (pngData != nullptr)
+    {
+        png_destroy_read_struct(&pngData, &pngInfo, nullptr);
+    }
+}
+
+
+// Creates the libpng decoder, and sets the functions it calls as data is
+// decoded.
+void FBPainter::PngStream::initDecoder()
+{
+    pngData = png_create_read_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr,
+            nullptr);
+    if (pngData != nullptr)
+    {
+        pngInfo = png_create_info_struct(pngData);
+    }
+    if (pngInfo == nullptr)
+    {
+        failed = true;
+        return;
+    }
+    png_set_progressive_read_fn(pngData, this, headerCallback, rowCallback,
+            endCallback);
+}
+
+
+// Decodes a chunk of PNG data, handling every row it completes.
+bool FBPainter::PngStream::write(const void* data, const size_t size)
+{
+    if (failed || finished)
+    {
+        return ! failed;
+    }
+    // libpng returns here if the data is invalid. No objects with
+    // destructors are created between here and the libpng call, so none are
+    // skipped:
+    if (setjmp(png_jmpbuf(pngData)))
+    {
+        failed = true;
+        return false;
+    }
+    png_process_data(pngData, pngInfo,
+            static_cast<png_bytep>(const_cast<void*>(data)), size);
+    return ! failed;
+}
+
+
+// Decodes a PNG file, reading it in small chunks.
+bool FBPainter::PngStream::readFile(const char* path)
+{
+    const int fileDescriptor = open(path, O_RDONLY);
+    if (fileDescriptor == -1)
+    {
+        perror("Opening PNG file failed");
+        return false;
+    }
+    uint8_t chunk[fileChunkSize];
+    ssize_t bytesRead;
+    while (! finished && ! failed
+            && (bytesRead = read(fileDescriptor, chunk, fileChunkSize)) > 0)
+    {
+        write(chunk, bytesRead);
+    }
+    close(fileDescriptor);
+    return finished && ! failed;
+}
+
+
+// Checks if the whole image has been decoded.
+bool FBPainter::PngStream::isFinished() const
+{
+    return finished;
+}
+
+
+// Checks if decoding has failed.
+bool FBPainter::PngStream::hasFailed() const
+{
+    return failed;
+}
+
+
+// Gets the width of the image.
+size_t FBPainter::PngStream::getWidth() const
+{
+    return width;
+}
+
+
+// Gets the height of the image.
+size_t FBPainter::PngStream::getHeight() const
+{
+    return height;
+}
+
+
+// Selects libpng transformations once the image header is read, and
+// allocates row storage.
+void FBPainter::PngStream::headerCallback(png_structp pngData,
+        png_infop pngInfo)
+{
+    PngStream* const stream
+            = static_cast<PngStream*>(png_get_progressive_ptr(pngData));
+    // Expand every image to 8-bit components, with an alpha component
+    // following blue, green, and red. In native little-endian order, each
+    // decoded pixel is then a 0xAARRGGBB value:
+    png_set_expand(pngData);
+    png_set_strip_16(pngData);
+    png_set_gray_to_rgb(pngData);
+    png_set_add_alpha(pngData, 0xff, PNG_FILLER_AFTER);
+    png_set_bgr(pngData);
+    const int passes = png_set_interlace_handling(pngData);
+    png_read_update_info(pngData, pngInfo);
+
+    stream->width = png_get_image_width(pngData, pngInfo);
+    stream->height = png_get_image_height(pngData, pngInfo);
+    stream->interlaced = passes > 1;
+    if (png_get_rowbytes(pngData, pngInfo)
+            != stream->width * sizeof(uint32_t))
+    {
+        stream->failed = true;
+        return;
+    }
+    if (stream->context != nullptr)
+    {
+        const FrameBuffer* const frameBuffer
+                = stream->context->getFrameBuffer();
+        stream->converter = (frameBuffer != nullptr)
+                ? PixelConverter::forFormat(frameBuffer->getPixelFormat())
+                : nullptr;
+        if (stream->converter == nullptr)
+        {
+            stream->failed = true;
+            return;
+        }
+    }
+    try
+    {
+        stream->rowPixels.resize(stream->width);
+        if (stream->interlaced)
+        {
+            // Interlaced passes are combined with the rows decoded by
+            // earlier passes, so all rows must be kept:
+            stream->imagePixels.resize(stream->width * stream->height);
+        }
+        if (stream->context != nullptr)
+        {
+            stream->drawBuffer.resize(stream->width * 2);
+        }
+    }
+    catch (const std::bad_alloc&)
+    {
+        stream->failed = true;
+    }
+}
+
+
+// Handles a decoded row, or stores it until the image is complete if the
+// image is interlaced.
+void FBPainter::PngStream::rowCallback(png_structp pngData, png_bytep row,
+        png_uint_32 yPos, int /* pass */)
+{
+    PngStream* const stream
+            = static_cast<PngStream*>(png_get_progressive_ptr(pngData));
+    if (stream->failed || row == nullptr || yPos >= stream->height)
+    {
+        return;
+    }
+    if (stream->interlaced)
+    {
+        png_progressive_combine_row(pngData, reinterpret_cast<png_bytep>(
+                stream->imagePixels.data() + yPos * stream->width), row);
+        return;
+    }
+    std::copy(row, row + stream->width * sizeof(uint32_t),
+            reinterpret_cast<uint8_t*>(stream->rowPixels.data()));
+    stream->handleRow(yPos, stream->rowPixels.data());
+}
+
+
+// Handles stored interlaced rows once the image is complete.
+void FBPainter::PngStream::endCallback(png_structp pngData,
+        png_infop /* pngInfo */)
+{
+    PngStream* const stream
+            = static_cast<PngStream*>(png_get_progressive_ptr(pngData));
+    if (stream->failed)
+    {
+        return;
+    }
+    if (stream->interlaced)
+    {
+        for (size_t y = 0; y < stream->height; y++)
+        {
+            const uint32_t* row = stream->imagePixels.data()
+                    + y * stream->width;
+            std::copy(row, row + stream->width, stream->rowPixels.data());
+            stream->handleRow(y, stream->rowPixels.data());
+        }
+        stream->imagePixels.clear();
+        stream->imagePixels.shrink_to_fit();
+    }
+    stream->finished = true;
+}
+
+
+// Converts one decoded row to the stream's row format, and passes it to the
+// row handler.
+void FBPainter::PngStream::handleRow(const size_t yPos, const uint32_t* pixels)
+{
+    if (rowFormat == RowFormat::PremultipliedARGB)
+    {
+        uint32_t* const row = rowPixels.data();
+        for (size_t x = 0; x < width; x++)
+        {
+            const uint32_t pixel = pixels[x];
+            row[x] = premultiplyColor(pixel >> 16, pixel >> 8, pixel,
+                    pixel >> 24);
+        }
+        pixels = row;
+    }
+    handler(yPos, pixels);
+}
+
+
+// Blends one premultiplied row into the draw context's frame buffer.
+void FBPainter::PngStream::drawRow(const size_t yPos, const uint32_t* pixels)
+{
+    const int bufferY = yOrigin + static_cast<int>(yPos);
+    const Rectangle span = context->getClip().getIntersection(
+            Rectangle(xOrigin, bufferY, width, 1));
+    if (span.isEmpty())
+    {
+        return;
+    }
+    const size_t count = span.getWidth();
+    const uint32_t* const source = pixels + (span.getLeft() - xOrigin);
+    // The draw buffer holds native frame buffer pixels, then colors:
+    void* const nativeRow = drawBuffer.data();
+    uint32_t* const colors = drawBuffer.data() + width;
+    const bool opaque = std::all_of(source, source + count,
+            [](const uint32_t pixel)
+            {
+                return (pixel >> 24) == 0xff;
+            });
+    if (opaque)
+    {
+        // Opaque premultiplied pixels already hold their final colors:
+        std::transform(source, source + count, colors,
+                [](const uint32_t pixel)
+                {
+                    return pixel & 0xffffff;
+                });
+    }
+    else
+    {
+        context->readSpan(span.getLeft(), bufferY, nativeRow, count);
+        converter->unpackSpan(nativeRow, colors, count);
+        blendSpan(source, colors, count);
+    }
+    converter->packSpan(colors, nativeRow, count);
+    context->writeSpan(span.getLeft(), bufferY, nativeRow, count);
+}
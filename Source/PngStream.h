@@ -0,0 +1,228 @@
+/**
+ * @file  PngStream.h
+ *
+ * @brief  Decodes PNG data one row at a time as it arrives, without keeping
+ *         the decoded image.
+ */
+
+#pragma once
+#ifndef USE_PNG
+    #error "FBPainter::PngStream class included, but libpng support is disabled."
+#endif
+#include "Image.h"
+#include <png.h>
+#include <functional>
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+namespace FBPainter
+{
+    class PngStream;
+    class DrawContext;
+    class PixelConverter;
+}
+
+/**
+ * @brief  Decodes PNG data incrementally using libpng's progressive reader,
+ *         passing each decoded row on as soon as it's complete.
+ *
+ *  Data can be written to the stream in chunks of any size. Every image
+ * is expanded to 8-bit RGBA, converted to the requested row format, and
+ * passed to a row handler in a single reused row buffer, so only one row of
+ * decoded pixels is held at a time. Interlaced images are the exception: as
+ * their rows are only complete after the final pass, the whole image is
+ * held until decoding finishes.
+ *
+ *  A stream may also draw straight into a frame buffer, blending each row
+ * over the frame buffer's pixels and converting it to the frame buffer's
+ * pixel format as it's decoded. This gives the first pixels on screen sooner
+ * than loading a PngImage, with much lower peak memory use:
+ *
+ *      FBPainter::DrawContext context(&frameBuffer);
+ *      FBPainter::PngStream stream(context, 0, 0);
+ *      stream.readFile("background.png");
+ */
+class FBPainter::PngStream
+{
+public:
+    /**
+     * @brief  A function called with each decoded row.
+     *
+     * @param yPos    The y-coordinate of the row within the image.
+     *
+     * @param pixels  The row's pixels in the stream's row format. The buffer
+     *                is reused for the next row, so it must not be kept.
+     */
+    typedef std::function<void(const size_t yPos, const uint32_t* pixels)>
+            RowHandler;
+
+    /**
+     * @brief  Prepares to decode PNG data, passing each decoded row to a
+     *         handler function.
+     *
+     * @param handler  The function that receives each decoded row.
+     *
+     * @param format   The layout of the pixel values passed to the handler.
+     */
+    PngStream(const RowHandler& handler,
+            const RowFormat format = RowFormat::PremultipliedARGB);
+
+    /**
+     * @brief  Prepares to decode PNG data straight into a frame buffer.
+     *
+     * @param context  The draw context used to draw each row within its
+     *                 clipping rectangle. The context must remain valid while
+     *                 the stream is in use. If it has no frame buffer, the
+     *                 stream fails once the image header is read.
+     *
+     * @param xPos     The frame buffer x-coordinate of the image's left edge.
+     *
+     * @param yPos     The frame buffer y-coordinate of the image's top edge.
+     */
+    PngStream(DrawContext& context, const int xPos, const int yPos);
+
+    /**
+     * @brief  Releases libpng decoder data on destruction.
+     */
+    virtual ~PngStream();
+
+    /**
+     * @brief  Decodes a chunk of PNG data, handling every row it completes.
+     *
+     * @param data  The next part of the PNG file data.
+     *
+     * @param size  The number of bytes of data.
+     *
+     * @return      False if the data is invalid, or decoding has already
+     *              failed, true otherwise.
+     */
+    bool write(const void* data, const size_t size);
+
+    /**
+     * @brief  Decodes a PNG file, reading it in small chunks.
+     *
+     * @param path  The path to a PNG image file.
+     *
+     * @return      Whether the whole image was decoded.
+     */
+    bool readFile(const char* path);
+
+    /**
+     * @brief  Checks if the whole image has been decoded.
+     *
+     * @return  Whether every image row has been handled.
+     */
+    bool isFinished() const;
+
+    /**
+     * @brief  Checks if decoding has failed.
+     *
+     * @return  Whether invalid data was found, or memory couldn't be
+     *          allocated. Once failed, the stream ignores all further data.
+     */
+    bool hasFailed() const;
+
+    /**
+     * @brief  Gets the width of the image.
+     *
+     * @return  The image width in pixels, or zero if the image header hasn't
+     *          been decoded yet.
+     */
+    size_t getWidth() const;
+
+    /**
+     * @brief  Gets the height of the image.
+     *
+     * @return  The image height in pixels, or zero if the image header hasn't
+     *          been decoded yet.
+     */
+    size_t getHeight() const;
+
+private:
+    /**
+     * @brief  Creates the libpng decoder, and sets the functions it calls as
+     *         data is decoded.
+     */
+    void initDecoder();
+
+    /**
+     * @brief  Selects libpng transformations once the image header is read,
+     *         and allocates row storage.
+     *
+     * @param pngData  The libpng decoder.
+     *
+     * @param pngInfo  The libpng image information.
+     */
+    static void headerCallback(png_structp pngData, png_infop pngInfo);
+
+    /**
+     * @brief  Handles a decoded row, or stores it until the image is
+     *         complete if the image is interlaced.
+     *
+     * @param pngData  The libpng decoder.
+     *
+     * @param row      The decoded row data, or nullptr if the current
+     *                 interlace pass doesn't change the row.
+     *
+     * @param yPos     The y-coordinate of the row.
+     *
+     * @param pass     The current interlace pass.
+     */
+    static void rowCallback(png_structp pngData, png_bytep row,
+            png_uint_32 yPos, int pass);
+
+    /**
+     * @brief  Handles stored interlaced rows once the image is complete.
+     *
+     * @param pngData  The libpng decoder.
+     *
+     * @param pngInfo  The libpng image information.
+     */
+    static void endCallback(png_structp pngData, png_infop pngInfo);
+
+    /**
+     * @brief  Converts one decoded row to the stream's row format, and passes
+     *         it to the row handler.
+     *
+     * @param yPos    The y-coordinate of the row.
+     *
+     * @param pixels  The decoded 0xAARRGGBB row pixels.
+     */
+    void handleRow(const size_t yPos, const uint32_t* pixels);
+
+    /**
+     * @brief  Blends one premultiplied row into the draw context's frame
+     *         buffer.
+     *
+     * @param yPos    The y-coordinate of the row within the image.
+     *
+     * @param pixels  The premultiplied row pixels.
+     */
+    void drawRow(const size_t yPos, const uint32_t* pixels);
+
+    // Receives each decoded row:
+    RowHandler handler;
+    RowFormat rowFormat;
+    // The libpng decoder and image information:
+    png_structp pngData = nullptr;
+    png_infop pngInfo = nullptr;
+    size_t width = 0;
+    size_t height = 0;
+    bool interlaced = false;
+    bool finished = false;
+    bool failed = false;
+    // Holds the row passed to the handler, or the whole image while an
+    // interlaced image is decoded:
+    std::vector<uint32_t> rowPixels;
+    std::vector<uint32_t> imagePixels;
+
+    // Frame buffer drawing data, used if the stream draws into a frame
+    // buffer:
+    DrawContext* context = nullptr;
+    int xOrigin = 0;
+    int yOrigin = 0;
+    const PixelConverter* converter = nullptr;
+    // Holds native frame buffer pixels, then blended colors:
+    std::vector<uint32_t> drawBuffer;
+};
@@ -0,0 +1,300 @@
+#include "PreparedImage.h"
+#include "BlendKernels.h"
+#include <algorithm>
+#include <new>
+
+
+// Finds the runs of transparent, opaque, and partially transparent pixels in
+// one row of premultiplied pixels.
+static void findRuns(const uint32_t* row, const size_t width,
+        std::vector<FBPainter::PixelRun>& runs)
+{
+    using FBPainter::RunType;
+    runs.clear();
+    for (size_t x = 0; x < width; x++)
+    {
+        const uint32_t alpha = row[x] >> 24;
+        const RunType type = (alpha == 0) ? RunType::Transparent
+                : ((alpha == 255) ? RunType::Opaque : RunType::Blended);
+        if (x > 0 && runs.back().type == type)
+        {
+            runs.back().length++;
+        }
+        else
+        {
+            runs.push_back({ static_cast<uint32_t>(x), 1, type });
+        }
+    }
+}
+
+
+// Prepares an image on construction.
+FBPainter::PreparedImage::PreparedImage(std::shared_ptr<const Image> source)
+{
+    if (source == nullptr)
+    {
+        return;
+    }
+    const size_t sourceWidth = source->getWidth();
+    const size_t sourceHeight = source->getHeight();
+    bool borrowRows = true;
+    for (size_t y = 0; y < sourceHeight && borrowRows; y++)
+    {
+        borrowRows = source->getPremultipliedRow(y) != nullptr;
+    }
+    try
+    {
+        if (! borrowRows)
+        {
+            pixels.resize(sourceWidth * sourceHeight);
+            for (size_t y = 0; y < sourceHeight; y++)
+            {
+                source->readRow(y, 0, sourceWidth,
+                        pixels.data() + y * sourceWidth,
+                        RowFormat::PremultipliedARGB);
+            }
+        }
+        rowRuns.resize(sourceHeight);
+        for (size_t y = 0; y < sourceHeight; y++)
+        {
+            const uint32_t* row = borrowRows ? source->getPremultipliedRow(y)
+                    : pixels.data() + y * sourceWidth;
+            findRuns(row, sourceWidth, rowRuns[y]);
+        }
+    }
+    catch (const std::bad_alloc&)
+    {
+        pixels.clear();
+        rowRuns.clear();
+        return;
+    }
+    if (borrowRows)
+    {
+        borrowedSource = source;
+    }
+    width = sourceWidth;
+    height = sourceHeight;
+}
+
+
+// Checks if an image already provides everything ImagePainter needs to draw
+// it.
+bool FBPainter::PreparedImage::isPrepared(const Image& image)
+{
+    const size_t imageHeight = image.getHeight();
+    for (size_t y = 0; y < imageHeight; y++)
+    {
+        size_t runCount;
+        if (image.getPremultipliedRow(y) == nullptr
+                || image.getRowRuns(y, runCount) == nullptr)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+// Prepares an image for drawing unless it's already prepared.
+std::shared_ptr<const FBPainter::Image> FBPainter::PreparedImage::prepare
+(const std::shared_ptr<const Image>& image)
+{
+    if (image == nullptr || isPrepared(*image))
+    {
+        return image;
+    }
+    std::shared_ptr<const PreparedImage> prepared;
+    try
+    {
+        prepared = std::make_shared<PreparedImage>(image);
+    }
+    catch (const std::bad_alloc&)
+    {
+        return image;
+    }
+    // If there wasn't enough memory to prepare the image, each painter will
+    // try again with its own copy:
+    if (prepared->getWidth() != image->getWidth()
+            || prepared->getHeight() != image->getHeight())
+    {
+        return image;
+    }
+    return prepared;
+}
+
+
+// Gets the width of the image.
+size_t FBPainter::PreparedImage::getWidth() const
+{
+    return width;
+}
+
+
+// Gets the height of the image.
+size_t FBPainter::PreparedImage::getHeight() const
+{
+    return height;
+}
+
+
+// Gets pixel color data at a specific image coordinate.
+FBPainter::RGBPixel FBPainter::PreparedImage::getRGBPixel(const size_t xPos,
+        const size_t yPos) const
+{
+    if (xPos >= width || yPos >= height)
+    {
+        return RGBPixel(0, 0, 0);
+    }
+    return getRGBAPixel(xPos, yPos);
+}
+
+
+// Gets pixel color data at a specific image coordinate.
+FBPainter::RGBAPixel FBPainter::PreparedImage::getRGBAPixel(const size_t xPos,
+        const size_t yPos) const
+{
+    if (xPos >= width || yPos >= height)
+    {
+        return RGBAPixel(0, 0, 0, 0);
+    }
+    const uint32_t pixel = unpremultiplyColor(
+            getPremultipliedRow(yPos)[xPos]);
+    return RGBAPixel(pixel >> 16, pixel >> 8, pixel, pixel >> 24);
+}
+
+
+// Copies a run of pixels from one image row.
+void FBPainter::PreparedImage::readRow(const size_t yPos, const size_t xStart,
+        const size_t count, uint32_t* dest, const RowFormat format) const
+{
+    const size_t inBounds = (yPos < height && xStart < width)
+            ? std::min(count, width - xStart) : 0;
+    if (inBounds > 0)
+    {
+        const uint32_t* row = getPremultipliedRow(yPos) + xStart;
+        if (format == RowFormat::PremultipliedARGB)
+        {
+            std::copy(row, row + inBounds, dest);
+        }
+        else
+        {
+            std::transform(row, row + inBounds, dest, unpremultiplyColor);
+        }
+    }
+    std::fill(dest + inBounds, dest + count, 0);
+}
+
+
+// Gets direct access to one row of premultiplied pixels.
+const uint32_t* FBPainter::PreparedImage::getPremultipliedRow(
+        const size_t yPos) const
+{
+    if (yPos >= height)
+    {
+        return nullptr;
+    }
+    if (borrowedSource != nullptr)
+    {
+        return borrowedSource->getPremultipliedRow(yPos);
+    }
+    return pixels.data() + yPos * width;
+}
+
+
+// Gets the runs of transparent, opaque, and partially transparent pixels in
+// one image row.
+const FBPainter::PixelRun* FBPainter::PreparedImage::getRowRuns(
+        const size_t yPos, size_t& count) const
+{
+    count = 0;
+    if (yPos >= height || rowRuns[yPos].empty())
+    {
+        return nullptr;
+    }
+    count = rowRuns[yPos].size();
+    return rowRuns[yPos].data();
+}
+
+
+// Reloads pixels within areas of the source image after its data changes, and
+// finds the runs in the changed rows again.
+void FBPainter::PreparedImage::update(const Image& source,
+        const std::vector<Rectangle>& areas)
+{
+    const Rectangle imageBounds(0, 0, width, height);
+    // Borrowed rows already hold the changes:
+    for (const Rectangle& area : areas)
+    {
+        const Rectangle imageArea = area.getIntersection(imageBounds);
+        for (int y = imageArea.getTop(); y < imageArea.getBottom()
+                && borrowedSource == nullptr; y++)
+        {
+            source.readRow(y, imageArea.getLeft(), imageArea.getWidth(),
+                    pixels.data() + y * width + imageArea.getLeft(),
+                    RowFormat::PremultipliedARGB);
+        }
+    }
+    // Changes often arrive as many small spans, so runs are found once for
+    // each changed row rather than once for each span:
+    std::vector<size_t> changedRows;
+    try
+    {
+        for (const Rectangle& area : areas)
+        {
+            const Rectangle imageArea = area.getIntersection(imageBounds);
+            for (int y = imageArea.getTop(); y < imageArea.getBottom(); y++)
+            {
+                changedRows.push_back(y);
+            }
+        }
+    }
+    catch (const std::bad_alloc&)
+    {
+        // Without room to list the rows, every row is checked:
+        changedRows.clear();
+        changedRows.shrink_to_fit();
+        for (size_t y = 0; y < height; y++)
+        {
+            findRowRuns(y);
+        }
+        return;
+    }
+    std::sort(changedRows.begin(), changedRows.end());
+    changedRows.erase(std::unique(changedRows.begin(), changedRows.end()),
+            changedRows.end());
+    for (const size_t y : changedRows)
+    {
+        findRowRuns(y);
+    }
+}
+
+
+// Finds the runs in one image row again after its pixels change.
+void FBPainter::PreparedImage::findRowRuns(const size_t yPos)
+{
+    // Rows that fail to store their runs are left without any, so they're
+    // skipped when drawing instead of drawn incorrectly:
+    try
+    {
+        findRuns(getPremultipliedRow(yPos), width, rowRuns[yPos]);
+    }
+    catch (const std::bad_alloc&)
+    {
+        rowRuns[yPos].clear();
+    }
+}
+
+
+// Gets the memory used by the image's pixels and runs.
+size_t FBPainter::PreparedImage::getStorageSize() const
+{
+    size_t size = (borrowedSource != nullptr)
+            ? width * height * sizeof(uint32_t)
+            : pixels.capacity() * sizeof(uint32_t);
+    size += rowRuns.capacity() * sizeof(std::vector<PixelRun>);
+    for (const std::vector<PixelRun>& runs : rowRuns)
+    {
+        size += runs.capacity() * sizeof(PixelRun);
+    }
+    return size;
+}
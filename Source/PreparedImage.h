@@ -0,0 +1,202 @@
+/**
+ * @file  PreparedImage.h
+ *
+ * @brief  An image holding the premultiplied pixels and pixel runs that
+ *         ImagePainter draws from.
+ */
+
+#pragma once
+#include "Image.h"
+#include "Rectangle.h"
+#include <memory>
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+namespace FBPainter
+{
+    class PreparedImage;
+}
+
+/**
+ * @brief  Reads an image once on construction, and finds the runs of
+ *         transparent, opaque, and partially transparent pixels in each row.
+ *
+ *  ImagePainter draws straight from any image that provides premultiplied
+ * rows and runs, such as a premultiplied RawImage. Any other image is wrapped
+ * in a PreparedImage. Images that already keep premultiplied rows in memory,
+ * such as a QoiImage or ScaledImage, only gain runs, and their rows are used
+ * in place. Other images are copied as premultiplied pixels.
+ *
+ *  A PreparedImage may be shared by any number of painters, so preparing an
+ * image before creating its painters keeps one copy instead of one per
+ * painter.
+ */
+class FBPainter::PreparedImage : public Image
+{
+public:
+    /**
+     * @brief  Prepares an image on construction.
+     *
+     * @param source  The image to prepare. If it provides premultiplied rows
+     *                for every row, those rows are used in place and the
+     *                source is kept until the PreparedImage is destroyed.
+     *                Otherwise, its pixels are copied, and the PreparedImage
+     *                doesn't keep any reference to it.
+     */
+    PreparedImage(std::shared_ptr<const Image> source);
+
+    virtual ~PreparedImage() { }
+
+    /**
+     * @brief  Checks if an image already provides everything ImagePainter
+     *         needs to draw it, so it doesn't need to be prepared.
+     *
+     * @param image  The image to check.
+     *
+     * @return       Whether the image provides premultiplied rows and valid
+     *               runs for every row.
+     */
+    static bool isPrepared(const Image& image);
+
+    /**
+     * @brief  Prepares an image for drawing unless it's already prepared.
+     *
+     *  This reads every pixel of an unprepared image, so it's best called
+     * wherever the image was loaded, rather than on the thread that draws.
+     *
+     * @param image  The image to prepare, which may be nullptr.
+     *
+     * @return       The image itself if it's already prepared or couldn't be
+     *               prepared, or a new PreparedImage holding its pixels and
+     *               runs.
+     */
+    static std::shared_ptr<const Image> prepare(
+            const std::shared_ptr<const Image>& image);
+
+    /**
+     * @brief  Gets the width of the image.
+     *
+     * @return  The image width in pixels, or zero if the image couldn't be
+     *          prepared.
+     */
+    size_t getWidth() const override;
+
+    /**
+     * @brief  Gets the height of the image.
+     *
+     * @return  The image height in pixels, or zero if the image couldn't be
+     *          prepared.
+     */
+    size_t getHeight() const override;
+
+    /**
+     * @brief  Gets pixel color data at a specific image coordinate.
+     *
+     * @param xPos  The pixel's x-coordinate.
+     *
+     * @param yPos  The pixel's y-coordinate.
+     *
+     * @return      The pixel value at the given coordinate, or
+     *              RGBPixel(0, 0, 0) if the coordinate is out of bounds.
+     */
+    RGBPixel getRGBPixel(const size_t xPos, const size_t yPos) const override;
+
+    /**
+     * @brief  Gets pixel color data at a specific image coordinate.
+     *
+     * @param xPos  The pixel's x-coordinate.
+     *
+     * @param yPos  The pixel's y-coordinate.
+     *
+     * @return      The pixel value at the given coordinate, or
+     *              RGBAPixel(0, 0, 0, 0) if the coordinate is out of bounds.
+     */
+    RGBAPixel getRGBAPixel(const size_t xPos, const size_t yPos)
+            const override;
+
+    /**
+     * @brief  Copies a run of pixels from one image row.
+     *
+     * @param yPos    The y-coordinate of the row to read.
+     *
+     * @param xStart  The x-coordinate of the first pixel to read.
+     *
+     * @param count   The number of pixels to read.
+     *
+     * @param dest    A buffer with room for count pixel values. Pixels
+     *                outside of the image bounds are set to zero.
+     *
+     * @param format  The layout of the pixel values written to dest.
+     */
+    void readRow(const size_t yPos, const size_t xStart, const size_t count,
+            uint32_t* dest, const RowFormat format) const override;
+
+    /**
+     * @brief  Gets direct access to one row of premultiplied pixels.
+     *
+     * @param yPos  The y-coordinate of the row.
+     *
+     * @return      The row's premultiplied 0xAARRGGBB pixels, or nullptr if
+     *              the row is out of bounds.
+     */
+    const uint32_t* getPremultipliedRow(const size_t yPos) const override;
+
+    /**
+     * @brief  Gets the runs of transparent, opaque, and partially transparent
+     *         pixels in one image row.
+     *
+     * @param yPos   The y-coordinate of the row.
+     *
+     * @param count  Set to the number of runs in the row, or zero if the row
+     *               is out of bounds.
+     *
+     * @return       The row's runs, or nullptr if the row is out of bounds or
+     *               its runs couldn't be stored.
+     */
+    const PixelRun* getRowRuns(const size_t yPos, size_t& count)
+            const override;
+
+    /**
+     * @brief  Reloads pixels within areas of the source image after its
+     *         data changes, and finds the runs in the changed rows again.
+     *
+     *  This must not be called while any painter sharing the image is
+     * drawing. The source image's dimensions must not change.
+     *
+     * @param source  The image this was prepared from. Copied pixels within
+     *                the areas are read from it again, while borrowed rows
+     *                already hold the changes.
+     *
+     * @param areas   The changed areas, in image coordinates.
+     */
+    void update(const Image& source, const std::vector<Rectangle>& areas);
+
+    /**
+     * @brief  Gets the memory used by the image's pixels and runs.
+     *
+     * @return  The size of the copied pixels and stored runs in bytes. Rows
+     *          borrowed from the source image are counted as four bytes per
+     *          pixel, as they're kept in memory for as long as this image.
+     */
+    size_t getStorageSize() const;
+
+private:
+    /**
+     * @brief  Finds the runs in one image row again after its pixels change.
+     *
+     * @param yPos  The y-coordinate of the changed row.
+     */
+    void findRowRuns(const size_t yPos);
+
+    // The source image, kept only while its rows are used in place:
+    std::shared_ptr<const Image> borrowedSource;
+    // Copied premultiplied pixels, stored row by row, or empty if the source
+    // image's rows are used in place:
+    std::vector<uint32_t> pixels;
+    // The runs in each image row:
+    std::vector<std::vector<PixelRun>> rowRuns;
+    // Image dimensions, or zero if the image couldn't be prepared:
+    size_t width = 0;
+    size_t height = 0;
+};
@@ -0,0 +1,71 @@
+/**
+ * @file  QoiFormat.h
+ *
+ * @brief  Defines the layout of QOI ("Quite OK Image") files, a simple
+ *         lossless compressed image format that needs no external library.
+ */
+
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * @brief  QOI files start with a 14 byte header, followed by a stream of
+ *         pixel chunks, then an eight byte end marker.
+ *
+ *  The header holds the magic bytes, the width and height as big-endian
+ * uint32_t values, the channel count, and the colorspace. Each chunk either
+ * repeats the previous pixel, copies a recently seen pixel from a 64 entry
+ * table indexed by colorHash, stores a small difference from the previous
+ * pixel, or stores a full RGB or RGBA value. Decoding starts with an opaque
+ * black previous pixel and an all-zero table.
+ */
+namespace FBPainter
+{
+    namespace QoiFormat
+    {
+        // The first bytes of every QOI file:
+        static const constexpr char magic[4] = { 'q', 'o', 'i', 'f' };
+        // The size of the file header in bytes:
+        static const constexpr size_t headerSize = 14;
+        // The bytes at the end of every QOI file:
+        static const constexpr uint8_t endMarker[8]
+                = { 0, 0, 0, 0, 0, 0, 0, 1 };
+        // The number of recently seen pixels kept for index chunks:
+        static const constexpr size_t indexSize = 64;
+        // Images are limited to this many pixels, so a corrupt header can't
+        // trigger a huge allocation:
+        static const constexpr uint64_t maxPixels = 400000000;
+
+        // Chunk tags. Two bit tags are stored in the top bits of the first
+        // chunk byte, eight bit tags use the whole byte:
+        static const constexpr uint8_t tagMask  = 0xc0;
+        static const constexpr uint8_t tagIndex = 0x00;
+        static const constexpr uint8_t tagDiff  = 0x40;
+        static const constexpr uint8_t tagLuma  = 0x80;
+        static const constexpr uint8_t tagRun   = 0xc0;
+        static const constexpr uint8_t tagRGB   = 0xfe;
+        static const constexpr uint8_t tagRGBA  = 0xff;
+        // Run chunks repeat the previous pixel up to this many times:
+        static const constexpr size_t maxRun = 62;
+
+        /**
+         * @brief  Finds the index table position of a pixel color.
+         *
+         * @param red    The pixel's red component.
+         *
+         * @param green  The pixel's green component.
+         *
+         * @param blue   The pixel's blue component.
+         *
+         * @param alpha  The pixel's alpha component.
+         *
+         * @return       The pixel's position in the index table.
+         */
+        static inline size_t colorHash(const uint8_t red, const uint8_t green,
+                const uint8_t blue, const uint8_t alpha)
+        {
+            return (red * 3 + green * 5 + blue * 7 + alpha * 11) % indexSize;
+        }
+    }
+}
@@ -0,0 +1,234 @@
+#include "QoiImage.h"
+#include "QoiFormat.h"
+#include "BlendKernels.h"
+#include <algorithm>
+#include <cstring>
+#include <new>
+#include <stdio.h>
+
+// Reads a big-endian 32-bit value.
+static uint32_t readBigEndian(const uint8_t* data)
+{
+    return (static_cast<uint32_t>(data[0]) << 24)
+            | (static_cast<uint32_t>(data[1]) << 16)
+            | (static_cast<uint32_t>(data[2]) << 8)
+            | static_cast<uint32_t>(data[3]);
+}
+
+
+// Loads and decodes a QOI image file on construction.
+FBPainter::QoiImage::QoiImage(const char* imagePath)
+{
+    FILE* imageFile = fopen(imagePath, "rb");
+    if (imageFile == nullptr)
+    {
+        perror("Opening QOI image file failed");
+        return;
+    }
+    std::vector<uint8_t> fileData;
+    uint8_t buffer[16384];
+    size_t bytesRead;
+    while ((bytesRead = fread(buffer, 1, sizeof(buffer), imageFile)) > 0)
+    {
+        fileData.insert(fileData.end(), buffer, buffer + bytesRead);
+    }
+    const bool readFailed = ferror(imageFile);
+    fclose(imageFile);
+    if (readFailed)
+    {
+        perror("Reading QOI image file failed");
+        return;
+    }
+    if (! decode(fileData.data(), fileData.size()))
+    {
+        fprintf(stderr, "Invalid QOI image file \"%s\"\n", imagePath);
+    }
+}
+
+
+// Decodes QOI image data on construction.
+FBPainter::QoiImage::QoiImage(const uint8_t* data, const size_t size)
+{
+    if (! decode(data, size))
+    {
+        fprintf(stderr, "Invalid QOI image data\n");
+    }
+}
+
+
+// Gets the width of the image.
+size_t FBPainter::QoiImage::getWidth() const
+{
+    return width;
+}
+
+
+// Gets the height of the image.
+size_t FBPainter::QoiImage::getHeight() const
+{
+    return height;
+}
+
+
+// Gets pixel color data at a specific image coordinate.
+FBPainter::RGBPixel FBPainter::QoiImage::getRGBPixel(const size_t xPos,
+        const size_t yPos) const
+{
+    if (xPos >= width || yPos >= height)
+    {
+        return RGBPixel(0, 0, 0);
+    }
+    return getRGBAPixel(xPos, yPos);
+}
+
+
+// Gets pixel color data at a specific image coordinate.
+FBPainter::RGBAPixel FBPainter::QoiImage::getRGBAPixel(const size_t xPos,
+        const size_t yPos) const
+{
+    uint32_t pixel;
+    readRow(yPos, xPos, 1, &pixel, RowFormat::ARGB);
+    return RGBAPixel(pixel >> 16, pixel >> 8, pixel, pixel >> 24);
+}
+
+
+// Copies a run of pixels from one image row.
+void FBPainter::QoiImage::readRow(const size_t yPos, const size_t xStart,
+        const size_t count, uint32_t* dest, const RowFormat format) const
+{
+    const size_t inBounds = (yPos < height && xStart < width)
+            ? std::min(count, width - xStart) : 0;
+    if (inBounds > 0)
+    {
+        const uint32_t* row = pixels.data() + yPos * width + xStart;
+        if (format == RowFormat::PremultipliedARGB)
+        {
+            memcpy(dest, row, inBounds * sizeof(uint32_t));
+        }
+        else
+        {
+            std::transform(row, row + inBounds, dest, unpremultiplyColor);
+        }
+    }
+    std::fill(dest + inBounds, dest + count, 0);
+}
+
+
+// Gets direct access to one row of decoded premultiplied pixels.
+const uint32_t* FBPainter::QoiImage::getPremultipliedRow(const size_t yPos)
+        const
+{
+    return (yPos < height) ? pixels.data() + yPos * width : nullptr;
+}
+
+
+// Decodes QOI image data, replacing any existing pixels.
+bool FBPainter::QoiImage::decode(const uint8_t* data, const size_t size)
+{
+    namespace Format = QoiFormat;
+    pixels.clear();
+    width = 0;
+    height = 0;
+    if (data == nullptr || size < Format::headerSize
+            + sizeof(Format::endMarker)
+            || memcmp(data, Format::magic, sizeof(Format::magic)) != 0)
+    {
+        return false;
+    }
+    const uint32_t imageWidth = readBigEndian(data + 4);
+    const uint32_t imageHeight = readBigEndian(data + 8);
+    const uint8_t channels = data[12];
+    const uint8_t colorspace = data[13];
+    const uint64_t pixelCount = static_cast<uint64_t>(imageWidth)
+            * imageHeight;
+    if (imageWidth == 0 || imageHeight == 0 || pixelCount > Format::maxPixels
+            || (channels != 3 && channels != 4) || colorspace > 1)
+    {
+        return false;
+    }
+    try
+    {
+        pixels.resize(pixelCount);
+    }
+    catch (const std::bad_alloc&)
+    {
+        fprintf(stderr, "Not enough memory for a %ux%u QOI image\n",
+                imageWidth, imageHeight);
+        return false;
+    }
+
+    // Every chunk is at least one byte long, so chunks may start anywhere
+    // before the end marker:
+    const uint8_t* chunk = data + Format::headerSize;
+    const uint8_t* const chunkEnd = data + size - sizeof(Format::endMarker);
+    uint8_t recentColors[Format::indexSize][4] = {};
+    uint8_t color[4] = { 0, 0, 0, 255 };
+    uint32_t premultiplied = premultiplyColor(0, 0, 0, 255);
+    uint32_t* pixel = pixels.data();
+    uint32_t* const pixelEnd = pixel + pixelCount;
+    while (pixel < pixelEnd)
+    {
+        if (chunk >= chunkEnd)
+        {
+            pixels.clear();
+            return false;
+        }
+        const uint8_t tag = *chunk++;
+        if ((tag & Format::tagMask) == Format::tagRun && tag != Format::tagRGB
+                && tag != Format::tagRGBA)
+        {
+            // Runs repeat the previous pixel. Like every other chunk, they
+            // also store it in the index, which only changes the index when
+            // the image starts with a run:
+            std::copy(color, color + 4, recentColors[Format::colorHash(
+                    color[0], color[1], color[2], color[3])]);
+            const size_t runLength = std::min<size_t>((tag & 0x3f) + 1,
+                    pixelEnd - pixel);
+            std::fill(pixel, pixel + runLength, premultiplied);
+            pixel += runLength;
+            continue;
+        }
+        if (tag == Format::tagRGB || tag == Format::tagRGBA)
+        {
+            const size_t valueSize = (tag == Format::tagRGB) ? 3 : 4;
+            if (static_cast<size_t>(chunkEnd - chunk) < valueSize)
+            {
+                pixels.clear();
+                return false;
+            }
+            std::copy(chunk, chunk + valueSize, color);
+            chunk += valueSize;
+        }
+        else if ((tag & Format::tagMask) == Format::tagIndex)
+        {
+            std::copy(recentColors[tag], recentColors[tag] + 4, color);
+        }
+        else if ((tag & Format::tagMask) == Format::tagDiff)
+        {
+            color[0] += ((tag >> 4) & 0x03) - 2;
+            color[1] += ((tag >> 2) & 0x03) - 2;
+            color[2] += (tag & 0x03) - 2;
+        }
+        else
+        {
+            if (chunk >= chunkEnd)
+            {
+                pixels.clear();
+                return false;
+            }
+            const int greenDiff = (tag & 0x3f) - 32;
+            const uint8_t redBlue = *chunk++;
+            color[0] += greenDiff - 8 + ((redBlue >> 4) & 0x0f);
+            color[1] += greenDiff;
+            color[2] += greenDiff - 8 + (redBlue & 0x0f);
+        }
+        std::copy(color, color + 4, recentColors[Format::colorHash(color[0],
+                color[1], color[2], color[3])]);
+        premultiplied = premultiplyColor(color[0], color[1], color[2],
+                color[3]);
+        *pixel++ = premultiplied;
+    }
+    width = imageWidth;
+    height = imageHeight;
+    return true;
+}
@@ -0,0 +1,144 @@
+/**
+ * @file  QoiImage.h
+ *
+ * @brief  An image decoded from QOI data, without using libpng or any other
+ *         external library.
+ */
+
+#pragma once
+#include "Image.h"
+#include <vector>
+#include <stdint.h>
+#include <stddef.h>
+
+namespace FBPainter
+{
+    class QoiImage;
+}
+
+/**
+ * @brief  Decodes a QOI image once on construction, and holds its pixels as
+ *         premultiplied 0xAARRGGBB values.
+ *
+ *  QOI images decode several times faster than PNG images of a similar size.
+ * Pixels are premultiplied as they're decoded, which is the layout that
+ * ImagePainter and Compositor read, so drawing copies rows without
+ * converting them.
+ *
+ *  QOI files are created from .png images with `ImageEncoder --qoi`, and
+ * their layout is described in QoiFormat.h.
+ */
+class FBPainter::QoiImage : public Image
+{
+public:
+    /**
+     * @brief  Loads and decodes a QOI image file on construction.
+     *
+     * @param imagePath  The path to a QOI image file. If the file can't be
+     *                   read or isn't a valid QOI image, an error is printed
+     *                   and the image will have no pixels.
+     */
+    QoiImage(const char* imagePath);
+
+    /**
+     * @brief  Decodes QOI image data on construction.
+     *
+     * @param data  The QOI image data, which doesn't need to outlive the
+     *              image.
+     *
+     * @param size  The size of the image data in bytes. If the data isn't a
+     *              valid QOI image, an error is printed and the image will
+     *              have no pixels.
+     */
+    QoiImage(const uint8_t* data, const size_t size);
+
+    virtual ~QoiImage() { }
+
+    /**
+     * @brief  Gets the width of the image.
+     *
+     * @return  The image width in pixels, or zero if decoding failed.
+     */
+    size_t getWidth() const override;
+
+    /**
+     * @brief  Gets the height of the image.
+     *
+     * @return  The image height in pixels, or zero if decoding failed.
+     */
+    size_t getHeight() const override;
+
+    /**
+     * @brief  Gets pixel color data at a specific image coordinate.
+     *
+     * @param xPos  The pixel's x-coordinate.
+     *
+     * @param yPos  The pixel's y-coordinate.
+     *
+     * @return      The pixel value at the given coordinate, or
+     *              RGBPixel(0, 0, 0) if the coordinate is out of bounds.
+     */
+    RGBPixel getRGBPixel(const size_t xPos, const size_t yPos) const override;
+
+    /**
+     * @brief  Gets pixel color data at a specific image coordinate.
+     *
+     * @param xPos  The pixel's x-coordinate.
+     *
+     * @param yPos  The pixel's y-coordinate.
+     *
+     * @return      The pixel value at the given coordinate, or
+     *              RGBAPixel(0, 0, 0, 0) if the coordinate is out of bounds.
+     */
+    RGBAPixel getRGBAPixel(const size_t xPos, const size_t yPos)
+            const override;
+
+    /**
+     * @brief  Copies a run of pixels from one image row.
+     *
+     *  Reading premultiplied pixels copies them straight from the decoded
+     * image.
+     *
+     * @param yPos    The y-coordinate of the row to read.
+     *
+     * @param xStart  The x-coordinate of the first pixel to read.
+     *
+     * @param count   The number of pixels to read.
+     *
+     * @param dest    A buffer with room for count pixel values. Pixels
+     *                outside of the image bounds are set to zero.
+     *
+     * @param format  The layout of the pixel values written to dest.
+     */
+    void readRow(const size_t yPos, const size_t xStart, const size_t count,
+            uint32_t* dest, const RowFormat format) const override;
+
+    /**
+     * @brief  Gets direct access to one row of decoded premultiplied pixels.
+     *
+     * @param yPos  The y-coordinate of the row.
+     *
+     * @return      The row's premultiplied 0xAARRGGBB pixels, or nullptr if
+     *              the row is out of bounds.
+     */
+    const uint32_t* getPremultipliedRow(const size_t yPos) const override;
+
+private:
+    /**
+     * @brief  Decodes QOI image data, replacing any existing pixels.
+     *
+     * @param data  The QOI image data.
+     *
+     * @param size  The size of the image data in bytes.
+     *
+     * @return      Whether the data held a valid QOI image. If it didn't,
+     *              the image is left with no pixels.
+     */
+    bool decode(const uint8_t* data, const size_t size);
+
+    // Decoded premultiplied pixels, row by row:
+    std::vector<uint32_t> pixels;
+    // Image dimensions, or zero if decoding failed:
+    size_t width = 0;
+    size_t height = 0;
+};
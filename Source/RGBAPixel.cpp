@@ -1,4 +1,5 @@
 #include "RGBAPixel.h"
+#include "BlendKernels.h"
 
 
 // Creates a non-null RGBAPixel.
@@ -16,15 +17,6 @@ FBPainter::RGBAPixel::RGBAPixel(const RGBPixel& rgbPixel, uint8_t alpha) :
     }
 }
 
-// Combines two color components, applying an alpha value to the top component.
-static inline uint8_t combineComp(uint8_t cTop, uint8_t cBottom, uint8_t alpha)
-{
-    using cLimit = std::numeric_limits<uint8_t>;
-    return (cTop * alpha / cLimit::max()) + (cBottom * (cLimit::max() - alpha)
-            / cLimit::max());
-}
-
-
 // Gets the RGBPixel color value created by displaying this pixel over a fully
 // opaque background pixel.
 FBPainter::RGBPixel FBPainter::RGBAPixel::getCombinedPixel
@@ -38,9 +30,11 @@ FBPainter::RGBPixel FBPainter::RGBAPixel::getCombinedPixel
     {
         return RGBPixel(getRed(), getGreen(), getBlue());
     }
-    return RGBPixel(combineComp(getRed(), bgPixel.getRed(), alpha),
-            combineComp(getGreen(), bgPixel.getGreen(), alpha),
-            combineComp(getBlue(), bgPixel.getBlue(), alpha));
+    const uint32_t color = blendPremultiplied(
+            premultiplyColor(getRed(), getGreen(), getBlue(), alpha),
+            (bgPixel.getRed() << 16) | (bgPixel.getGreen() << 8)
+            | bgPixel.getBlue());
+    return RGBPixel(color >> 16, color >> 8, color);
 }
 
 
@@ -52,6 +52,9 @@ public:
      * @brief  Gets the RGBPixel color value created by displaying this pixel
      *         over a fully opaque background pixel.
      *
+     *  Components are rounded the same way as FBPainter::blendSpan, so this
+     * matches the colors ImagePainter draws.
+     *
      * @param bgPixel  A background pixel value to cover with this pixel.
      *
      * @return         The new pixel value, or backgroundPixel if this pixel is
@@ -0,0 +1,265 @@
+#include "RawImage.h"
+#include "BlendKernels.h"
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+
+// Maps a raw image file on construction.
+FBPainter::RawImage::RawImage(const char* imagePath)
+{
+    const int fileDescriptor = open(imagePath, O_RDONLY);
+    if (fileDescriptor == -1)
+    {
+        perror("Opening raw image file failed");
+        return;
+    }
+    struct stat fileInfo;
+    if (fstat(fileDescriptor, &fileInfo) == -1)
+    {
+        perror("Reading raw image file size failed");
+        close(fileDescriptor);
+        return;
+    }
+    fileSize = fileInfo.st_size;
+    if (fileSize < sizeof(RawImageFormat::Header))
+    {
+        fprintf(stderr, "Invalid raw image file \"%s\"\n", imagePath);
+        close(fileDescriptor);
+        return;
+    }
+    void* mapped = mmap(0, fileSize, PROT_READ, MAP_SHARED, fileDescriptor, 0);
+    // The mapping keeps the file open on its own:
+    close(fileDescriptor);
+    if (mapped == MAP_FAILED)
+    {
+        perror("Failed to map raw image file");
+        return;
+    }
+    fileData = static_cast<const uint8_t*>(mapped);
+    header = reinterpret_cast<const RawImageFormat::Header*>(fileData);
+    if (! isValid())
+    {
+        fprintf(stderr, "Invalid raw image file \"%s\"\n", imagePath);
+        munmap(const_cast<uint8_t*>(fileData), fileSize);
+        fileData = nullptr;
+        header = nullptr;
+        return;
+    }
+    rowRuns = reinterpret_cast<const uint32_t*>(fileData
+            + header->runIndexOffset);
+    runs = reinterpret_cast<const PixelRun*>(rowRuns + header->height + 1);
+    width = header->width;
+    height = header->height;
+}
+
+
+// Unmaps the image file on destruction.
+FBPainter::RawImage::~RawImage()
+{
+    if (fileData != nullptr)
+    {
+        munmap(const_cast<uint8_t*>(fileData), fileSize);
+        fileData = nullptr;
+    }
+}
+
+
+// Gets the width of the image.
+size_t FBPainter::RawImage::getWidth() const
+{
+    return width;
+}
+
+
+// Gets the height of the image.
+size_t FBPainter::RawImage::getHeight() const
+{
+    return height;
+}
+
+
+// Gets pixel color data at a specific image coordinate.
+FBPainter::RGBPixel FBPainter::RawImage::getRGBPixel(const size_t xPos,
+        const size_t yPos) const
+{
+    if (xPos >= width || yPos >= height)
+    {
+        return RGBPixel(0, 0, 0);
+    }
+    return getRGBAPixel(xPos, yPos);
+}
+
+
+// Gets pixel color data at a specific image coordinate.
+FBPainter::RGBAPixel FBPainter::RawImage::getRGBAPixel(const size_t xPos,
+        const size_t yPos) const
+{
+    uint32_t pixel;
+    readRow(yPos, xPos, 1, &pixel, RowFormat::ARGB);
+    return RGBAPixel(pixel >> 16, pixel >> 8, pixel, pixel >> 24);
+}
+
+
+// Copies a run of pixels from one image row.
+void FBPainter::RawImage::readRow(const size_t yPos, const size_t xStart,
+        const size_t count, uint32_t* dest, const RowFormat format) const
+{
+    const size_t inBounds = (yPos < height && xStart < width)
+            ? std::min(count, width - xStart) : 0;
+    if (inBounds > 0)
+    {
+        const uint8_t* pixels = getPixelData(xStart, yPos);
+        if (getPixelLayout() == RawImageFormat::PixelLayout::RGBA)
+        {
+            for (size_t i = 0; i < inBounds; i++, pixels += 4)
+            {
+                dest[i] = packRowPixel(pixels[0], pixels[1], pixels[2],
+                        pixels[3], format);
+            }
+        }
+        else if (format == RowFormat::PremultipliedARGB)
+        {
+            memcpy(dest, pixels, inBounds * sizeof(uint32_t));
+        }
+        else
+        {
+            const uint32_t* premultiplied
+                    = reinterpret_cast<const uint32_t*>(pixels);
+            std::transform(premultiplied, premultiplied + inBounds, dest,
+                    unpremultiplyColor);
+        }
+    }
+    std::fill(dest + inBounds, dest + count, 0);
+}
+
+
+// Gets direct access to one row of mapped image pixels.
+const uint8_t* FBPainter::RawImage::getRowData(const size_t yPos) const
+{
+    if (yPos >= height
+            || getPixelLayout() != RawImageFormat::PixelLayout::RGBA)
+    {
+        return nullptr;
+    }
+    return getPixelData(0, yPos);
+}
+
+
+// Gets the layout of the pixels stored in the image file.
+FBPainter::RawImageFormat::PixelLayout FBPainter::RawImage::getPixelLayout()
+        const
+{
+    if (header == nullptr)
+    {
+        return RawImageFormat::PixelLayout::RGBA;
+    }
+    return static_cast<RawImageFormat::PixelLayout>(header->pixelLayout);
+}
+
+
+// Gets direct access to one row of mapped premultiplied pixels.
+const uint32_t* FBPainter::RawImage::getPremultipliedRow(const size_t yPos)
+        const
+{
+    if (yPos >= height || getPixelLayout()
+            != RawImageFormat::PixelLayout::PremultipliedARGB)
+    {
+        return nullptr;
+    }
+    return reinterpret_cast<const uint32_t*>(getPixelData(0, yPos));
+}
+
+
+// Gets the runs of transparent, opaque, and partially transparent pixels in
+// one image row.
+const FBPainter::PixelRun* FBPainter::RawImage::getRowRuns(const size_t yPos,
+        size_t& count) const
+{
+    count = 0;
+    if (yPos >= height)
+    {
+        return nullptr;
+    }
+    const uint32_t firstRun = rowRuns[yPos];
+    const uint32_t lastRun = rowRuns[yPos + 1];
+    if (firstRun > lastRun || lastRun > header->runCount)
+    {
+        return nullptr;
+    }
+    // Runs must cover the whole row in order, without gaps or overlaps:
+    const PixelRun* rowRunData = runs + firstRun;
+    uint64_t rowPosition = 0;
+    for (uint32_t i = 0; i < lastRun - firstRun; i++)
+    {
+        const PixelRun& run = rowRunData[i];
+        if (run.start != rowPosition || run.length == 0
+                || static_cast<uint32_t>(run.type)
+                > static_cast<uint32_t>(RunType::Blended))
+        {
+            return nullptr;
+        }
+        rowPosition += run.length;
+    }
+    if (rowPosition != width)
+    {
+        return nullptr;
+    }
+    count = lastRun - firstRun;
+    return rowRunData;
+}
+
+
+// Checks that the mapped file holds a valid raw image.
+bool FBPainter::RawImage::isValid() const
+{
+    if (memcmp(header->magic, RawImageFormat::magic,
+            sizeof(RawImageFormat::magic)) != 0
+            || header->version != RawImageFormat::version
+            || header->width == 0 || header->height == 0)
+    {
+        return false;
+    }
+    const RawImageFormat::PixelLayout layout = getPixelLayout();
+    if (layout != RawImageFormat::PixelLayout::RGBA
+            && layout != RawImageFormat::PixelLayout::PremultipliedARGB)
+    {
+        return false;
+    }
+    // Pixel values and the run index must be aligned for 32-bit reads, and
+    // every section must fit within the file. All sizes are checked as
+    // 64-bit values, so they can't overflow:
+    const uint64_t rowSize = static_cast<uint64_t>(header->width)
+            * sizeof(uint32_t);
+    const uint64_t pixelSize = static_cast<uint64_t>(header->stride)
+            * header->height;
+    const uint64_t indexSize = (static_cast<uint64_t>(header->height) + 1)
+            * sizeof(uint32_t) + static_cast<uint64_t>(header->runCount)
+            * sizeof(PixelRun);
+    if (header->stride < rowSize || header->stride % sizeof(uint32_t) != 0
+            || header->pixelOffset % sizeof(uint32_t) != 0
+            || header->runIndexOffset % sizeof(uint32_t) != 0
+            || header->pixelOffset > fileSize
+            || pixelSize > fileSize - header->pixelOffset
+            || header->runIndexOffset > fileSize
+            || indexSize > fileSize - header->runIndexOffset)
+    {
+        return false;
+    }
+    // The rest of the index is checked one row at a time by getRowRuns, so
+    // opening the file doesn't read the whole index:
+    return true;
+}
+
+
+// Gets the address of a mapped image pixel.
+const uint8_t* FBPainter::RawImage::getPixelData(const size_t xPos,
+        const size_t yPos) const
+{
+    return fileData + header->pixelOffset + yPos * header->stride
+            + xPos * sizeof(uint32_t);
+}
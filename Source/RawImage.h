@@ -0,0 +1,193 @@
+/**
+ * @file  RawImage.h
+ *
+ * @brief  An image that maps a raw image file into memory, and uses its
+ *         pixels without decoding or copying them.
+ */
+
+#pragma once
+#include "Image.h"
+#include "RawImageFormat.h"
+#include <stdint.h>
+#include <stddef.h>
+
+namespace FBPainter
+{
+    class RawImage;
+}
+
+/**
+ * @brief  Reads pixels straight from a memory-mapped raw image file.
+ *
+ *  Opening a raw image only reads and checks its header, so it takes the
+ * same time for any image size. Each row's alpha runs are checked whenever
+ * they're read. Pixel pages are loaded by the kernel as they're first read,
+ * and as the file is mapped read-only, the page cache shares those pages
+ * between every process using the same image file.
+ *
+ *  Files that store premultiplied pixels provide both their rows and their
+ * runs to ImagePainter, which draws straight from the mapped file without
+ * copying the image.
+ *
+ *  Raw image files are created with `ImageEncoder --raw`, and their layout
+ * is described in RawImageFormat.h.
+ */
+class FBPainter::RawImage : public Image
+{
+public:
+    /**
+     * @brief  Maps a raw image file on construction.
+     *
+     * @param imagePath  The path to a raw image file. If the file can't be
+     *                   mapped or isn't a valid raw image, an error is
+     *                   printed and the image will have no pixels.
+     */
+    RawImage(const char* imagePath);
+
+    /**
+     * @brief  Unmaps the image file on destruction.
+     */
+    virtual ~RawImage();
+
+    /**
+     * @brief  Gets the width of the image.
+     *
+     * @return  The image width in pixels, or zero if the file couldn't be
+     *          loaded.
+     */
+    size_t getWidth() const override;
+
+    /**
+     * @brief  Gets the height of the image.
+     *
+     * @return  The image height in pixels, or zero if the file couldn't be
+     *          loaded.
+     */
+    size_t getHeight() const override;
+
+    /**
+     * @brief  Gets pixel color data at a specific image coordinate.
+     *
+     * @param xPos  The pixel's x-coordinate.
+     *
+     * @param yPos  The pixel's y-coordinate.
+     *
+     * @return      The pixel value at the given coordinate, or
+     *              RGBPixel(0, 0, 0) if the coordinate is out of bounds.
+     */
+    RGBPixel getRGBPixel(const size_t xPos, const size_t yPos) const override;
+
+    /**
+     * @brief  Gets pixel color data at a specific image coordinate.
+     *
+     * @param xPos  The pixel's x-coordinate.
+     *
+     * @param yPos  The pixel's y-coordinate.
+     *
+     * @return      The pixel value at the given coordinate, or
+     *              RGBAPixel(0, 0, 0, 0) if the coordinate is out of bounds.
+     */
+    RGBAPixel getRGBAPixel(const size_t xPos, const size_t yPos)
+            const override;
+
+    /**
+     * @brief  Copies a run of pixels from one image row.
+     *
+     *  Reading a row in the file's own pixel layout copies it straight out
+     * of the mapped file.
+     *
+     * @param yPos    The y-coordinate of the row to read.
+     *
+     * @param xStart  The x-coordinate of the first pixel to read.
+     *
+     * @param count   The number of pixels to read.
+     *
+     * @param dest    A buffer with room for count pixel values. Pixels
+     *                outside of the image bounds are set to zero.
+     *
+     * @param format  The layout of the pixel values written to dest.
+     */
+    void readRow(const size_t yPos, const size_t xStart, const size_t count,
+            uint32_t* dest, const RowFormat format) const override;
+
+    /**
+     * @brief  Gets direct access to one row of mapped image pixels.
+     *
+     * @param yPos  The y-coordinate of the row.
+     *
+     * @return      The mapped row's pixels as red, green, blue, and alpha
+     *              bytes, or nullptr if the row is out of bounds or the file
+     *              stores premultiplied pixels.
+     */
+    const uint8_t* getRowData(const size_t yPos) const override;
+
+    /**
+     * @brief  Gets the layout of the pixels stored in the image file.
+     *
+     * @return  The stored pixel layout.
+     */
+    RawImageFormat::PixelLayout getPixelLayout() const;
+
+    /**
+     * @brief  Gets direct access to one row of mapped premultiplied pixels.
+     *
+     * @param yPos  The y-coordinate of the row.
+     *
+     * @return      The mapped row's premultiplied 0xAARRGGBB pixels, or
+     *              nullptr if the row is out of bounds or the file stores
+     *              unscaled RGBA pixels.
+     */
+    const uint32_t* getPremultipliedRow(const size_t yPos) const override;
+
+    /**
+     * @brief  Gets the runs of transparent, opaque, and partially transparent
+     *         pixels in one image row, straight from the image file.
+     *
+     *  The row's runs are checked each time they're read, so a damaged run
+     * index never causes reads outside of the row.
+     *
+     * @param yPos   The y-coordinate of the row.
+     *
+     * @param count  Set to the number of runs in the row, or zero if the row
+     *               has no valid runs.
+     *
+     * @return       The row's runs, sorted by position and covering the whole
+     *               row, or nullptr if the row is out of bounds or its runs
+     *               are invalid.
+     */
+    const PixelRun* getRowRuns(const size_t yPos, size_t& count)
+            const override;
+
+private:
+    /**
+     * @brief  Checks that the mapped file holds a valid raw image.
+     *
+     * @return  Whether the header is valid, and all pixel data and the
+     *          whole alpha run index are within the file.
+     */
+    bool isValid() const;
+
+    /**
+     * @brief  Gets the address of a mapped image pixel.
+     *
+     * @param xPos  The pixel's x-coordinate, which must be within the image.
+     *
+     * @param yPos  The pixel's y-coordinate, which must be within the image.
+     *
+     * @return      The address of the pixel's first byte.
+     */
+    const uint8_t* getPixelData(const size_t xPos, const size_t yPos) const;
+
+    // The mapped image file:
+    const uint8_t* fileData = nullptr;
+    size_t fileSize = 0;
+    // The file's header, at the start of the mapped file:
+    const RawImageFormat::Header* header = nullptr;
+    // The first run index of each row, followed by the total run count:
+    const uint32_t* rowRuns = nullptr;
+    // Every alpha run in the image:
+    const PixelRun* runs = nullptr;
+    // Image dimensions, or zero if the file couldn't be loaded:
+    size_t width = 0;
+    size_t height = 0;
+};
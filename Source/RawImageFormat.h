@@ -0,0 +1,75 @@
+/**
+ * @file  RawImageFormat.h
+ *
+ * @brief  Defines the layout of raw image files, which hold pixels ready to
+ *         be mapped into memory and used without decoding.
+ */
+
+#pragma once
+#include "PixelRun.h"
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * @brief  Raw image files start with a Header, followed by padding up to the
+ *         first row of pixel data, then the alpha run index.
+ *
+ *  Every value is stored in native (little-endian) byte order. Pixel rows
+ * start at the header's pixelOffset, and are separated by stride bytes. Both
+ * are multiples of rowAlignment, so mapped rows keep the alignment of the
+ * mapped pages.
+ *
+ *  The alpha run index starts at runIndexOffset with height + 1 uint32_t
+ * values. Each holds the index of a row's first PixelRun, and the last holds
+ * the total number of runs. All PixelRun values follow, row by row, with
+ * each row's runs sorted by position and covering the whole row.
+ */
+namespace FBPainter
+{
+    namespace RawImageFormat
+    {
+        // The first bytes of every raw image file:
+        static const constexpr char magic[8]
+                = { 'F', 'B', 'P', 'R', 'A', 'W', '\0', '\0' };
+        // The file layout version described here:
+        static const constexpr uint32_t version = 1;
+        // Pixel data and each pixel row start on a multiple of this many
+        // bytes:
+        static const constexpr size_t rowAlignment = 64;
+
+        /**
+         * @brief  Layouts of the pixels stored in raw image files.
+         */
+        enum class PixelLayout : uint32_t
+        {
+            // Four bytes per pixel: red, green, blue, and unscaled alpha.
+            RGBA = 1,
+            // 32-bit 0xAARRGGBB values, with color scaled by alpha.
+            PremultipliedARGB = 2
+        };
+
+        /**
+         * @brief  The header at the start of every raw image file.
+         */
+        struct Header
+        {
+            // Always matches RawImageFormat::magic:
+            char magic[8];
+            // The file layout version:
+            uint32_t version;
+            // Image dimensions in pixels:
+            uint32_t width;
+            uint32_t height;
+            // The number of bytes between the start of each pixel row:
+            uint32_t stride;
+            // The PixelLayout of all stored pixels:
+            uint32_t pixelLayout;
+            // The total number of PixelRun values in the run index:
+            uint32_t runCount;
+            // The file offset of the first pixel row:
+            uint64_t pixelOffset;
+            // The file offset of the alpha run index:
+            uint64_t runIndexOffset;
+        };
+    }
+}
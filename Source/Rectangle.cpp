@@ -0,0 +1,180 @@
+#include "Rectangle.h"
+#include <algorithm>
+
+
+// Creates a rectangle with a given position and size.
+FBPainter::Rectangle::Rectangle
+(const int x, const int y, const int width, const int height) :
+    x(x), y(y), width(width), height(height) { }
+
+
+// Gets the x-coordinate of the rectangle's left edge.
+int FBPainter::Rectangle::getLeft() const
+{
+    return x;
+}
+
+
+// Gets the y-coordinate of the rectangle's top edge.
+int FBPainter::Rectangle::getTop() const
+{
+    return y;
+}
+
+
+// Gets the x-coordinate just past the rectangle's right edge.
+int FBPainter::Rectangle::getRight() const
+{
+    return x + width;
+}
+
+
+// Gets the y-coordinate just past the rectangle's bottom edge.
+int FBPainter::Rectangle::getBottom() const
+{
+    return y + height;
+}
+
+
+// Gets the rectangle's width.
+int FBPainter::Rectangle::getWidth() const
+{
+    return width;
+}
+
+
+// Gets the rectangle's height.
+int FBPainter::Rectangle::getHeight() const
+{
+    return height;
+}
+
+
+// Checks if the rectangle contains no pixels.
+bool FBPainter::Rectangle::isEmpty() const
+{
+    return width <= 0 || height <= 0;
+}
+
+
+// Checks if a point is within the rectangle.
+bool FBPainter::Rectangle::contains(const int xPos, const int yPos) const
+{
+    return xPos >= x && yPos >= y && xPos < getRight() && yPos < getBottom();
+}
+
+
+// Checks if another rectangle is completely within this one.
+bool FBPainter::Rectangle::contains(const Rectangle& other) const
+{
+    if (other.isEmpty())
+    {
+        return true;
+    }
+    return other.x >= x && other.y >= y && other.getRight() <= getRight()
+            && other.getBottom() <= getBottom();
+}
+
+
+// Checks if this rectangle shares any pixels with another.
+bool FBPainter::Rectangle::intersects(const Rectangle& other) const
+{
+    return ! getIntersection(other).isEmpty();
+}
+
+
+// Gets the area shared by this rectangle and another.
+FBPainter::Rectangle FBPainter::Rectangle::getIntersection
+(const Rectangle& other) const
+{
+    const int left = std::max(x, other.x);
+    const int top = std::max(y, other.y);
+    const int right = std::min(getRight(), other.getRight());
+    const int bottom = std::min(getBottom(), other.getBottom());
+    if (right <= left || bottom <= top)
+    {
+        return Rectangle();
+    }
+    return Rectangle(left, top, right - left, bottom - top);
+}
+
+
+// Gets the smallest rectangle containing both this rectangle and another.
+FBPainter::Rectangle FBPainter::Rectangle::getUnion
+(const Rectangle& other) const
+{
+    if (other.isEmpty())
+    {
+        return *this;
+    }
+    if (isEmpty())
+    {
+        return other;
+    }
+    const int left = std::min(x, other.x);
+    const int top = std::min(y, other.y);
+    const int right = std::max(getRight(), other.getRight());
+    const int bottom = std::max(getBottom(), other.getBottom());
+    return Rectangle(left, top, right - left, bottom - top);
+}
+
+
+// Gets the parts of this rectangle that are not within another.
+std::vector<FBPainter::Rectangle> FBPainter::Rectangle::getDifference
+(const Rectangle& other) const
+{
+    std::vector<Rectangle> parts;
+    const Rectangle overlap = getIntersection(other);
+    if (overlap.isEmpty())
+    {
+        if (! isEmpty())
+        {
+            parts.push_back(*this);
+        }
+        return parts;
+    }
+    const Rectangle strips[] =
+    {
+        Rectangle(x, y, width, overlap.y - y),
+        Rectangle(x, overlap.getBottom(), width,
+                getBottom() - overlap.getBottom()),
+        Rectangle(x, overlap.y, overlap.x - x, overlap.height),
+        Rectangle(overlap.getRight(), overlap.y,
+                getRight() - overlap.getRight(), overlap.height)
+    };
+    for (const Rectangle& strip : strips)
+    {
+        if (! strip.isEmpty())
+        {
+            parts.push_back(strip);
+        }
+    }
+    return parts;
+}
+
+
+// Gets a copy of this rectangle moved by an offset.
+FBPainter::Rectangle FBPainter::Rectangle::getTranslated
+(const int xOffset, const int yOffset) const
+{
+    return Rectangle(x + xOffset, y + yOffset, width, height);
+}
+
+
+// Checks if two rectangles are equivalent.
+bool FBPainter::Rectangle::operator==(const Rectangle& rhs) const
+{
+    if (isEmpty())
+    {
+        return rhs.isEmpty();
+    }
+    return x == rhs.x && y == rhs.y && width == rhs.width
+            && height == rhs.height;
+}
+
+
+// Checks if two rectangles are not equivalent.
+bool FBPainter::Rectangle::operator!=(const Rectangle& rhs) const
+{
+    return ! (*this == rhs);
+}
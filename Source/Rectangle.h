@@ -0,0 +1,193 @@
+/**
+ * @file  Rectangle.h
+ *
+ * @brief  Represents a rectangular area using signed pixel coordinates.
+ */
+
+#pragma once
+#include <vector>
+
+namespace FBPainter
+{
+    class Rectangle;
+}
+
+/**
+ * @brief  An axis-aligned rectangle, defined by the coordinates of its top
+ *         left corner and its size.
+ *
+ *  Coordinates may be negative or extend past the edges of the frame buffer,
+ * so rectangles can describe images that are only partially visible.
+ * Rectangles with zero or negative width or height are empty.
+ */
+class FBPainter::Rectangle
+{
+public:
+    /**
+     * @brief  Creates a rectangle with a given position and size.
+     *
+     * @param x       The x-coordinate of the rectangle's top left corner.
+     *
+     * @param y       The y-coordinate of the rectangle's top left corner.
+     *
+     * @param width   The rectangle's width in pixels.
+     *
+     * @param height  The rectangle's height in pixels.
+     */
+    Rectangle(const int x, const int y, const int width, const int height);
+
+    /**
+     * @brief  Creates an empty rectangle at the origin.
+     */
+    Rectangle() { }
+
+    /**
+     * @brief  Gets the x-coordinate of the rectangle's left edge.
+     *
+     * @return  The leftmost x-coordinate within the rectangle.
+     */
+    int getLeft() const;
+
+    /**
+     * @brief  Gets the y-coordinate of the rectangle's top edge.
+     *
+     * @return  The topmost y-coordinate within the rectangle.
+     */
+    int getTop() const;
+
+    /**
+     * @brief  Gets the x-coordinate just past the rectangle's right edge.
+     *
+     * @return  The x-coordinate of the first column to the right of the
+     *          rectangle.
+     */
+    int getRight() const;
+
+    /**
+     * @brief  Gets the y-coordinate just past the rectangle's bottom edge.
+     *
+     * @return  The y-coordinate of the first row below the rectangle.
+     */
+    int getBottom() const;
+
+    /**
+     * @brief  Gets the rectangle's width.
+     *
+     * @return  The width in pixels.
+     */
+    int getWidth() const;
+
+    /**
+     * @brief  Gets the rectangle's height.
+     *
+     * @return  The height in pixels.
+     */
+    int getHeight() const;
+
+    /**
+     * @brief  Checks if the rectangle contains no pixels.
+     *
+     * @return  Whether the width or height is less than one.
+     */
+    bool isEmpty() const;
+
+    /**
+     * @brief  Checks if a point is within the rectangle.
+     *
+     * @param xPos  The point's x-coordinate.
+     *
+     * @param yPos  The point's y-coordinate.
+     *
+     * @return      Whether the point is inside the rectangle.
+     */
+    bool contains(const int xPos, const int yPos) const;
+
+    /**
+     * @brief  Checks if another rectangle is completely within this one.
+     *
+     * @param other  Another rectangle.
+     *
+     * @return       Whether every pixel in the other rectangle is also in
+     *               this rectangle. Empty rectangles are contained by all
+     *               rectangles.
+     */
+    bool contains(const Rectangle& other) const;
+
+    /**
+     * @brief  Checks if this rectangle shares any pixels with another.
+     *
+     * @param other  Another rectangle.
+     *
+     * @return       Whether the two rectangles overlap.
+     */
+    bool intersects(const Rectangle& other) const;
+
+    /**
+     * @brief  Gets the area shared by this rectangle and another.
+     *
+     * @param other  Another rectangle.
+     *
+     * @return       The overlapping area, or an empty rectangle if the two
+     *               rectangles do not overlap.
+     */
+    Rectangle getIntersection(const Rectangle& other) const;
+
+    /**
+     * @brief  Gets the smallest rectangle containing both this rectangle and
+     *         another.
+     *
+     * @param other  Another rectangle.
+     *
+     * @return       The bounding rectangle of both rectangles. Empty
+     *               rectangles are ignored.
+     */
+    Rectangle getUnion(const Rectangle& other) const;
+
+    /**
+     * @brief  Gets the parts of this rectangle that are not within another.
+     *
+     * @param other  Another rectangle.
+     *
+     * @return       Up to four non-overlapping rectangles that together cover
+     *               every pixel in this rectangle and not in the other. Full
+     *               width strips above and below the other rectangle come
+     *               first, followed by strips to its left and right.
+     */
+    std::vector<Rectangle> getDifference(const Rectangle& other) const;
+
+    /**
+     * @brief  Gets a copy of this rectangle moved by an offset.
+     *
+     * @param xOffset  The distance to move along the x-axis.
+     *
+     * @param yOffset  The distance to move along the y-axis.
+     *
+     * @return         The moved rectangle.
+     */
+    Rectangle getTranslated(const int xOffset, const int yOffset) const;
+
+    /**
+     * @brief  Checks if two rectangles are equivalent.
+     *
+     * @param rhs  Another rectangle to compare with this one.
+     *
+     * @return     True if both rectangles are empty, or if both have the same
+     *             position and size.
+     */
+    bool operator==(const Rectangle& rhs) const;
+
+    /**
+     * @brief  Checks if two rectangles are not equivalent.
+     *
+     * @param rhs  Another rectangle to compare with this one.
+     *
+     * @return     Whether the rectangles cover different areas.
+     */
+    bool operator!=(const Rectangle& rhs) const;
+
+private:
+    int x = 0;
+    int y = 0;
+    int width = 0;
+    int height = 0;
+};
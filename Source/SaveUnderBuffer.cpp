@@ -0,0 +1,433 @@
+#include "SaveUnderBuffer.h"
+#include <algorithm>
+#include <cstring>
+#include <new>
+
+// Number of validity bits in each bitmap word:
+static const constexpr size_t bitsPerWord = 64;
+
+
+// Gets a bitmap word with its lowest bits set.
+static inline uint64_t lowBits(const size_t count)
+{
+    return (count >= bitsPerWord) ? ~(uint64_t) 0
+            : (((uint64_t) 1 << count) - 1);
+}
+
+
+// Copies a range of bits into the start of another bitmap.
+static void readBits(const uint64_t* bits, const size_t first,
+        const size_t count, uint64_t* dest)
+{
+    const size_t words = (count + bitsPerWord - 1) / bitsPerWord;
+    const size_t word = first / bitsPerWord;
+    const size_t offset = first % bitsPerWord;
+    for (size_t i = 0; i < words; i++)
+    {
+        uint64_t value = bits[word + i] >> offset;
+        // Only read the next word if the range continues into it:
+        if (offset != 0 && i * bitsPerWord + (bitsPerWord - offset) < count)
+        {
+            value |= bits[word + i + 1] << (bitsPerWord - offset);
+        }
+        dest[i] = value;
+    }
+    if (count % bitsPerWord != 0)
+    {
+        dest[words - 1] &= lowBits(count % bitsPerWord);
+    }
+}
+
+
+// Sets bits within a range of a bitmap, copying them from the start of
+// another bitmap.
+static void writeBits(uint64_t* bits, const size_t first, const size_t count,
+        const uint64_t* source)
+{
+    const size_t words = (count + bitsPerWord - 1) / bitsPerWord;
+    const size_t word = first / bitsPerWord;
+    const size_t offset = first % bitsPerWord;
+    for (size_t i = 0; i < words; i++)
+    {
+        const uint64_t value = source[i];
+        bits[word + i] |= value << offset;
+        if (offset != 0 && (value >> (bitsPerWord - offset)) != 0)
+        {
+            bits[word + i + 1] |= value >> (bitsPerWord - offset);
+        }
+    }
+}
+
+// Allocates storage covering a range of columns in each image row,
+// discarding all saved pixels.
+bool FBPainter::SaveUnderBuffer::allocate
+(const std::vector<size_t>& firstColumns,
+        const std::vector<size_t>& lastColumns)
+{
+    const size_t height = std::min(firstColumns.size(), lastColumns.size());
+    try
+    {
+        rows.assign(height, RowSpan());
+        size_t bitmapWords = 0;
+        size_t maxRowWords = 0;
+        storedPixels = 0;
+        for (size_t y = 0; y < height; y++)
+        {
+            const bool covered = firstColumns[y] <= lastColumns[y];
+            RowSpan& row = rows[y];
+            row.start = covered ? firstColumns[y] : 0;
+            row.length = covered ? (lastColumns[y] - firstColumns[y] + 1) : 0;
+            row.offset = storedPixels;
+            row.bitmapOffset = bitmapWords;
+            storedPixels += row.length;
+            const size_t rowWords = (row.length + bitsPerWord - 1)
+                    / bitsPerWord;
+            bitmapWords += rowWords;
+            maxRowWords = std::max(maxRowWords, rowWords);
+        }
+        validBits.assign(bitmapWords, 0);
+        shiftedBits.assign(maxRowWords, 0);
+        shortValues.clear();
+        wordValues.clear();
+        if (pixelFormat == PixelFormat::RGB565)
+        {
+            shortValues.resize(storedPixels);
+        }
+        else
+        {
+            wordValues.resize(storedPixels);
+        }
+    }
+    catch (const std::bad_alloc&)
+    {
+        rows.clear();
+        validBits.clear();
+        shiftedBits.clear();
+        shortValues.clear();
+        wordValues.clear();
+        storedPixels = 0;
+        return false;
+    }
+    return true;
+}
+
+
+// Gets the pixel format of the saved pixel values.
+FBPainter::PixelFormat FBPainter::SaveUnderBuffer::getPixelFormat() const
+{
+    return pixelFormat;
+}
+
+
+// Changes the pixel format of saved pixel values, converting any pixels
+// already saved.
+void FBPainter::SaveUnderBuffer::setPixelFormat(const PixelFormat format)
+{
+    if (format == pixelFormat)
+    {
+        return;
+    }
+    const PixelConverter* newConverter = PixelConverter::forFormat(format);
+    std::vector<uint32_t> converted(storedPixels);
+    for (size_t i = 0; i < storedPixels; i++)
+    {
+        uint32_t value = shortValues.empty() ? wordValues[i] : shortValues[i];
+        if (converter != nullptr)
+        {
+            value = converter->unpackColor(value);
+        }
+        converted[i] = (newConverter != nullptr)
+                ? newConverter->packColor(value) : value;
+    }
+    if (format == PixelFormat::RGB565)
+    {
+        shortValues.assign(converted.begin(), converted.end());
+        wordValues.clear();
+        wordValues.shrink_to_fit();
+    }
+    else
+    {
+        wordValues.swap(converted);
+        shortValues.clear();
+        shortValues.shrink_to_fit();
+    }
+    pixelFormat = format;
+    converter = newConverter;
+}
+
+
+// Checks if a pixel is saved at an image coordinate.
+bool FBPainter::SaveUnderBuffer::isSaved(const size_t xPos, const size_t yPos)
+        const
+{
+    const size_t index = storageIndex(xPos, yPos);
+    if (index == npos)
+    {
+        return false;
+    }
+    const size_t bit = validBit(yPos, index);
+    return (validBits[bit / bitsPerWord] >> (bit % bitsPerWord)) & 1;
+}
+
+
+// Gets the pixel saved at an image coordinate.
+uint32_t FBPainter::SaveUnderBuffer::getPixel(const size_t xPos,
+        const size_t yPos) const
+{
+    if (! isSaved(xPos, yPos))
+    {
+        return 0;
+    }
+    const size_t index = storageIndex(xPos, yPos);
+    return shortValues.empty() ? wordValues[index] : shortValues[index];
+}
+
+
+// Gets the pixel saved at an image coordinate as a color value.
+uint32_t FBPainter::SaveUnderBuffer::getColor(const size_t xPos,
+        const size_t yPos) const
+{
+    const uint32_t value = getPixel(xPos, yPos);
+    return (converter != nullptr) ? converter->unpackColor(value) : value;
+}
+
+
+// Saves a color value at an image coordinate, converting it to the buffer's
+// pixel format.
+void FBPainter::SaveUnderBuffer::saveColor(const size_t xPos,
+        const size_t yPos, const uint32_t rgb)
+{
+    savePixel(xPos, yPos, (converter != nullptr)
+            ? converter->packColor(rgb) : rgb);
+}
+
+
+// Saves a pixel at an image coordinate.
+void FBPainter::SaveUnderBuffer::savePixel(const size_t xPos,
+        const size_t yPos, const uint32_t value)
+{
+    const size_t index = storageIndex(xPos, yPos);
+    if (index == npos)
+    {
+        return;
+    }
+    if (shortValues.empty())
+    {
+        wordValues[index] = value;
+    }
+    else
+    {
+        shortValues[index] = value;
+    }
+    const size_t bit = validBit(yPos, index);
+    validBits[bit / bitsPerWord] |= (uint64_t) 1 << (bit % bitsPerWord);
+}
+
+
+// Discards all saved pixels within part of one row.
+void FBPainter::SaveUnderBuffer::discardPixels(const size_t xStart,
+        const size_t xEnd, const size_t yPos)
+{
+    if (yPos >= rows.size())
+    {
+        return;
+    }
+    const RowSpan& row = rows[yPos];
+    const size_t first = std::max(xStart, row.start);
+    const size_t last = std::min(xEnd, row.start + row.length);
+    size_t bit = row.bitmapOffset * bitsPerWord + (first - row.start);
+    for (size_t count = (first < last) ? (last - first) : 0; count > 0; )
+    {
+        const size_t offset = bit % bitsPerWord;
+        const size_t wordCount = std::min(count, bitsPerWord - offset);
+        validBits[bit / bitsPerWord] &= ~(lowBits(wordCount) << offset);
+        bit += wordCount;
+        count -= wordCount;
+    }
+}
+
+
+// Finds the first saved pixel within part of one row.
+size_t FBPainter::SaveUnderBuffer::findSaved(const size_t xStart,
+        const size_t xEnd, const size_t yPos) const
+{
+    return findPixel(xStart, xEnd, yPos, true);
+}
+
+
+// Finds the first pixel within part of one row that isn't saved.
+size_t FBPainter::SaveUnderBuffer::findUnsaved(const size_t xStart,
+        const size_t xEnd, const size_t yPos) const
+{
+    return findPixel(xStart, xEnd, yPos, false);
+}
+
+
+// Copies a run of saved pixels, packed as frame buffer pixels.
+void FBPainter::SaveUnderBuffer::copyPixels(const size_t xStart,
+        const size_t count, const size_t yPos, uint8_t* dest) const
+{
+    const size_t index = storageIndex(xStart, yPos);
+    if (index == npos || count == 0)
+    {
+        return;
+    }
+    const size_t bytesPerPixel = getBytesPerPixel(pixelFormat);
+    if (! shortValues.empty())
+    {
+        memcpy(dest, shortValues.data() + index, count * sizeof(uint16_t));
+    }
+    else if (bytesPerPixel == sizeof(uint32_t))
+    {
+        memcpy(dest, wordValues.data() + index, count * sizeof(uint32_t));
+    }
+    else
+    {
+        // Saved values hold each pixel in their lowest bytes:
+        for (size_t i = 0; i < count; i++)
+        {
+            memcpy(dest + i * bytesPerPixel, &wordValues[index + i],
+                    bytesPerPixel);
+        }
+    }
+}
+
+
+// Moves saved pixels to follow a change in image origin.
+void FBPainter::SaveUnderBuffer::shift(const int xOffset, const int yOffset)
+{
+    const size_t height = rows.size();
+    for (size_t i = 0; i < height; i++)
+    {
+        // Visit rows in an order where each source row is read before it's
+        // replaced:
+        const size_t y = (yOffset > 0) ? i : (height - 1 - i);
+        const RowSpan& row = rows[y];
+        if (row.length == 0)
+        {
+            continue;
+        }
+        const int64_t sourceY = static_cast<int64_t>(y) + yOffset;
+        size_t count = 0;
+        size_t destColumn = 0;
+        if (sourceY >= 0 && sourceY < static_cast<int64_t>(height))
+        {
+            const RowSpan& source = rows[sourceY];
+            // Find the destination columns covered by the source row's span:
+            const int64_t first = std::max<int64_t>(row.start,
+                    static_cast<int64_t>(source.start) - xOffset);
+            const int64_t last = std::min<int64_t>(row.start + row.length,
+                    static_cast<int64_t>(source.start + source.length)
+                    - xOffset);
+            if (first < last)
+            {
+                count = last - first;
+                destColumn = first - row.start;
+                const size_t sourceColumn = first + xOffset - source.start;
+                if (shortValues.empty())
+                {
+                    memmove(wordValues.data() + row.offset + destColumn,
+                            wordValues.data() + source.offset + sourceColumn,
+                            count * sizeof(uint32_t));
+                }
+                else
+                {
+                    memmove(shortValues.data() + row.offset + destColumn,
+                            shortValues.data() + source.offset + sourceColumn,
+                            count * sizeof(uint16_t));
+                }
+                readBits(validBits.data(), source.bitmapOffset * bitsPerWord
+                        + sourceColumn, count, shiftedBits.data());
+            }
+        }
+        uint64_t* const rowBits = validBits.data() + row.bitmapOffset;
+        std::fill(rowBits, rowBits + (row.length + bitsPerWord - 1)
+                / bitsPerWord, 0);
+        if (count > 0)
+        {
+            writeBits(rowBits, destColumn, count, shiftedBits.data());
+        }
+    }
+}
+
+
+// Discards all saved pixels.
+void FBPainter::SaveUnderBuffer::clear()
+{
+    std::fill(validBits.begin(), validBits.end(), 0);
+}
+
+
+// Finds where a pixel is stored.
+size_t FBPainter::SaveUnderBuffer::storageIndex(const size_t xPos,
+        const size_t yPos) const
+{
+    if (yPos >= rows.size())
+    {
+        return npos;
+    }
+    const RowSpan& row = rows[yPos];
+    // Coordinates left of the span wrap around to large values:
+    const size_t column = xPos - row.start;
+    if (column >= row.length)
+    {
+        return npos;
+    }
+    return row.offset + column;
+}
+
+
+// Finds the first pixel within part of one row that is or isn't saved.
+size_t FBPainter::SaveUnderBuffer::findPixel(const size_t xStart,
+        const size_t xEnd, const size_t yPos, const bool saved) const
+{
+    if (xStart >= xEnd)
+    {
+        return xEnd;
+    }
+    if (yPos >= rows.size())
+    {
+        return saved ? xEnd : xStart;
+    }
+    const RowSpan& row = rows[yPos];
+    const size_t spanEnd = row.start + row.length;
+    // Pixels outside of the stored span are never saved:
+    if (! saved && (xStart < row.start || xStart >= spanEnd))
+    {
+        return xStart;
+    }
+    const size_t first = std::max(xStart, row.start);
+    const size_t last = std::min(xEnd, spanEnd);
+    const size_t firstBit = row.bitmapOffset * bitsPerWord
+            + (first - row.start);
+    const size_t endBit = firstBit + ((first < last) ? (last - first) : 0);
+    for (size_t bit = firstBit; bit < endBit;
+            bit = (bit / bitsPerWord + 1) * bitsPerWord)
+    {
+        uint64_t word = validBits[bit / bitsPerWord];
+        if (! saved)
+        {
+            word = ~word;
+        }
+        word >>= bit % bitsPerWord;
+        if (word != 0)
+        {
+            const size_t found = bit + __builtin_ctzll(word);
+            if (found < endBit)
+            {
+                return first + (found - firstBit);
+            }
+            break;
+        }
+    }
+    return saved ? xEnd : last;
+}
+
+
+// Finds the validity bit for a stored pixel.
+size_t FBPainter::SaveUnderBuffer::validBit(const size_t yPos,
+        const size_t index) const
+{
+    const RowSpan& row = rows[yPos];
+    return row.bitmapOffset * bitsPerWord + (index - row.offset);
+}
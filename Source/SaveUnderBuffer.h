@@ -0,0 +1,290 @@
+/**
+ * @file  SaveUnderBuffer.h
+ *
+ * @brief  Stores the frame buffer pixels an image has drawn over.
+ */
+
+#pragma once
+#include "PixelFormat.h"
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+namespace FBPainter
+{
+    class SaveUnderBuffer;
+}
+
+/**
+ * @brief  Holds saved frame buffer pixels for each image coordinate, packed
+ *         in the frame buffer's own pixel format.
+ *
+ *  Storage only covers the span of each image row between its first and last
+ * non-transparent pixels, so fully transparent rows and transparent margins
+ * take no memory. Each stored pixel takes two bytes for RGB565 frame buffers
+ * and four bytes otherwise, and a separate bitmap records which stored pixels
+ * hold saved data.
+ *
+ *  Each row's data and validity bits are kept apart from every other row's,
+ * so different rows may be updated from multiple threads at once.
+ */
+class FBPainter::SaveUnderBuffer
+{
+public:
+    SaveUnderBuffer() { }
+
+    /**
+     * @brief  Allocates storage covering a range of columns in each image
+     *         row, discarding all saved pixels.
+     *
+     * @param firstColumns  The first covered x-coordinate in each image row.
+     *
+     * @param lastColumns   The last covered x-coordinate in each image row.
+     *                      Rows where this is less than the first column are
+     *                      never covered.
+     *
+     * @return              Whether the storage was allocated successfully.
+     */
+    bool allocate(const std::vector<size_t>& firstColumns,
+            const std::vector<size_t>& lastColumns);
+
+    /**
+     * @brief  Gets the pixel format of the saved pixel values.
+     *
+     * @return  The format of values passed to savePixel and returned by
+     *          getPixel.
+     */
+    PixelFormat getPixelFormat() const;
+
+    /**
+     * @brief  Changes the pixel format of saved pixel values, converting any
+     *         pixels already saved.
+     *
+     * @param format  The pixel format of the frame buffer that pixels will
+     *                be saved from.
+     */
+    void setPixelFormat(const PixelFormat format);
+
+    /**
+     * @brief  Checks if a pixel is saved at an image coordinate.
+     *
+     * @param xPos  The image x-coordinate.
+     *
+     * @param yPos  The image y-coordinate.
+     *
+     * @return      Whether a saved pixel exists at that coordinate.
+     */
+    bool isSaved(const size_t xPos, const size_t yPos) const;
+
+    /**
+     * @brief  Gets the pixel saved at an image coordinate.
+     *
+     * @param xPos  The image x-coordinate.
+     *
+     * @param yPos  The image y-coordinate.
+     *
+     * @return      The saved pixel value in the buffer's pixel format, or
+     *              zero if no pixel is saved there.
+     */
+    uint32_t getPixel(const size_t xPos, const size_t yPos) const;
+
+    /**
+     * @brief  Saves a pixel at an image coordinate.
+     *
+     *  Coordinates outside of the stored span of their row are ignored, as
+     * the image never covers those pixels.
+     *
+     * @param xPos   The image x-coordinate.
+     *
+     * @param yPos   The image y-coordinate.
+     *
+     * @param value  The pixel value in the buffer's pixel format.
+     */
+    void savePixel(const size_t xPos, const size_t yPos, const uint32_t value);
+
+    /**
+     * @brief  Gets the pixel saved at an image coordinate as a color value.
+     *
+     * @param xPos  The image x-coordinate.
+     *
+     * @param yPos  The image y-coordinate.
+     *
+     * @return      The saved pixel as a 0x00RRGGBB color value, or zero if no
+     *              pixel is saved there.
+     */
+    uint32_t getColor(const size_t xPos, const size_t yPos) const;
+
+    /**
+     * @brief  Saves a color value at an image coordinate, converting it to
+     *         the buffer's pixel format.
+     *
+     * @param xPos  The image x-coordinate.
+     *
+     * @param yPos  The image y-coordinate.
+     *
+     * @param rgb   The 0x00RRGGBB color value to save.
+     */
+    void saveColor(const size_t xPos, const size_t yPos, const uint32_t rgb);
+
+    /**
+     * @brief  Discards all saved pixels within part of one row.
+     *
+     * @param xStart  The image x-coordinate of the first pixel to discard.
+     *
+     * @param xEnd    The image x-coordinate after the last pixel to discard.
+     *
+     * @param yPos    The image y-coordinate of the row.
+     */
+    void discardPixels(const size_t xStart, const size_t xEnd,
+            const size_t yPos);
+
+    /**
+     * @brief  Finds the first saved pixel within part of one row.
+     *
+     *  Validity bits are checked a whole word at a time, so long runs of
+     * pixels that aren't saved are skipped quickly.
+     *
+     * @param xStart  The image x-coordinate where the search starts.
+     *
+     * @param xEnd    The image x-coordinate where the search ends.
+     *
+     * @param yPos    The image y-coordinate of the row.
+     *
+     * @return        The x-coordinate of the first saved pixel, or xEnd if
+     *                no pixel in the range is saved.
+     */
+    size_t findSaved(const size_t xStart, const size_t xEnd,
+            const size_t yPos) const;
+
+    /**
+     * @brief  Finds the first pixel within part of one row that isn't saved.
+     *
+     * @param xStart  The image x-coordinate where the search starts.
+     *
+     * @param xEnd    The image x-coordinate where the search ends.
+     *
+     * @param yPos    The image y-coordinate of the row.
+     *
+     * @return        The x-coordinate of the first pixel without saved data,
+     *                or xEnd if every pixel in the range is saved.
+     */
+    size_t findUnsaved(const size_t xStart, const size_t xEnd,
+            const size_t yPos) const;
+
+    /**
+     * @brief  Copies a run of saved pixels, packed as frame buffer pixels.
+     *
+     * @param xStart  The image x-coordinate of the first pixel to copy. Every
+     *                pixel in the run must be saved.
+     *
+     * @param count   The number of pixels to copy.
+     *
+     * @param yPos    The image y-coordinate of the row.
+     *
+     * @param dest    Memory with room for count pixels in the buffer's pixel
+     *                format.
+     */
+    void copyPixels(const size_t xStart, const size_t count, const size_t yPos,
+            uint8_t* dest) const;
+
+    /**
+     * @brief  Moves saved pixels to follow a change in image origin, so each
+     *         saved pixel stays with the frame buffer coordinate it came from.
+     *
+     *  Each row's pixel values are moved with one copy, and its validity bits
+     * a word at a time. Saved pixels moved outside of their new row's stored
+     * span are discarded, as are coordinates that had no saved pixel to
+     * receive.
+     *
+     * @param xOffset  The change in the image origin's x-coordinate. Each
+     *                 pixel saved at (x + xOffset, y + yOffset) moves to
+     *                 (x, y).
+     *
+     * @param yOffset  The change in the image origin's y-coordinate.
+     */
+    void shift(const int xOffset, const int yOffset);
+
+    /**
+     * @brief  Discards all saved pixels.
+     */
+    void clear();
+
+private:
+    /**
+     * @brief  Finds where a pixel is stored.
+     *
+     * @param xPos  The image x-coordinate.
+     *
+     * @param yPos  The image y-coordinate.
+     *
+     * @return      The pixel's storage index, or SaveUnderBuffer::npos if the
+     *              coordinate isn't stored.
+     */
+    size_t storageIndex(const size_t xPos, const size_t yPos) const;
+
+    /**
+     * @brief  Finds the first pixel within part of one row that is or isn't
+     *         saved.
+     *
+     * @param xStart  The image x-coordinate where the search starts.
+     *
+     * @param xEnd    The image x-coordinate where the search ends.
+     *
+     * @param yPos    The image y-coordinate of the row.
+     *
+     * @param saved   Whether to find a saved pixel or a pixel without saved
+     *                data.
+     *
+     * @return        The x-coordinate of the first matching pixel, or xEnd if
+     *                no pixel in the range matches.
+     */
+    size_t findPixel(const size_t xStart, const size_t xEnd, const size_t yPos,
+            const bool saved) const;
+
+    /**
+     * @brief  Finds the validity bit for a stored pixel.
+     *
+     * @param yPos   The image y-coordinate of the stored pixel.
+     *
+     * @param index  The pixel's storage index.
+     *
+     * @return       The bit's index within the validity bitmap.
+     */
+    size_t validBit(const size_t yPos, const size_t index) const;
+
+    // Represents an invalid index:
+    static const constexpr size_t npos = static_cast<size_t>(-1);
+
+    /**
+     * @brief  The stored span of one image row.
+     */
+    struct RowSpan
+    {
+        // The image x-coordinate of the first stored pixel:
+        size_t start;
+        // The number of stored pixels:
+        size_t length;
+        // The storage index of the first stored pixel:
+        size_t offset;
+        // The index of the row's first bitmap word:
+        size_t bitmapOffset;
+    };
+    std::vector<RowSpan> rows;
+
+    // Saved pixel values. Only one of these is used, depending on the pixel
+    // format:
+    std::vector<uint16_t> shortValues;
+    std::vector<uint32_t> wordValues;
+    // One bit per stored pixel, set when the pixel holds saved data. Each row
+    // starts on a new bitmap word:
+    std::vector<uint64_t> validBits;
+    // Holds one row's validity bits while they're shifted:
+    std::vector<uint64_t> shiftedBits;
+    // Total number of stored pixels:
+    size_t storedPixels = 0;
+
+    PixelFormat pixelFormat = PixelFormat::Unknown;
+    // Converts saved values to and from color values, or nullptr if values
+    // are stored as 0x00RRGGBB colors:
+    const PixelConverter* converter = nullptr;
+};
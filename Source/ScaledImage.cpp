@@ -0,0 +1,271 @@
+#include "ScaledImage.h"
+#include "BlendKernels.h"
+#include <algorithm>
+#include <new>
+
+// Source positions use 16.16 fixed-point values:
+static const constexpr int fixedShift = 16;
+// Bilinear weights are fractions of 256:
+static const constexpr int weightShift = 8;
+static const constexpr uint32_t weightMax = 1 << weightShift;
+
+/**
+ * @brief  The two source pixels, and the weight of the second one, used to
+ *         find one bilinear scaled pixel along one axis.
+ */
+struct Sample
+{
+    size_t first;
+    size_t second;
+    uint32_t weight;
+};
+
+
+// Finds the closest source index to the center of each scaled pixel.
+static std::vector<size_t> findNearest(const size_t sourceSize,
+        const size_t scaledSize)
+{
+    std::vector<size_t> indices(scaledSize);
+    const uint64_t step = (static_cast<uint64_t>(sourceSize) << fixedShift)
+            / scaledSize;
+    uint64_t position = step / 2;
+    for (size_t i = 0; i < scaledSize; i++, position += step)
+    {
+        indices[i] = std::min<size_t>(position >> fixedShift, sourceSize - 1);
+    }
+    return indices;
+}
+
+
+// Finds the pair of source indices surrounding the center of each scaled
+// pixel, and how far the center is from the first one.
+static std::vector<Sample> findBilinear(const size_t sourceSize,
+        const size_t scaledSize)
+{
+    std::vector<Sample> samples(scaledSize);
+    const int64_t step = (static_cast<int64_t>(sourceSize) << fixedShift)
+            / scaledSize;
+    // Pixel centers are half a pixel from each pixel's top left corner:
+    int64_t position = step / 2 - (1 << (fixedShift - 1));
+    for (size_t i = 0; i < scaledSize; i++, position += step)
+    {
+        const int64_t clamped = std::max<int64_t>(position, 0);
+        Sample& sample = samples[i];
+        sample.first = clamped >> fixedShift;
+        if (sample.first + 1 >= sourceSize)
+        {
+            sample.first = sourceSize - 1;
+            sample.second = sample.first;
+            sample.weight = 0;
+        }
+        else
+        {
+            sample.second = sample.first + 1;
+            sample.weight = (clamped & ((1 << fixedShift) - 1))
+                    >> (fixedShift - weightShift);
+        }
+    }
+    return samples;
+}
+
+
+// Interpolates between two premultiplied pixels, one byte at a time.
+static inline uint32_t interpolate(const uint32_t first, const uint32_t second,
+        const uint32_t weight)
+{
+    uint32_t result = 0;
+    for (int shift = 0; shift < 32; shift += 8)
+    {
+        const uint32_t firstByte = (first >> shift) & 0xff;
+        const uint32_t secondByte = (second >> shift) & 0xff;
+        result |= ((firstByte * (weightMax - weight) + secondByte * weight
+                + weightMax / 2) >> weightShift) << shift;
+    }
+    return result;
+}
+
+
+// Scales one row of premultiplied pixels horizontally.
+static void scaleRow(const uint32_t* source, const std::vector<Sample>& columns,
+        uint32_t* dest)
+{
+    for (size_t x = 0; x < columns.size(); x++)
+    {
+        const Sample& column = columns[x];
+        dest[x] = interpolate(source[column.first], source[column.second],
+                column.weight);
+    }
+}
+
+
+// Interpolates between two horizontally scaled rows. Each byte is handled
+// separately in one simple loop, so the compiler can use vector
+// instructions.
+static void blendRows(const uint8_t* first, const uint8_t* second,
+        const uint32_t weight, uint8_t* dest, const size_t byteCount)
+{
+    const uint16_t firstWeight = weightMax - weight;
+    const uint16_t secondWeight = weight;
+    for (size_t i = 0; i < byteCount; i++)
+    {
+        dest[i] = (first[i] * firstWeight + second[i] * secondWeight
+                + weightMax / 2) >> weightShift;
+    }
+}
+
+
+// Scales an image on construction.
+FBPainter::ScaledImage::ScaledImage(const Image& source, const size_t width,
+        const size_t height, const ScaleFilter filter)
+{
+    const size_t sourceWidth = source.getWidth();
+    const size_t sourceHeight = source.getHeight();
+    if (width == 0 || height == 0 || sourceWidth == 0 || sourceHeight == 0)
+    {
+        return;
+    }
+    try
+    {
+        std::vector<uint32_t> sourcePixels(sourceWidth * sourceHeight);
+        for (size_t y = 0; y < sourceHeight; y++)
+        {
+            source.readRow(y, 0, sourceWidth,
+                    sourcePixels.data() + y * sourceWidth,
+                    RowFormat::PremultipliedARGB);
+        }
+        pixels.resize(width * height);
+
+        if (filter == ScaleFilter::Nearest)
+        {
+            const std::vector<size_t> columns
+                    = findNearest(sourceWidth, width);
+            const std::vector<size_t> rows = findNearest(sourceHeight, height);
+            for (size_t y = 0; y < height; y++)
+            {
+                const uint32_t* sourceRow = sourcePixels.data()
+                        + rows[y] * sourceWidth;
+                uint32_t* scaledRow = pixels.data() + y * width;
+                for (size_t x = 0; x < width; x++)
+                {
+                    scaledRow[x] = sourceRow[columns[x]];
+                }
+            }
+        }
+        else
+        {
+            const std::vector<Sample> columns
+                    = findBilinear(sourceWidth, width);
+            const std::vector<Sample> rows = findBilinear(sourceHeight, height);
+            // Keep the last two horizontally scaled source rows, as
+            // neighboring scaled rows usually share them:
+            std::vector<uint32_t> scaledRows[2]
+                    = { std::vector<uint32_t>(width),
+                        std::vector<uint32_t>(width) };
+            size_t scaledRowIndex[2] = { sourceHeight, sourceHeight };
+            // Finds or scales a source row, without replacing another row
+            // that's still needed:
+            const auto getScaledRow = [&](const size_t sourceY,
+                    const size_t keptY)
+            {
+                for (int i = 0; i < 2; i++)
+                {
+                    if (scaledRowIndex[i] == sourceY)
+                    {
+                        return scaledRows[i].data();
+                    }
+                }
+                const int slot = (scaledRowIndex[0] == keptY) ? 1 : 0;
+                scaleRow(sourcePixels.data() + sourceY * sourceWidth, columns,
+                        scaledRows[slot].data());
+                scaledRowIndex[slot] = sourceY;
+                return scaledRows[slot].data();
+            };
+            for (size_t y = 0; y < height; y++)
+            {
+                const Sample& row = rows[y];
+                const uint32_t* first = getScaledRow(row.first, row.second);
+                const uint32_t* second = getScaledRow(row.second, row.first);
+                blendRows(reinterpret_cast<const uint8_t*>(first),
+                        reinterpret_cast<const uint8_t*>(second), row.weight,
+                        reinterpret_cast<uint8_t*>(pixels.data() + y * width),
+                        width * sizeof(uint32_t));
+            }
+        }
+    }
+    catch (const std::bad_alloc&)
+    {
+        pixels.clear();
+        return;
+    }
+    this->width = width;
+    this->height = height;
+}
+
+
+// Gets the width of the scaled image.
+size_t FBPainter::ScaledImage::getWidth() const
+{
+    return width;
+}
+
+
+// Gets the height of the scaled image.
+size_t FBPainter::ScaledImage::getHeight() const
+{
+    return height;
+}
+
+
+// Gets pixel color data at a specific image coordinate.
+FBPainter::RGBPixel FBPainter::ScaledImage::getRGBPixel(const size_t xPos,
+        const size_t yPos) const
+{
+    if (xPos >= width || yPos >= height)
+    {
+        return RGBPixel(0, 0, 0);
+    }
+    return getRGBAPixel(xPos, yPos);
+}
+
+
+// Gets pixel color data at a specific image coordinate.
+FBPainter::RGBAPixel FBPainter::ScaledImage::getRGBAPixel(const size_t xPos,
+        const size_t yPos) const
+{
+    if (xPos >= width || yPos >= height)
+    {
+        return RGBAPixel(0, 0, 0, 0);
+    }
+    const uint32_t pixel = unpremultiplyColor(pixels[yPos * width + xPos]);
+    return RGBAPixel(pixel >> 16, pixel >> 8, pixel, pixel >> 24);
+}
+
+
+// Copies a run of pixels from one image row.
+void FBPainter::ScaledImage::readRow(const size_t yPos, const size_t xStart,
+        const size_t count, uint32_t* dest, const RowFormat format) const
+{
+    const size_t inBounds = (yPos < height && xStart < width)
+            ? std::min(count, width - xStart) : 0;
+    if (inBounds > 0)
+    {
+        const uint32_t* row = pixels.data() + yPos * width + xStart;
+        if (format == RowFormat::PremultipliedARGB)
+        {
+            std::copy(row, row + inBounds, dest);
+        }
+        else
+        {
+            std::transform(row, row + inBounds, dest, unpremultiplyColor);
+        }
+    }
+    std::fill(dest + inBounds, dest + count, 0);
+}
+
+
+// Gets direct access to one row of scaled premultiplied pixels.
+const uint32_t* FBPainter::ScaledImage::getPremultipliedRow(const size_t yPos)
+        const
+{
+    return (yPos < height) ? pixels.data() + yPos * width : nullptr;
+}
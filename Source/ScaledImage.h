@@ -0,0 +1,136 @@
+/**
+ * @file  ScaledImage.h
+ *
+ * @brief  An image holding a resized copy of another image.
+ */
+
+#pragma once
+#include "Image.h"
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+namespace FBPainter
+{
+    class ScaledImage;
+
+    /**
+     * @brief  Methods used to resize images.
+     */
+    enum class ScaleFilter
+    {
+        // Copies the closest source pixel. This keeps hard pixel edges.
+        Nearest,
+        // Interpolates between the four closest source pixels. This gives
+        // smoother results when scaling photos or anti-aliased art.
+        Bilinear
+    };
+}
+
+/**
+ * @brief  Resizes an image once on construction, and stores the result.
+ *
+ *  Scaling uses 16.16 fixed-point steps through the source image, and
+ * bilinear filtering interpolates premultiplied colors so transparent pixels
+ * never bleed into their neighbors. As the scaled pixels are stored, an
+ * ImagePainter drawing a ScaledImage costs the same as drawing an unscaled
+ * image of the same size. To draw an image into any destination rectangle,
+ * scale it to the rectangle's size and move its ImagePainter to the
+ * rectangle's origin.
+ */
+class FBPainter::ScaledImage : public Image
+{
+public:
+    /**
+     * @brief  Scales an image on construction.
+     *
+     * @param source  The image to scale. Its pixels are read once, and the
+     *                ScaledImage doesn't keep any reference to it, so one
+     *                source may be scaled to any number of sizes.
+     *
+     * @param width   The scaled image width in pixels.
+     *
+     * @param height  The scaled image height in pixels.
+     *
+     * @param filter  The method used to find scaled pixel colors.
+     */
+    ScaledImage(const Image& source, const size_t width, const size_t height,
+            const ScaleFilter filter = ScaleFilter::Bilinear);
+
+    virtual ~ScaledImage() { }
+
+    /**
+     * @brief  Gets the width of the scaled image.
+     *
+     * @return  The image width in pixels, or zero if the image couldn't be
+     *          scaled.
+     */
+    size_t getWidth() const override;
+
+    /**
+     * @brief  Gets the height of the scaled image.
+     *
+     * @return  The image height in pixels, or zero if the image couldn't be
+     *          scaled.
+     */
+    size_t getHeight() const override;
+
+    /**
+     * @brief  Gets pixel color data at a specific image coordinate.
+     *
+     * @param xPos  The pixel's x-coordinate.
+     *
+     * @param yPos  The pixel's y-coordinate.
+     *
+     * @return      The pixel value at the given coordinate, or
+     *              RGBPixel(0, 0, 0) if the coordinate is out of bounds.
+     */
+    RGBPixel getRGBPixel(const size_t xPos, const size_t yPos) const override;
+
+    /**
+     * @brief  Gets pixel color data at a specific image coordinate.
+     *
+     * @param xPos  The pixel's x-coordinate.
+     *
+     * @param yPos  The pixel's y-coordinate.
+     *
+     * @return      The pixel value at the given coordinate, or
+     *              RGBAPixel(0, 0, 0, 0) if the coordinate is out of bounds.
+     */
+    RGBAPixel getRGBAPixel(const size_t xPos, const size_t yPos)
+            const override;
+
+    /**
+     * @brief  Copies a run of pixels from one image row.
+     *
+     * @param yPos    The y-coordinate of the row to read.
+     *
+     * @param xStart  The x-coordinate of the first pixel to read.
+     *
+     * @param count   The number of pixels to read.
+     *
+     * @param dest    A buffer with room for count pixel values. Pixels
+     *                outside of the image bounds are set to zero.
+     *
+     * @param format  The layout of the pixel values written to dest.
+     */
+    void readRow(const size_t yPos, const size_t xStart, const size_t count,
+            uint32_t* dest, const RowFormat format) const override;
+
+    /**
+     * @brief  Gets direct access to one row of scaled premultiplied pixels.
+     *
+     * @param yPos  The y-coordinate of the row.
+     *
+     * @return      The row's premultiplied 0xAARRGGBB pixels, or nullptr if
+     *              the row is out of bounds.
+     */
+    const uint32_t* getPremultipliedRow(const size_t yPos) const override;
+
+private:
+    // Scaled image dimensions:
+    size_t width = 0;
+    size_t height = 0;
+    // Scaled pixels as premultiplied 0xAARRGGBB values, stored row by row:
+    std::vector<uint32_t> pixels;
+};
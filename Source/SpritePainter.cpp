@@ -0,0 +1,88 @@
+#include "SpritePainter.h"
+#include "DrawContext.h"
+
+// Stores the animation on construction.
+FBPainter::SpritePainter::SpritePainter(AnimatedImage* sprite) :
+        ImagePainter(sprite)
+{
+    // Save pixels under every frame, not just the first:
+    if (getImage() != nullptr && reserveSavedPixels(
+            sprite->getFirstCoveredColumns(),
+            sprite->getLastCoveredColumns()))
+    {
+        this->sprite = sprite;
+    }
+}
+
+
+// Gets the number of animation frames.
+size_t FBPainter::SpritePainter::getFrameCount() const
+{
+    return (sprite != nullptr) ? sprite->getFrameCount() : 0;
+}
+
+
+// Gets the index of the frame being drawn.
+size_t FBPainter::SpritePainter::getFrame() const
+{
+    return (sprite != nullptr) ? sprite->getFrame() : 0;
+}
+
+
+// Selects the frame to draw.
+void FBPainter::SpritePainter::setFrame(const size_t frame,
+        FrameBuffer* const frameBuffer)
+{
+    if (frameBuffer == nullptr)
+    {
+        changeFrame(frame, nullptr);
+        return;
+    }
+    DrawContext context(frameBuffer);
+    changeFrame(frame, &context);
+}
+
+
+// Selects the frame to draw, and redraws the pixels that change within a draw
+// context's clipping rectangle.
+void FBPainter::SpritePainter::setFrame(const size_t frame,
+        DrawContext& context)
+{
+    changeFrame(frame, &context);
+}
+
+
+// Advances to the next frame, looping back to the first frame after the last.
+void FBPainter::SpritePainter::nextFrame(FrameBuffer* const frameBuffer)
+{
+    setFrame(getFrame() + 1, frameBuffer);
+}
+
+
+// Selects the frame to draw, and redraws changed pixels if a draw context is
+// provided.
+void FBPainter::SpritePainter::changeFrame(const size_t frame,
+        DrawContext* const context)
+{
+    if (sprite == nullptr || sprite->getFrameCount() == 0)
+    {
+        return;
+    }
+    const size_t frameCount = sprite->getFrameCount();
+    const size_t target = frame % frameCount;
+    // Collect the changes from every frame passed on the way to the target:
+    std::vector<Rectangle> changes;
+    for (size_t i = sprite->getFrame(); i != target; )
+    {
+        i = (i + 1) % frameCount;
+        const std::vector<Rectangle>& frameChanges
+                = sprite->getFrameChanges(i);
+        changes.insert(changes.end(), frameChanges.begin(),
+                frameChanges.end());
+    }
+    sprite->setFrame(target);
+    if (! changes.empty())
+    {
+        updateImagePixels(changes, context);
+    }
+}
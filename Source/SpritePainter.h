@@ -0,0 +1,97 @@
+/**
+ * @file  SpritePainter.h
+ *
+ * @brief  Draws an animated image into the frame buffer.
+ */
+
+#pragma once
+#include "ImagePainter.h"
+#include "AnimatedImage.h"
+
+namespace FBPainter
+{
+    class SpritePainter;
+}
+
+/**
+ * @brief  Draws an AnimatedImage, and changes frames by only redrawing the
+ *         pixels that differ between them.
+ *
+ *  The painter saves frame buffer pixels under every pixel any frame may
+ * cover, so frames can change without reallocating or repainting the whole
+ * image.
+ */
+class FBPainter::SpritePainter : public ImagePainter
+{
+public:
+    /**
+     * @brief  Stores the animation on construction.
+     *
+     * @param sprite  An animated image, to be deleted when the SpritePainter
+     *                is destroyed.
+     */
+    SpritePainter(AnimatedImage* sprite);
+
+    virtual ~SpritePainter() { }
+
+    /**
+     * @brief  Gets the number of animation frames.
+     *
+     * @return  The number of frames in the animation.
+     */
+    size_t getFrameCount() const;
+
+    /**
+     * @brief  Gets the index of the frame being drawn.
+     *
+     * @return  The current animation frame.
+     */
+    size_t getFrame() const;
+
+    /**
+     * @brief  Selects the frame to draw.
+     *
+     * @param frame        The new frame index. Indices past the last frame
+     *                     wrap around to the start of the animation.
+     *
+     * @param frameBuffer  If this buffer pointer is non-null and the image is
+     *                     drawn, the pixels that change will be redrawn.
+     */
+    void setFrame(const size_t frame, FrameBuffer* const frameBuffer = nullptr);
+
+    /**
+     * @brief  Selects the frame to draw, and redraws the pixels that change
+     *         within a draw context's clipping rectangle.
+     *
+     * @param frame    The new frame index. Indices past the last frame wrap
+     *                 around to the start of the animation.
+     *
+     * @param context  The draw context used to redraw changed pixels, if the
+     *                 image is drawn.
+     */
+    void setFrame(const size_t frame, DrawContext& context);
+
+    /**
+     * @brief  Advances to the next frame, looping back to the first frame
+     *         after the last.
+     *
+     * @param frameBuffer  If this buffer pointer is non-null and the image is
+     *                     drawn, the pixels that change will be redrawn.
+     */
+    void nextFrame(FrameBuffer* const frameBuffer = nullptr);
+
+private:
+    /**
+     * @brief  Selects the frame to draw, and redraws changed pixels if a draw
+     *         context is provided.
+     *
+     * @param frame    The new frame index.
+     *
+     * @param context  The draw context used to redraw changed pixels, or
+     *                 nullptr to only change frames.
+     */
+    void changeFrame(const size_t frame, DrawContext* const context);
+
+    // The animation, owned by the ImagePainter:
+    AnimatedImage* sprite = nullptr;
+};
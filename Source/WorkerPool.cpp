@@ -0,0 +1,116 @@
+#include "WorkerPool.h"
+#include <algorithm>
+
+
+// Starts all worker threads.
+FBPainter::WorkerPool::WorkerPool(const size_t threadCount) : nextTask(0)
+{
+    size_t totalThreads = threadCount;
+    if (totalThreads == 0)
+    {
+        totalThreads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    for (size_t i = 1; i < totalThreads; i++)
+    {
+        threads.emplace_back(&WorkerPool::workerLoop, this, i);
+    }
+}
+
+
+// Stops and joins all worker threads on destruction.
+FBPainter::WorkerPool::~WorkerPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(batchLock);
+        stopping = true;
+    }
+    batchStarted.notify_all();
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+}
+
+
+// Gets the number of threads that run tasks.
+size_t FBPainter::WorkerPool::getThreadCount() const
+{
+    return threads.size() + 1;
+}
+
+
+// Runs a batch of tasks, returning once all of them finish.
+void FBPainter::WorkerPool::run(const size_t taskCount, const Task& task)
+{
+    if (taskCount == 0)
+    {
+        return;
+    }
+    if (threads.empty() || taskCount == 1)
+    {
+        for (size_t i = 0; i < taskCount; i++)
+        {
+            task(i, 0);
+        }
+        return;
+    }
+    std::lock_guard<std::mutex> runGuard(runLock);
+    {
+        std::lock_guard<std::mutex> lock(batchLock);
+        batchTask = &task;
+        batchSize = taskCount;
+        nextTask.store(0);
+        activeWorkers = threads.size();
+        batchNumber++;
+    }
+    batchStarted.notify_all();
+    runTasks(0);
+    std::unique_lock<std::mutex> lock(batchLock);
+    batchFinished.wait(lock, [this] { return activeWorkers == 0; });
+    batchTask = nullptr;
+    batchSize = 0;
+}
+
+
+// Runs tasks from the current batch until none are left.
+void FBPainter::WorkerPool::runTasks(const size_t workerIndex)
+{
+    for (size_t taskIndex = nextTask.fetch_add(1); taskIndex < batchSize;
+            taskIndex = nextTask.fetch_add(1))
+    {
+        (*batchTask)(taskIndex, workerIndex);
+    }
+}
+
+
+// Waits for new batches, and works on them until the pool is destroyed.
+void FBPainter::WorkerPool::workerLoop(const size_t workerIndex)
+{
+    size_t lastBatch = 0;
+    for (;;)
+    {
+        {
+            std::unique_lock<std::mutex> lock(batchLock);
+            batchStarted.wait(lock, [this, lastBatch]
+            {
+                return stopping || batchNumber != lastBatch;
+            });
+            if (stopping)
+            {
+                return;
+            }
+            lastBatch = batchNumber;
+        }
+        runTasks(workerIndex);
+        bool lastWorker;
+        {
+            std::lock_guard<std::mutex> lock(batchLock);
+            activeWorkers--;
+            lastWorker = (activeWorkers == 0);
+        }
+        if (lastWorker)
+        {
+            batchFinished.notify_one();
+        }
+    }
+}
@@ -0,0 +1,117 @@
+/**
+ * @file  WorkerPool.h
+ *
+ * @brief  Runs batches of independent tasks on a persistent set of threads.
+ */
+
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <stddef.h>
+
+namespace FBPainter
+{
+    class WorkerPool;
+}
+
+/**
+ * @brief  Splits work across a fixed number of threads that are created once
+ *         and reused for every batch.
+ *
+ *  The thread that calls run always works on the batch too, so a pool with a
+ * thread count of one never starts any threads and runs every task inline.
+ * A pool may be shared by any number of ImagePainters, but only one batch runs
+ * at a time.
+ */
+class FBPainter::WorkerPool
+{
+public:
+    // The cache line size assumed when keeping data used by different
+    // threads apart:
+    static const constexpr size_t cacheLineSize = 64;
+
+    /**
+     * @brief  A function that performs one task in a batch.
+     *
+     *  The first parameter is the task's index within the batch, and the
+     * second is the index of the worker running it, which is always less than
+     * the pool's thread count. No two tasks with the same worker index ever
+     * run at the same time.
+     */
+    typedef std::function<void(const size_t, const size_t)> Task;
+
+    /**
+     * @brief  Starts all worker threads.
+     *
+     * @param threadCount  The total number of threads that run tasks,
+     *                     including the thread that calls run. If zero, one
+     *                     thread is used for each available core.
+     */
+    WorkerPool(const size_t threadCount = 0);
+
+    /**
+     * @brief  Stops and joins all worker threads on destruction.
+     */
+    ~WorkerPool();
+
+    /**
+     * @brief  Gets the number of threads that run tasks.
+     *
+     * @return  The number of background threads, plus one for the calling
+     *          thread.
+     */
+    size_t getThreadCount() const;
+
+    /**
+     * @brief  Runs a batch of tasks, returning once all of them finish.
+     *
+     * @param taskCount  The number of tasks in the batch.
+     *
+     * @param task       The function to run once for each task index.
+     */
+    void run(const size_t taskCount, const Task& task);
+
+private:
+    /**
+     * @brief  Runs tasks from the current batch until none are left.
+     *
+     * @param workerIndex  The index of the worker taking tasks.
+     */
+    void runTasks(const size_t workerIndex);
+
+    /**
+     * @brief  Waits for new batches, and works on them until the pool is
+     *         destroyed.
+     *
+     * @param workerIndex  The index of the background thread's worker.
+     */
+    void workerLoop(const size_t workerIndex);
+
+    // Background threads, with indices starting at one:
+    std::vector<std::thread> threads;
+    // Only one batch may run at a time:
+    std::mutex runLock;
+
+    // Guards batch state shared with background threads:
+    std::mutex batchLock;
+    std::condition_variable batchStarted;
+    std::condition_variable batchFinished;
+    // Incremented for each new batch, so workers know when one starts:
+    size_t batchNumber = 0;
+    // Number of background threads still working on the current batch:
+    size_t activeWorkers = 0;
+    bool stopping = false;
+
+    // The current batch:
+    const Task* batchTask = nullptr;
+    size_t batchSize = 0;
+    // The next task index to claim. Every worker updates it, so it's padded
+    // to keep it off of the cache lines holding other members:
+    char leadingPadding[cacheLineSize];
+    std::atomic<size_t> nextTask;
+    char trailingPadding[cacheLineSize];
+};
@@ -0,0 +1,518 @@
+/**
+ * @file  Benchmark.cpp
+ *
+ * @brief  Measures FBPainter drawing throughput in an in-memory frame buffer.
+ *
+ *  Every combination of image source, alpha profile, and image size is drawn,
+ * cleared, and moved for a fixed number of frames. Results are printed to
+ * stdout as CSV, one row per measurement, so runs from different releases can
+ * be compared directly. The last two rows compare moving a 256x256 sprite by
+ * one pixel against redrawing it, and measure full-screen clears.
+ *
+ *  The sprite comparison row's ns_per_frame column holds the move time
+ * divided by the redraw time, rather than a time. As only the sprite's edges
+ * change, a move should cost a small fraction of a redraw.
+ *
+ *  Before measuring anything, the blend kernel selected for the CPU is
+ * checked against blendPremultiplied for every alpha and color component,
+ * including invalid color components larger than alpha. If any result
+ * differs, the benchmark exits with a failure status.
+ *
+ * Usage: FBPainterBenchmark [-n frames] [-f pixelFormat] [-j threads]
+ */
+
+#include "../FBPainter.hpp"
+#include "CodeImage.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+#ifdef USE_PNG
+#include <unistd.h>
+#endif
+
+using namespace FBPainter;
+
+// Frame buffer resolution, matching common small displays:
+static const constexpr size_t screenWidth = 800;
+static const constexpr size_t screenHeight = 480;
+
+// Number of timed frames per measurement if no count is given:
+static const constexpr size_t defaultFrameCount = 200;
+
+/**
+ * @brief  Ways benchmark images use their alpha channel.
+ */
+enum class AlphaProfile
+{
+    // Every pixel is fully opaque.
+    Opaque,
+    // Every pixel is either fully opaque or fully transparent.
+    Binary,
+    // Alpha varies smoothly across the whole 0-255 range.
+    Soft,
+    // A single flat colored disc with antialiased edges, like a cursor or
+    // icon.
+    Sprite
+};
+
+
+// Gets the name used for an alpha profile in benchmark results.
+static const char* alphaProfileName(const AlphaProfile profile)
+{
+    switch (profile)
+    {
+        case AlphaProfile::Opaque:
+            return "opaque";
+        case AlphaProfile::Binary:
+            return "binary";
+        case AlphaProfile::Soft:
+            return "soft";
+        case AlphaProfile::Sprite:
+            return "sprite";
+    }
+    return "unknown";
+}
+
+
+// Gets the color of a benchmark image pixel.
+static RGBAPixel patternColor(const size_t x, const size_t y,
+        const size_t width, const size_t height, const AlphaProfile profile)
+{
+    const uint8_t red = x * 255 / width;
+    const uint8_t green = y * 255 / height;
+    const uint8_t blue = (x ^ y) & 0xff;
+    uint8_t alpha = 255;
+    if (profile == AlphaProfile::Binary)
+    {
+        // A checkerboard of 4x4 blocks, so runs of each kind stay short:
+        alpha = (((x / 4) + (y / 4)) % 2 == 0) ? 255 : 0;
+    }
+    else if (profile == AlphaProfile::Soft)
+    {
+        alpha = (x + y) * 255 / (width + height - 2);
+    }
+    else if (profile == AlphaProfile::Sprite)
+    {
+        // Alpha follows how much of each pixel the disc covers:
+        const double radius = std::min(width, height) / 2.0 - 1;
+        const double distance = std::hypot(x + 0.5 - width / 2.0,
+                y + 0.5 - height / 2.0);
+        const double coverage = std::max(0.0,
+                std::min(1.0, radius - distance + 0.5));
+        return RGBAPixel(200, 60, 40, std::lround(coverage * 255));
+    }
+    return RGBAPixel(red, green, blue, alpha);
+}
+
+
+/**
+ * @brief  Generated image data, in the same form ImageEncoder produces for
+ *         CodeImage.
+ *
+ * @tparam imageWidth   The image width in pixels.
+ *
+ * @tparam imageHeight  The image height in pixels.
+ *
+ * @tparam profile      How the image uses its alpha channel.
+ */
+template <size_t imageWidth, size_t imageHeight, AlphaProfile profile>
+class PatternData
+{
+public:
+    // Image width in pixels:
+    static const constexpr size_t width = imageWidth;
+
+    // Image height in pixels:
+    static const constexpr size_t height = imageHeight;
+
+    static RGBAPixel getColor(const size_t x, const size_t y)
+    {
+        if (x >= width || y >= height)
+        {
+            return RGBAPixel();
+        }
+        return patternColor(x, y, width, height, profile);
+    }
+};
+
+
+/**
+ * @brief  Describes one image used in benchmark measurements.
+ */
+struct BenchmarkImage
+{
+    // The image source type:
+    const char* source;
+    AlphaProfile profile;
+    size_t width;
+    size_t height;
+    // Creates a new copy of the image:
+    Image* (*create)(const BenchmarkImage& description);
+};
+
+
+// Creates a CodeImage holding generated pattern data.
+template <size_t width, size_t height, AlphaProfile profile>
+static Image* createCodeImage(const BenchmarkImage& /* description */)
+{
+    return new CodeImage<PatternData<width, height, profile>>();
+}
+
+
+#ifdef USE_PNG
+// Creates a PngImage holding generated pattern data, loaded from a temporary
+// file.
+static Image* createPngImage(const BenchmarkImage& description)
+{
+    png::image<png::rgba_pixel> pngData(description.width,
+            description.height);
+    for (size_t y = 0; y < description.height; y++)
+    {
+        for (size_t x = 0; x < description.width; x++)
+        {
+            const RGBAPixel color = patternColor(x, y, description.width,
+                    description.height, description.profile);
+            pngData.set_pixel(x, y, png::rgba_pixel(color.getRed(),
+                    color.getGreen(), color.getBlue(), color.getAlpha()));
+        }
+    }
+    char path[] = "/tmp/FBPainterBenchmark-XXXXXX";
+    const int fileDescriptor = mkstemp(path);
+    if (fileDescriptor == -1)
+    {
+        perror("Failed to create benchmark image file");
+        return nullptr;
+    }
+    close(fileDescriptor);
+    pngData.write(path);
+    Image* image = new PngImage(path);
+    unlink(path);
+    return image;
+}
+#endif
+
+
+// Adds every image source with one size and alpha profile to a list of
+// benchmark images.
+template <size_t width, size_t height, AlphaProfile profile>
+static void addImages(std::vector<BenchmarkImage>& images)
+{
+    images.push_back({"CodeImage", profile, width, height,
+            createCodeImage<width, height, profile>});
+#ifdef USE_PNG
+    images.push_back({"PngImage", profile, width, height, createPngImage});
+#endif
+}
+
+
+// Adds every image source and alpha profile with one size to a list of
+// benchmark images.
+template <size_t width, size_t height>
+static void addImages(std::vector<BenchmarkImage>& images)
+{
+    addImages<width, height, AlphaProfile::Opaque>(images);
+    addImages<width, height, AlphaProfile::Binary>(images);
+    addImages<width, height, AlphaProfile::Soft>(images);
+    addImages<width, height, AlphaProfile::Sprite>(images);
+}
+
+
+// Finds a pixel format from its name.
+static PixelFormat parsePixelFormat(const std::string& name)
+{
+    const PixelFormat formats[] =
+    {
+        PixelFormat::RGB565,
+        PixelFormat::RGB888,
+        PixelFormat::XRGB8888,
+        PixelFormat::XBGR8888,
+        PixelFormat::BGRA8888
+    };
+    const char* names[] =
+    {
+        "RGB565",
+        "RGB888",
+        "XRGB8888",
+        "XBGR8888",
+        "BGRA8888"
+    };
+    for (size_t i = 0; i < sizeof(formats) / sizeof(formats[0]); i++)
+    {
+        if (name == names[i])
+        {
+            return formats[i];
+        }
+    }
+    return PixelFormat::Unknown;
+}
+
+
+// Fills the frame buffer with a background that changes on every pixel, so
+// blending can't take shortcuts.
+static void drawBackground(FrameBuffer& frameBuffer)
+{
+    std::vector<uint32_t> row(frameBuffer.getWidth());
+    for (size_t y = 0; y < frameBuffer.getHeight(); y++)
+    {
+        for (size_t x = 0; x < row.size(); x++)
+        {
+            row[x] = ((x * 7) & 0xff) << 16 | ((y * 5) & 0xff) << 8
+                    | ((x + y) & 0xff);
+        }
+        frameBuffer.writeSpanRGB(0, y, row.data(), row.size());
+    }
+}
+
+
+// Prints one measurement as a CSV row.
+static void printResult(const char* operation, const BenchmarkImage& image,
+        const char* formatName, const size_t threads, const size_t frames,
+        const std::chrono::nanoseconds duration, const size_t pixels)
+{
+    const double nanoseconds = std::max<double>(duration.count(), 1);
+    printf("%s,%s,%s,%zu,%zu,%s,%zu,%zu,%.1f,%.0f\n", operation,
+            image.source, alphaProfileName(image.profile), image.width,
+            image.height, formatName, threads, frames, nanoseconds / frames,
+            pixels * 1000000000.0 / nanoseconds);
+}
+
+
+// Measures drawing, clearing, and moving one image.
+static void runBenchmark(FrameBuffer& frameBuffer, WorkerPool* workerPool,
+        const BenchmarkImage& description, const char* formatName,
+        const size_t frames)
+{
+    typedef std::chrono::steady_clock Clock;
+    Image* image = description.create(description);
+    if (image == nullptr)
+    {
+        return;
+    }
+    ImagePainter painter(image);
+    painter.setWorkerPool(workerPool);
+    const size_t threads = (workerPool == nullptr)
+            ? 1 : workerPool->getThreadCount();
+    const Rectangle screen(0, 0, frameBuffer.getWidth(),
+            frameBuffer.getHeight());
+    const int xStart = (frameBuffer.getWidth() - painter.getWidth()) / 2;
+    const int yStart = (frameBuffer.getHeight() - painter.getHeight()) / 2;
+    painter.setImageOrigin(xStart, yStart);
+    const Rectangle visible = painter.getBounds().getIntersection(screen);
+    const size_t framePixels = visible.getWidth() * visible.getHeight();
+
+    // Warm up caches and lazily allocated buffers before timing anything:
+    painter.drawImage(&frameBuffer);
+    painter.clearImage(&frameBuffer);
+
+    std::chrono::nanoseconds drawTime(0);
+    std::chrono::nanoseconds clearTime(0);
+    for (size_t i = 0; i < frames; i++)
+    {
+        const Clock::time_point drawStart = Clock::now();
+        painter.drawImage(&frameBuffer);
+        const Clock::time_point clearStart = Clock::now();
+        painter.clearImage(&frameBuffer);
+        const Clock::time_point clearEnd = Clock::now();
+        drawTime += clearStart - drawStart;
+        clearTime += clearEnd - clearStart;
+    }
+    printResult("drawImage", description, formatName, threads,
+            frames, drawTime, framePixels * frames);
+    printResult("clearImage", description, formatName, threads,
+            frames, clearTime, framePixels * frames);
+
+    // Move back and forth by one pixel per frame, like a dragged cursor:
+    painter.drawImage(&frameBuffer);
+    size_t movedPixels = 0;
+    const Clock::time_point moveStart = Clock::now();
+    for (size_t i = 0; i < frames; i++)
+    {
+        const int x = xStart + ((i % 2 == 0) ? 1 : 0);
+        painter.setImageOrigin(x, yStart, &frameBuffer);
+        const Rectangle moved = painter.getBounds().getIntersection(screen);
+        movedPixels += moved.getWidth() * moved.getHeight();
+    }
+    const std::chrono::nanoseconds moveTime = Clock::now() - moveStart;
+    printResult("setImageOrigin", description, formatName, threads,
+            frames, moveTime, movedPixels);
+    painter.clearImage(&frameBuffer);
+}
+
+
+// Measures full-screen clears, which use the frame buffer's fill kernels
+// instead of an image.
+static void runClearBenchmark(FrameBuffer& frameBuffer, const char* formatName,
+        const size_t frames)
+{
+    typedef std::chrono::steady_clock Clock;
+    const BenchmarkImage description = {"FrameBuffer", AlphaProfile::Opaque,
+            frameBuffer.getWidth(), frameBuffer.getHeight(), nullptr};
+    const RGBPixel colors[] = { RGBPixel(0, 0, 0), RGBPixel(40, 80, 160) };
+    frameBuffer.clear(colors[1]);
+    const Clock::time_point clearStart = Clock::now();
+    for (size_t i = 0; i < frames; i++)
+    {
+        frameBuffer.clear(colors[i % 2]);
+    }
+    const std::chrono::nanoseconds clearTime = Clock::now() - clearStart;
+    printResult("clear", description, formatName, 1, frames, clearTime,
+            description.width * description.height * frames);
+}
+
+
+// Compares moving a sprite by one pixel with redrawing it, as only the pixels
+// along its edges change.
+static void runSpriteMoveBenchmark(FrameBuffer& frameBuffer,
+        const char* formatName, const size_t frames)
+{
+    typedef std::chrono::steady_clock Clock;
+    ImagePainter painter(new CodeImage<PatternData<256, 256,
+            AlphaProfile::Sprite>>());
+    const int xStart = (frameBuffer.getWidth() - painter.getWidth()) / 2;
+    const int yStart = (frameBuffer.getHeight() - painter.getHeight()) / 2;
+    painter.setImageOrigin(xStart, yStart);
+    painter.drawImage(&frameBuffer);
+    painter.clearImage(&frameBuffer);
+
+    std::chrono::nanoseconds drawTime(0);
+    for (size_t i = 0; i < frames; i++)
+    {
+        const Clock::time_point drawStart = Clock::now();
+        painter.drawImage(&frameBuffer);
+        drawTime += Clock::now() - drawStart;
+        painter.clearImage(&frameBuffer);
+    }
+    painter.drawImage(&frameBuffer);
+    const Clock::time_point moveStart = Clock::now();
+    for (size_t i = 0; i < frames; i++)
+    {
+        const int x = xStart + ((i % 2 == 0) ? 1 : 0);
+        painter.setImageOrigin(x, yStart, &frameBuffer);
+    }
+    const std::chrono::nanoseconds moveTime = Clock::now() - moveStart;
+    painter.clearImage(&frameBuffer);
+
+    const double ratio = static_cast<double>(moveTime.count())
+            / std::max<double>(drawTime.count(), 1);
+    printf("moveRedrawRatio,CodeImage,%s,256,256,%s,1,%zu,%.3f,0\n",
+            alphaProfileName(AlphaProfile::Sprite), formatName, frames,
+            ratio);
+}
+
+
+// Checks that the selected blend kernel gives exactly the same results as
+// blendPremultiplied, even for invalid premultiplied pixels.
+static bool checkBlendKernel()
+{
+    std::vector<uint32_t> source(256);
+    std::vector<uint32_t> dest(256);
+    for (uint32_t alpha = 0; alpha < 256; alpha++)
+    {
+        for (uint32_t component = 0; component < 256; component++)
+        {
+            for (uint32_t i = 0; i < 256; i++)
+            {
+                source[i] = alpha << 24 | component << 16
+                        | (255 - component) << 8 | ((component + i) & 0xff);
+                dest[i] = i << 16 | (255 - i) << 8 | ((i * 7) & 0xff);
+            }
+            std::vector<uint32_t> blended(dest);
+            blendSpan(source.data(), blended.data(), blended.size());
+            for (size_t i = 0; i < blended.size(); i++)
+            {
+                if (blended[i] != blendPremultiplied(source[i], dest[i]))
+                {
+                    fprintf(stderr, "Blend kernel mismatch: 0x%08x over "
+                            "0x%06x gave 0x%06x, expected 0x%06x\n",
+                            source[i], dest[i], blended[i],
+                            blendPremultiplied(source[i], dest[i]));
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+
+int main(int argc, char** argv)
+{
+    size_t frames = defaultFrameCount;
+    size_t threads = 1;
+    std::string formatName = "XRGB8888";
+    for (int i = 1; i < argc; i++)
+    {
+        const std::string arg(argv[i]);
+        if (arg == "-n" && i + 1 < argc)
+        {
+            frames = std::strtoul(argv[++i], nullptr, 10);
+        }
+        else if (arg == "-f" && i + 1 < argc)
+        {
+            formatName = argv[++i];
+        }
+        else if (arg == "-j" && i + 1 < argc)
+        {
+            // Zero selects one thread per core:
+            threads = std::strtoul(argv[++i], nullptr, 10);
+        }
+        else
+        {
+            std::cerr << "Usage: " << argv[0]
+                    << " [-n frames] [-f pixelFormat] [-j threads]\n";
+            return 1;
+        }
+    }
+    const PixelFormat format = parsePixelFormat(formatName);
+    if (format == PixelFormat::Unknown || frames == 0)
+    {
+        std::cerr << "Invalid pixel format or frame count\n";
+        return 1;
+    }
+
+    if (! checkBlendKernel())
+    {
+        return 1;
+    }
+
+    FrameBuffer frameBuffer(new MemoryBackend(screenWidth, screenHeight,
+            format));
+    if (! frameBuffer.isBufferOpen())
+    {
+        std::cerr << "Failed to create in-memory frame buffer\n";
+        return 1;
+    }
+    drawBackground(frameBuffer);
+    std::unique_ptr<WorkerPool> workerPool;
+    if (threads != 1)
+    {
+        workerPool.reset(new WorkerPool(threads));
+    }
+
+    std::vector<BenchmarkImage> images;
+    addImages<16, 16>(images);
+    addImages<64, 64>(images);
+    addImages<256, 256>(images);
+    addImages<screenWidth, screenHeight>(images);
+
+    printf("operation,source,alpha,width,height,pixel_format,threads,"
+            "frames,ns_per_frame,pixels_per_second\n");
+    for (const BenchmarkImage& image : images)
+    {
+        runBenchmark(frameBuffer, workerPool.get(), image,
+                formatName.c_str(), frames);
+        fflush(stdout);
+    }
+    runSpriteMoveBenchmark(frameBuffer, formatName.c_str(), frames);
+    runClearBenchmark(frameBuffer, formatName.c_str(), frames);
+    std::cerr << "Fill kernel: " << getFillKernelName() << "\n";
+    std::cerr << "Blend kernel: " << getBlendKernelName() << "\n";
+    return 0;
+}
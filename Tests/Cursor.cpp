@@ -1,29 +1,21 @@
 #include "Cursor.h"
 
-// All image colors, as an array of RGBA color components.
-static const constexpr unsigned char colors [4][4] =
+// All image colors, as 0xAARRGGBB color values.
+static const constexpr uint32_t colors [4] =
 {
-    {0, 0, 0, 255},
-    {0, 255, 41, 0},
-    {214, 27, 27, 153},
-    {0, 0, 0, 222}
+    0xff000000, 0x0000ff29, 0x99d61b1b, 0xde000000
 };
 
-// All image data, stored in a string of color indices starting at index 'a'.
-static const constexpr char* imageData = "aaabbbbbbbbbbb"
-                                         "acdabbbbbbbbbb"
-                                         "adcaaabbbbbbbb"
-                                         "baaccaaabbbbbb"
-                                         "bbaccccaaabbbb"
-                                         "bbaacccccaaabb"
-                                         "bbbacccccccaaa"
-                                         "bbbaaccccccaab"
-                                         "bbbbacccccaabb"
-                                         "bbbbaaccccaabb"
-                                         "bbbbbaccaacaab"
-                                         "bbbbbaaaaaacaa"
-                                         "bbbbbbaabbaaab"
-                                         "bbbbbbabbbbabb";
+// All image data, stored as 2-bit color indices packed 4 to a byte,
+// starting with the lowest bits.
+static const constexpr unsigned char imageData [49] =
+{
+    0x40, 0x55, 0x55, 0x85, 0x53, 0x55, 0x55, 0x2c, 0x50, 0x55, 0x15, 0x28,
+    0x50, 0x55, 0x85, 0x2a, 0x50, 0x55, 0xa0, 0x2a, 0x50, 0x15, 0xaa, 0x2a,
+    0x50, 0x81, 0xaa, 0x42, 0x55, 0xa8, 0x0a, 0x55, 0x05, 0xaa, 0x50, 0x55,
+    0xa1, 0x20, 0x54, 0x15, 0x00, 0x08, 0x55, 0x05, 0x05, 0x54, 0x55, 0x54,
+    0x51
+};
 
 // Gets the color of an image pixel.
 FBPainter::RGBAPixel FBPainter::Cursor::getColor
@@ -33,8 +25,29 @@ FBPainter::RGBAPixel FBPainter::Cursor::getColor
     {
         return RGBAPixel();
     }
-    size_t charIdx = y * width + x;
-    size_t idx = imageData[charIdx] - 'a';
-    return RGBAPixel(colors[idx][0], colors[idx][1], colors[idx][2],
-            colors[idx][3]);
+    const size_t pixelIdx = y * width + x;
+    const uint32_t color = colors[(imageData[pixelIdx / 4]
+                >> ((pixelIdx % 4) * 2)) & 3];
+    return RGBAPixel(color >> 16, color >> 8, color, color >> 24);
+}
+
+// Copies a run of pixels from one image row.
+void FBPainter::Cursor::readRow
+(const size_t y, const size_t xStart, const size_t count, uint32_t* dest)
+{
+    size_t inBounds = 0;
+    if (y < height && xStart < width)
+    {
+        inBounds = (count < width - xStart) ? count : (width - xStart);
+    }
+    size_t pixelIdx = y * width + xStart;
+    for (size_t i = 0; i < inBounds; i++, pixelIdx++)
+    {
+        dest[i] = colors[(imageData[pixelIdx / 4]
+                >> ((pixelIdx % 4) * 2)) & 3];
+    }
+    for (size_t i = inBounds; i < count; i++)
+    {
+        dest[i] = 0;
+    }
 }
\ No newline at end of file
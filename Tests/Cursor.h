@@ -37,5 +37,21 @@ namespace FBPainter
          *           coordinates are invalid.
          */
         static RGBAPixel getColor(const size_t x,const size_t y);
+
+        /**
+         * @brief  Copies a run of pixels from one image row.
+         *
+         * @param y       The row's y-coordinate.
+         *
+         * @param xStart  The x-coordinate of the first pixel to copy.
+         *
+         * @param count   The number of pixels to copy.
+         *
+         * @param dest    A buffer with room for count 0xAARRGGBB color
+         *                values. Pixels outside of the image bounds are
+         *                set to zero.
+         */
+        static void readRow(const size_t y, const size_t xStart,
+                const size_t count, uint32_t* dest);
     };
 }
\ No newline at end of file
@@ -42,6 +42,8 @@ int main(int argc, char** argv)
     using namespace FBPainter;
 
     FrameBuffer frameBuffer("/dev/fb0");
+    // Draw off-screen and flip pages, so the moving cursor doesn't tear:
+    frameBuffer.setPageCount(2);
     const int frameWidth = frameBuffer.getWidth();
     const int frameHeight = frameBuffer.getHeight();
     std::cout << "Screen is " << frameWidth << " x " << frameHeight << "\n";
@@ -54,6 +56,7 @@ int main(int argc, char** argv)
     bool moveRight = true;
     painter.setImageOrigin(x, yPos, &frameBuffer);
     painter.drawImage(&frameBuffer);
+    frameBuffer.present();
 
     struct timespec sleepTimer = {0, 0};
     for(;;)
@@ -73,6 +76,7 @@ int main(int argc, char** argv)
             moveRight = (x == 0);
         }
         painter.setImageOrigin(x, yPos, &frameBuffer);
+        frameBuffer.present(true);
         const Time loopEnd = std::chrono::high_resolution_clock::now();
         Nanoseconds timePassed = loopEnd - loopStart;
         if (timePassed < loopDuration)